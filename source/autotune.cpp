@@ -0,0 +1,171 @@
+#include "autotune.hpp"
+#include "hash.hpp"
+#include "kernels.hpp"
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <thread>
+#include <unistd.h>
+
+// defines the trials, the key of cached tunings and the tuning of flocks
+
+// pars, tuned as tuning says
+Parameters tuned(Parameters pars, Tuning const& tuning)
+{
+  pars.set_specialized() = tuning.specialized;
+  pars.set_cell_list()   = tuning.cell_list;
+  pars.set_tiled()       = tuning.tiled;
+  pars.set_threads()     = tuning.threads;
+  return pars;
+}
+
+// mean time of a step of trial_steps evolutions of a copy of flock, in seconds.
+// A first evolution, not timed, brings the copy's state into the caches
+double time_step(Flock const& flock, Parameters const& pars, int trial_steps)
+{
+  Flock copy{flock};
+  copy.evolve(pars);
+  auto const start{std::chrono::steady_clock::now()};
+  for (int step{0}; step != trial_steps; ++step) {
+    copy.evolve(pars);
+  }
+  std::chrono::duration<double> const elapsed{
+      std::chrono::steady_clock::now() - start};
+  return elapsed.count() / trial_steps;
+}
+
+// the fastest of tunings, which can't be empty
+Tuning fastest(Flock const& flock, Parameters const& pars,
+               std::vector<Tuning> const& tunings, int trial_steps)
+{
+  assert(!tunings.empty());
+  Tuning best{tunings.front()};
+  double best_time{std::numeric_limits<double>::infinity()};
+  for (Tuning const& tuning : tunings) {
+    double const time{time_step(flock, tuned(pars, tuning), trial_steps)};
+    if (time < best_time) {
+      best      = tuning;
+      best_time = time;
+    }
+  }
+  return best;
+}
+
+Tuning trial(Flock const& flock, Parameters const& pars, int trial_steps,
+             int max_threads)
+{
+  assert(trial_steps > 0);
+  assert(max_threads > 0);
+  // the approximate rules search the cells of a grid of their own, and the
+  // specialized kernels don't let boids sleep or avoid obstacles
+  std::vector<Tuning> searches{};
+  if (pars.get_approximate()) {
+    searches.push_back({pars.get_specialized(), 0, false, max_threads});
+  } else {
+    if (pars.get_specialized() && has_specialized_kernel(pars)
+        && !pars.get_sleeping() && flock.obstacles().empty()) {
+      searches.push_back({true, 0, false, max_threads});
+    }
+    searches.push_back({false, 0, false, max_threads});
+    searches.push_back({false, 0, true, max_threads});
+    for (int cells : {1, 2, 3}) {
+      searches.push_back({false, cells, false, max_threads});
+    }
+  }
+  Tuning const search{(searches.size() == 1)
+                          ? searches.front()
+                          : fastest(flock, pars, searches, trial_steps)};
+  if (max_threads == 1) {
+    return search;
+  }
+
+  std::vector<Tuning> threads{};
+  for (int n{1}; n < max_threads; n *= 2) {
+    Tuning tuning{search};
+    tuning.threads = n;
+    threads.push_back(tuning);
+  }
+  threads.push_back(search);
+  return fastest(flock, pars, threads, trial_steps);
+}
+
+// version of the cached tunings' format and of the trials (see hash.hpp)
+int constexpr autotune_version{2};
+
+std::uint64_t autotune_key(Flock const& flock, Parameters const& pars)
+{
+  char host[256]{};
+  gethostname(host, sizeof(host) - 1);
+  Hash hash{};
+  hash.add(autotune_version);
+  for (char const* c{host}; *c != '\0'; ++c) {
+    hash.add(*c);
+  }
+  hash.add(std::thread::hardware_concurrency())
+      .add(flock.size())
+      .add(flock.predator_indices().size())
+      .add(flock.obstacles().size())
+      .add(pars.get_angle())
+      .add(pars.get_d())
+      .add(pars.get_d_s())
+      .add(pars.get_s())
+      .add(pars.get_c())
+      .add(pars.get_a())
+      .add(pars.get_max_speed())
+      .add(pars.get_min_speed())
+      .add(pars.get_duration())
+      .add(pars.get_steps())
+      .add(pars.get_x_min())
+      .add(pars.get_x_max())
+      .add(pars.get_y_min())
+      .add(pars.get_y_max())
+      .add(pars.get_d_s_pred())
+      .add(pars.get_s_pred())
+      .add(pars.get_adaptive_step())
+      .add(pars.get_sleeping())
+      .add(pars.get_approximate())
+      .add(pars.get_specialized())
+      .add(pars.get_reorder_interval())
+      .add(pars.get_work_stealing());
+  return hash.value();
+}
+
+std::string autotune_file(std::string const& dir, std::uint64_t key)
+{
+  return cache_file(dir, key, ".tune");
+}
+
+// tuning cached in filename, if it's there and valid
+bool read_tuning(std::string const& filename, Tuning& tuning)
+{
+  std::ifstream file{filename};
+  Tuning cached{};
+  if (!(file >> cached.specialized >> cached.cell_list >> cached.tiled
+        >> cached.threads)
+      || cached.cell_list < 0 || cached.threads < 1) {
+    return false;
+  }
+  tuning = cached;
+  return true;
+}
+
+bool autotune(Flock const& flock, Parameters& pars, std::string const& dir,
+              int trial_steps)
+{
+  std::string const filename{autotune_file(dir, autotune_key(flock, pars))};
+  Tuning tuning{};
+  if (read_tuning(filename, tuning)) {
+    pars = tuned(pars, tuning);
+    return true;
+  }
+
+  tuning = trial(
+      flock, pars, trial_steps,
+      std::max(static_cast<int>(std::thread::hardware_concurrency()), 1));
+  write_cache_file(dir, filename, [&](std::ofstream& file) {
+    file << tuning.specialized << ' ' << tuning.cell_list << ' '
+         << tuning.tiled << ' ' << tuning.threads << '\n';
+  });
+  pars = tuned(pars, tuning);
+  return false;
+}
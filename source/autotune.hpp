@@ -0,0 +1,47 @@
+#ifndef AUTOTUNE_HPP
+#define AUTOTUNE_HPP
+#include "flock.hpp"
+#include <cstdint>
+#include <string>
+
+// defines the automatic tuning of flocks' evolution: the neighbours' search
+// (the whole flock, scanned by a specialized kernel, by the tiled kernel or by
+// the generic rules, or a cell list and the side of its cells) and the number
+// of threads are chosen by timing a few evolutions with each of them. The
+// choice is cached on disk, so that later runs on the same machine with the
+// same configuration skip the trials
+
+// the parameters chosen by the tuning
+struct Tuning
+{
+  bool specialized{true};
+  int cell_list{0}; // see Parameters
+  bool tiled{false};
+  int threads{1};
+};
+
+// times trial_steps evolutions of a copy of flock with every neighbours'
+// search pars allows (using max_threads threads), then with 1, 2, 4 ...
+// max_threads threads for the fastest search: returns the fastest tuning
+Tuning trial(Flock const& flock, Parameters const& pars, int trial_steps,
+             int max_threads);
+
+// key of the tuning of flock and pars on this machine: a hash of the host's
+// name and number of cores, of the flock's size, predators and obstacles and of
+// the parameters (but for the cell list, the tiled kernel and the number of
+// threads: the ones the tuning sets; with specialized false, the specialized
+// kernels are never tried)
+std::uint64_t autotune_key(Flock const& flock, Parameters const& pars);
+
+// file in directory dir caching the tuning of key: [dir]/[key, in hex].tune,
+// a line with the tuning's fields
+std::string autotune_file(std::string const& dir, std::uint64_t key);
+
+// tunes pars for flock with the tuning cached in directory dir under the same
+// key or, if there's none, with trial's tuning (every core of the machine
+// available), caching it in dir (created if needed). Returns true if the cached
+// tuning was used
+bool autotune(Flock const& flock, Parameters& pars, std::string const& dir,
+              int trial_steps = 3);
+
+#endif
@@ -0,0 +1,106 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "autotune.hpp"
+#include "doctest.h"
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+
+TEST_CASE("testing autotune_key")
+{
+  Parameters pars{300., 35., 3.5,  .7, .045, .8,   80.,
+                  .05,  30., 3000, 40, 3000, 200};
+  std::vector<Boid> boids{};
+  Flock const flock{fill(boids, pars, 3)};
+  auto const key{autotune_key(flock, pars)};
+  CHECK(autotune_key(flock, pars) == key);
+
+  // the tuned parameters don't change the key, the others do
+  Parameters other{pars};
+  other.set_threads()   = 4;
+  other.set_cell_list() = 2;
+  other.set_tiled()     = true;
+  CHECK(autotune_key(flock, other) == key);
+  other.set_specialized() = true;
+  CHECK(autotune_key(flock, other) != key);
+  other = pars;
+  other.set_sleeping() = true;
+  CHECK(autotune_key(flock, other) != key);
+  Parameters const larger_d{300., 40., 3.5,  .7, .045, .8,   80.,
+                            .05,  30., 3000, 40, 3000, 200};
+  CHECK(autotune_key(flock, larger_d) != key);
+
+  // so do the flock's size and predators
+  Flock more{flock};
+  more.push_back(Boid{{50., 50.}, {1., 0.}});
+  CHECK(autotune_key(more, pars) != key);
+  Flock hunted{flock};
+  hunted.push_back(Boid{{50., 50.}, {1., 0.}, true});
+  CHECK(autotune_key(hunted, pars) != autotune_key(more, pars));
+
+  CHECK(autotune_file("cache", 0xabcull) == "cache/0000000000000abc.tune");
+}
+
+TEST_CASE("testing trial")
+{
+  Parameters pars{300., 35., 3.5,  .7, .045, .8,   80.,
+                  .05,  30., 3000, 40, 3000, 300};
+  pars.set_specialized() = true;
+  std::vector<Boid> boids{};
+  Flock const flock{fill(boids, pars, 3)};
+
+  Tuning const tuning{trial(flock, pars, 1, 3)};
+  CHECK(tuning.threads >= 1);
+  CHECK(tuning.threads <= 3);
+  CHECK(tuning.cell_list >= 0);
+  CHECK(tuning.cell_list <= 3);
+  // a cell list is never combined with the kernels, which scan the whole flock
+  CHECK_FALSE(tuning.specialized && tuning.cell_list > 0);
+  CHECK_FALSE(tuning.tiled && tuning.cell_list > 0);
+  CHECK_FALSE(tuning.tiled && tuning.specialized);
+
+  // the kernels are tried only if allowed
+  Parameters generic{pars};
+  generic.set_specialized() = false;
+  CHECK_FALSE(trial(flock, generic, 1, 1).specialized);
+
+  // the approximate rules search a grid of their own: only threads are tried
+  Parameters approximate{pars};
+  approximate.set_approximate() = true;
+  Tuning const approx_tuning{trial(flock, approximate, 1, 2)};
+  CHECK(approx_tuning.cell_list == 0);
+  CHECK_FALSE(approx_tuning.tiled);
+  CHECK(approx_tuning.specialized);
+}
+
+TEST_CASE("testing autotune")
+{
+  Parameters const pars{300., 35., 3.5,  .7, .045, .8,   80.,
+                        .05,  30., 3000, 40, 3000, 150};
+  std::vector<Boid> boids{};
+  Flock const flock{fill(boids, pars, 3)};
+  std::string const dir{"autotune_test"};
+  std::string const filename{autotune_file(dir, autotune_key(flock, pars))};
+
+  // the first run tries, the next ones take the cached tuning
+  Parameters first{pars};
+  CHECK_FALSE(autotune(flock, first, dir, 1));
+  CHECK(access(filename.c_str(), R_OK) == 0);
+  Parameters second{pars};
+  CHECK(autotune(flock, second, dir, 1));
+  CHECK(second.get_specialized() == first.get_specialized());
+  CHECK(second.get_cell_list() == first.get_cell_list());
+  CHECK(second.get_tiled() == first.get_tiled());
+  CHECK(second.get_threads() == first.get_threads());
+
+  // an invalid tuning is tried again
+  {
+    std::ofstream file{filename};
+    file << "1 0 0 0\n";
+  }
+  Parameters third{pars};
+  CHECK_FALSE(autotune(flock, third, dir, 1));
+  CHECK(third.get_threads() >= 1);
+
+  std::remove(filename.c_str());
+  rmdir(dir.c_str());
+}
@@ -0,0 +1,205 @@
+#include "boids.hpp"
+#include "flock.hpp"
+#include "parameters.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// times the evolution of a large flock under the different strategies the
+// simulation offers, printing the mean time of a step for each of them
+
+// counts the last level cache misses of the calling thread in user space, with
+// the hardware counter of perf_event_open. Where there's none (virtual
+// machines, perf_event_paranoid above 2) nothing is counted and available() is
+// false: boids-bench can then be run under perf stat -e cache-misses instead
+class Cache_misses
+{
+  int fd_{-1};
+
+ public:
+  Cache_misses()
+  {
+    perf_event_attr attr{};
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+  Cache_misses(Cache_misses const&) = delete;
+  Cache_misses& operator=(Cache_misses const&) = delete;
+  ~Cache_misses()
+  {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+  bool available() const
+  {
+    return fd_ >= 0;
+  }
+  void start()
+  {
+    ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+  }
+  // misses since start
+  long long stop()
+  {
+    ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+    long long count{0};
+    return (read(fd_, &count, sizeof(count)) == sizeof(count)) ? count : -1;
+  }
+};
+
+// evolves a copy of the flock steps times and returns the mean time of a step
+// in milliseconds. If misses is given and available, it's set to the mean cache
+// misses of a step (of the calling thread only)
+double time_evolve(std::vector<Boid> const& boids, Parameters const& pars,
+                   int steps, Cache_misses* misses = nullptr,
+                   double* misses_per_step = nullptr)
+{
+  Flock flock{boids};
+  bool const count{misses != nullptr && misses->available()};
+  if (count) {
+    misses->start();
+  }
+  auto const start{std::chrono::steady_clock::now()};
+  for (int step{0}; step != steps; ++step) {
+    flock.evolve(pars);
+  }
+  std::chrono::duration<double, std::milli> const elapsed{
+      std::chrono::steady_clock::now() - start};
+  if (count) {
+    *misses_per_step = static_cast<double>(misses->stop()) / steps;
+  }
+  return elapsed.count() / steps;
+}
+
+// gathers the first 60% of the boids in three small clusters, keeping the
+// others scattered: clustered boids' neighbours are many more, and they all lie
+// in the first chunks of the flock
+std::vector<Boid> clustered(std::vector<Boid> boids, Parameters const& pars)
+{
+  int const N{static_cast<int>(boids.size())};
+  int const n_clustered{N * 3 / 5};
+  Position const centre{(pars.get_x_min() + pars.get_x_max()) / 2.,
+                        (pars.get_y_min() + pars.get_y_max()) / 2.};
+  Position const centres[]{{.2 * pars.get_x_max(), .3 * pars.get_y_max()},
+                           {.7 * pars.get_x_max(), .6 * pars.get_y_max()},
+                           {.4 * pars.get_x_max(), .8 * pars.get_y_max()}};
+  for (int i{0}; i != n_clustered; ++i) {
+    Position& p{boids[i].position()};
+    p = centres[i * 3 / n_clustered] + (p - centre) * .03;
+  }
+  return boids;
+}
+
+int main(int argc, char* argv[])
+{
+  try {
+    // usage: boids-bench [N_boids] [steps] [max_threads]
+    int const N_boids{(argc > 1) ? std::stoi(argv[1]) : 4000};
+    int const steps{(argc > 2) ? std::stoi(argv[2]) : 20};
+    int const max_threads{
+        (argc > 3) ? std::stoi(argv[3])
+                   : static_cast<int>(std::thread::hardware_concurrency())};
+    is_greater_than(N_boids, 1, "N_boids");
+    is_greater_than(steps, 0, "steps");
+    is_greater_than(max_threads, 0, "max_threads");
+
+    // default parameters of the simulation, but for the number of boids
+    Parameters pars{300., 35., 3.5, .7,  .045,  .8,   80.,
+                    .05,  30., 3000, 40, 3000, N_boids};
+    pars.set_approximate() = true;
+    // fill's random positions leave no relation between boids' places in
+    // memory and in space, the worst case for the grid's lookups
+    std::vector<Boid> boids{};
+    fill(boids, pars, 42);
+
+    // the Morton sort is meant to cut the cache misses of the grid's lookups:
+    // they are counted on the single thread evolving the flock
+    Cache_misses misses{};
+    std::cout << "  " << N_boids << " boids, " << steps
+              << " steps (approximate rules, 1 thread):\n\n"
+              << std::setw(25) << "REORDER INTERVAL:" << std::setw(20)
+              << "MS PER STEP:" << std::setw(30)
+              << "CACHE MISSES PER STEP:\n\n";
+    for (int interval : {0, 1, 10, 100}) {
+      pars.set_reorder_interval() = interval;
+      double misses_per_step{0.};
+      std::cout << std::setw(25) << interval << std::setw(20) << std::fixed
+                << std::setprecision(3)
+                << time_evolve(boids, pars, steps, &misses, &misses_per_step)
+                << std::setw(30);
+      if (misses.available()) {
+        std::cout << std::setprecision(0) << misses_per_step << '\n';
+      } else {
+        std::cout << "n/a" << '\n';
+      }
+    }
+    if (!misses.available()) {
+      std::cout << "\n  No cache miss counter: run boids-bench under perf stat "
+                   "-e cache-misses\n";
+    }
+    std::cout << std::setprecision(3);
+    pars.set_reorder_interval() = 0;
+
+    // exact neighbours' searches: the whole flock, scanned by the generic
+    // rules, by the specialized kernel or in tiles, and the cell lists
+    pars.set_approximate() = false;
+    std::cout << "\n  Neighbours' search (exact rules):\n\n"
+              << std::setw(25) << "SEARCH:" << std::setw(20)
+              << "MS PER STEP:\n\n";
+    char const* const searches[]{"generic", "specialized",
+                                 "tiled",   "1 cell per distance",
+                                 "2 cells", "3 cells"};
+    for (int search{0}; search != 6; ++search) {
+      pars.set_specialized() = (search == 1);
+      pars.set_tiled()       = (search == 2);
+      pars.set_cell_list()   = std::max(search - 2, 0);
+      std::cout << std::setw(25) << searches[search] << std::setw(20)
+                << time_evolve(boids, pars, steps) << '\n';
+    }
+    pars.set_specialized() = true;
+    pars.set_tiled()       = false;
+    pars.set_cell_list()   = 0;
+    pars.set_approximate() = true;
+
+    // scaling of a clustered flock's evolution with the number of threads
+    std::vector<Boid> const cluster_boids{clustered(boids, pars)};
+    std::cout << "\n  Clustered flock, speedup over 1 thread:\n\n"
+              << std::setw(15) << "THREADS:" << std::setw(20) << "STATIC:"
+              << std::setw(20) << "WORK STEALING:\n\n";
+    pars.set_threads() = 1;
+    double const serial{time_evolve(cluster_boids, pars, steps)};
+    for (int threads{1}; threads <= max_threads; threads *= 2) {
+      pars.set_threads()       = threads;
+      pars.set_work_stealing() = false;
+      double const t_static{time_evolve(cluster_boids, pars, steps)};
+      pars.set_work_stealing() = true;
+      double const t_stealing{time_evolve(cluster_boids, pars, steps)};
+      std::cout << std::setw(15) << threads << std::setw(20)
+                << serial / t_static << std::setw(20) << serial / t_stealing
+                << '\n';
+    }
+  } catch (Invalid_Parameter const& par_err) {
+    std::cerr << "Invalid Parameter: " << par_err.what() << '\n';
+    return EXIT_FAILURE;
+  } catch (std::exception const& err) {
+    std::cerr << "An error occurred: " << err.what() << '\n';
+    return EXIT_FAILURE;
+  }
+}
@@ -1,4 +1,6 @@
 #include "boids.hpp"
+#include <algorithm>
+#include <cstdint>
 
 // defines Vector2D's operators, function normalize, Boid's constructors and
 // auxiliary functions of the main flying rules taking one or more boids as
@@ -157,3 +159,170 @@ Velocity& bound_position(Boid& boid, double x_min, double x_max, double y_min,
   }
   return boid.velocity();
 }
+
+// velocity turned from v0 towards v1 by alpha of the angle between them, with
+// speed from norm(v0) to norm(v1)
+Velocity turn(Velocity const& v0, Velocity const& v1, double alpha)
+{
+  double const s0{norm(v0)};
+  double const s1{norm(v1)};
+  if (s0 == 0. || s1 == 0.) {
+    return Velocity{v0.x() + (v1.x() - v0.x()) * alpha,
+                    v0.y() + (v1.y() - v0.y()) * alpha};
+  }
+  double const a0{std::atan2(v0.y(), v0.x())};
+  // the difference of the angles is taken in [-pi, pi]
+  double const a{a0
+                 + std::remainder(std::atan2(v1.y(), v1.x()) - a0, 2. * pi)
+                       * alpha};
+  double const speed{s0 + (s1 - s0) * alpha};
+  return Velocity{speed * std::cos(a), speed * std::sin(a)};
+}
+
+std::vector<Boid>& interpolate(std::vector<Boid> const& previous,
+                               std::vector<Boid> const& current, double alpha,
+                               std::vector<Boid>& result)
+{
+  assert(alpha >= 0. && alpha <= 1.);
+  // boids are looked up by id only if their places changed
+  std::vector<int> index{};
+  auto const find{[&](int i) -> Boid const* {
+    int const id{current[i].id()};
+    if (i < static_cast<int>(previous.size()) && previous[i].id() == id) {
+      return &previous[i];
+    }
+    if (index.empty()) {
+      int max_id{0};
+      for (Boid const& boid : previous) {
+        max_id = std::max(max_id, boid.id());
+      }
+      index.assign(max_id + 1, -1);
+      for (int j{0}; j != static_cast<int>(previous.size()); ++j) {
+        index[previous[j].id()] = j;
+      }
+    }
+    return (id < static_cast<int>(index.size()) && index[id] >= 0)
+             ? &previous[index[id]]
+             : nullptr;
+  }};
+
+  result = current;
+  for (int i{0}; i != static_cast<int>(current.size()); ++i) {
+    Boid const* before{find(i)};
+    if (before == nullptr) {
+      continue;
+    }
+    Position const p0{before->position()};
+    Position const p1{current[i].position()};
+    result[i].position() = Position{p0.x() + (p1.x() - p0.x()) * alpha,
+                                    p0.y() + (p1.y() - p0.y()) * alpha};
+    result[i].velocity() =
+        turn(before->velocity(), current[i].velocity(), alpha);
+  }
+  return result;
+}
+
+// components of a few boids, processed together by vector instructions (with
+// GCC's and Clang's vector extensions, operations on Lanes apply lane by lane
+// and comparisons give a mask of all-one or all-zero lanes)
+int constexpr lanes{2};
+using Lanes = double __attribute__((vector_size(lanes * sizeof(double))));
+using Mask  = std::int64_t __attribute__((vector_size(lanes * sizeof(double))));
+
+// compiled to a single vector instruction, since the math functions don't set
+// errno
+Lanes speed(Lanes v_x, Lanes v_y)
+{
+  Lanes const squares{v_x * v_x + v_y * v_y};
+  Lanes result;
+  for (int l{0}; l != lanes; ++l) {
+    result[l] = std::sqrt(squares[l]);
+  }
+  return result;
+}
+
+// velocities are updated in the same order as by bound_position, leave_corner
+// and normalize, conditions are evaluated for all lanes and values selected
+// (with m ? a : b) instead of computed under a branch
+void integrate(std::vector<Boid>& boids, std::vector<Velocity> const& d_vs,
+               double d_t, double x_min, double x_max, double y_min,
+               double y_max, double min_speed, double max_speed)
+{
+  assert(boids.size() == d_vs.size());
+  assert(d_t > 0.);
+  int const N{static_cast<int>(boids.size())};
+  Lanes const zero{};
+  double const left{x_min + 0.015 * x_max};
+  double const right{x_max - 0.015 * x_max};
+  double const bottom{y_min + 0.015 * y_max};
+  double const top{y_max - 0.015 * y_max};
+  double const corner_left{x_min + .045 * x_max};
+  double const corner_right{x_max - .045 * x_max};
+  double const corner_bottom{y_min + .045 * y_max};
+  double const corner_top{y_max - .045 * y_max};
+  Lanes const v_min{zero + 1.05 * min_speed / sqrt2}; // for null velocities
+  for (int first{0}; first < N; first += lanes) {
+    int const n{std::min(lanes, N - first)};
+    Lanes x{};
+    Lanes y{};
+    Lanes v_x{};
+    Lanes v_y{};
+    Mask pred{};
+    for (int l{0}; l != n; ++l) {
+      Boid const& boid{boids[first + l]};
+      Velocity const& d_v{d_vs[first + l]};
+      x[l]    = boid.position().x() + boid.velocity().x() * d_t;
+      y[l]    = boid.position().y() + boid.velocity().y() * d_t;
+      v_x[l]  = boid.velocity().x() + d_v.x();
+      v_y[l]  = boid.velocity().y() + d_v.y();
+      pred[l] = (boid.is_pred()) ? -1 : 0;
+    }
+
+    // bound_position
+    Lanes const push{speed(v_x, v_y) * 1.5};
+    v_x = (x < left) ? v_x + push : v_x;
+    v_x = (x > right) ? v_x - push : v_x;
+    v_y = (y < bottom) ? v_y + push : v_y;
+    v_y = (y > top) ? v_y - push : v_y;
+
+    // leave_corner, for predators only: same corners in the same order, with
+    // the same direction away from the last two
+    Mask const in_left{pred & (x < corner_left)};
+    Mask const in_right{pred & (x > corner_right)};
+    Mask const in_bottom{y < corner_bottom};
+    Mask const in_top{y > corner_top};
+    Lanes leave{2.5 * speed(v_x, v_y) / sqrt2};
+    v_x   = (in_left & in_bottom) ? leave : v_x;
+    v_y   = (in_left & in_bottom) ? leave : v_y;
+    leave = 2.5 * speed(v_x, v_y) / sqrt2;
+    v_x   = (in_left & in_top) ? leave : v_x;
+    v_y   = (in_left & in_top) ? -leave : v_y;
+    leave = 2.5 * speed(v_x, v_y) / sqrt2;
+    v_x   = (in_right & in_top) ? -leave : v_x;
+    v_y   = (in_right & in_top) ? -leave : v_y;
+    leave = 2.5 * speed(v_x, v_y) / sqrt2;
+    v_x   = (in_right & in_bottom) ? -leave : v_x;
+    v_y   = (in_right & in_bottom) ? -leave : v_y;
+
+    // normalize (lanes left empty get a null velocity, and are discarded)
+    Lanes s{speed(v_x, v_y)};
+    Lanes const slow_down{0.95 * max_speed / s};
+    v_x = (s >= max_speed) ? v_x * slow_down : v_x;
+    v_y = (s >= max_speed) ? v_y * slow_down : v_y;
+    s   = speed(v_x, v_y);
+    v_x = (s == 0.) ? v_min : v_x;
+    v_y = (s == 0.) ? v_min : v_y;
+    s   = speed(v_x, v_y);
+    Lanes const speed_up{1.05 * min_speed / s};
+    v_x = (s <= min_speed) ? v_x * speed_up : v_x;
+    v_y = (s <= min_speed) ? v_y * speed_up : v_y;
+
+    for (int l{0}; l != n; ++l) {
+      Boid& boid{boids[first + l]};
+      boid.position() = Position{x[l], y[l]};
+      boid.velocity() = Velocity{v_x[l], v_y[l]};
+      assert(norm(boid.velocity()) > min_speed
+             && norm(boid.velocity()) < max_speed);
+    }
+  }
+}
@@ -3,7 +3,9 @@
 
 #include <cassert>
 #include <cmath>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 // defines Vector2D, Position, Velocity and Boid (user-defined types)
 
@@ -31,29 +33,30 @@ inline double norm(Vector2D const& vector)
   return std::sqrt(vector.x() * vector.x() + vector.y() * vector.y());
 }
 
+// operators are only defined for Vector2D's derived types (so that they don't
+// compete with those of other types, e.g. std::chrono's)
 template<class T>
-T operator+(T const& v1, T const& v2)
+using if_vector = std::enable_if_t<std::is_base_of<Vector2D, T>::value, T>;
+
+template<class T>
+if_vector<T> operator+(T const& v1, T const& v2)
 {
-  static_assert(std::is_base_of<Vector2D, T>::value);
   return T{v1.first + v2.first, v1.second + v2.second};
 }
 template<class T>
-T operator-(T const& v1, T const& v2)
+if_vector<T> operator-(T const& v1, T const& v2)
 {
-  static_assert(std::is_base_of<Vector2D, T>::value);
   return T{v1.first - v2.first, v1.second - v2.second};
 }
 template<class T>
-T operator*(T const& v, double scalar)
+if_vector<T> operator*(T const& v, double scalar)
 {
-  static_assert(std::is_base_of<Vector2D, T>::value);
   assert(scalar != 0.);
   return T{v.first * scalar, v.second * scalar};
 }
 template<class T>
-T operator/(T const& v, double scalar)
+if_vector<T> operator/(T const& v, double scalar)
 {
-  static_assert(std::is_base_of<Vector2D, T>::value);
   assert(scalar != 0.);
   return T{v.first / scalar, v.second / scalar};
 }
@@ -76,6 +79,7 @@ class Boid
   Position p_;
   Velocity v_;
   bool is_pred_{false};
+  int id_{0}; // identifies boid within its flock, whatever its place in it
 
  public:
   explicit Boid(Position p, Velocity v, bool is_pred);
@@ -88,6 +92,8 @@ class Boid
   // only const method defined for is_pred_ since predatory nature of a boid
   // is not meant to be modified after its creation
   bool is_pred() const{return is_pred_;}
+  int id() const{return id_;}
+  int& id(){return id_;}
 };
 // clang-format on
 
@@ -103,4 +109,20 @@ void leave_corner(Boid& boid, double x_min, double x_max, double y_min,
 Velocity& bound_position(Boid& b, double x_min, double x_max, double y_min,
                          double y_max);
 
+// state at fraction alpha (from 0 to 1) of the way from previous to current:
+// boids are matched by id, positions move along a straight line, velocities
+// turn along the shorter arc while their speed changes linearly. Boids missing
+// from previous are taken as they are in current
+std::vector<Boid>& interpolate(std::vector<Boid> const& previous,
+                               std::vector<Boid> const& current, double alpha,
+                               std::vector<Boid>& result);
+
+// moves every boid by its velocity over d_t and adds to the velocity its change
+// d_v, then applies bound_position and normalize: same results as those of
+// each boid's update, taken a block of boids at a time without data-dependent
+// branches, so that the compiler can vectorize them
+void integrate(std::vector<Boid>& boids, std::vector<Velocity> const& d_vs,
+               double d_t, double x_min, double x_max, double y_min,
+               double y_max, double min_speed, double max_speed);
+
 #endif
@@ -278,4 +278,102 @@ TEST_CASE("Testing behavior in corners' proximity")
     CHECK(bound_position(b6, xmin, xmax, ymin, ymax) // positioned in the center
           == v2);
   }
-}
\ No newline at end of file
+}
+TEST_CASE("Testing integrate")
+{
+  double const x_min{0.};
+  double const x_max{1000.};
+  double const y_min{0.};
+  double const y_max{600.};
+  double const min_speed{20.};
+  double const max_speed{200.};
+  double const d_t{.01};
+  // boids near the borders and in the corners (predators among them), with
+  // velocity changes making them too fast, too slow or still
+  std::vector<Boid> boids{};
+  std::vector<Velocity> d_vs{};
+  int i{0};
+  for (double x : {1., 10., 30., 500., 970., 990., 999.}) {
+    for (double y : {1., 8., 20., 300., 580., 590., 599.}) {
+      for (Velocity const& d_v : {Velocity{0., 0.}, Velocity{300., -250.},
+                                  Velocity{-9.5, 3.}, Velocity{-10., -10.}}) {
+        Position const p{x, y};
+        Velocity const v{10. - i % 7, 10. + i % 5};
+        boids.push_back((i % 3 == 0) ? Boid{p, v, true} : Boid{p, v});
+        d_vs.push_back(d_v);
+        ++i;
+      }
+    }
+  }
+  // an odd number of boids leaves a lane empty
+  boids.pop_back();
+  d_vs.pop_back();
+
+  std::vector<Boid> integrated{boids};
+  integrate(integrated, d_vs, d_t, x_min, x_max, y_min, y_max, min_speed,
+            max_speed);
+  REQUIRE(integrated.size() == boids.size());
+  // results are exactly those of each boid's update
+  int different{0};
+  for (std::size_t k{0}; k != boids.size(); ++k) {
+    Boid expected{boids[k]};
+    expected.position() += boids[k].velocity() * d_t;
+    expected.velocity() += d_vs[k];
+    bound_position(expected, x_min, x_max, y_min, y_max);
+    normalize(expected.velocity(), min_speed, max_speed);
+    different += integrated[k].position() != expected.position()
+              || integrated[k].velocity() != expected.velocity()
+              || integrated[k].is_pred() != expected.is_pred();
+  }
+  CHECK(different == 0);
+}
+
+TEST_CASE("Testing interpolate")
+{
+  std::vector<Boid> previous{Boid{{0., 0.}, {1., 0.}},
+                             Boid{{10., 10.}, {-1., .1}},
+                             Boid{{4., 4.}, {0., 2.}, true}};
+  for (int i{0}; i != 3; ++i) {
+    previous[i].id() = i;
+  }
+  // boids reordered, one of them new
+  std::vector<Boid> current{Boid{{6., 2.}, {0., 4.}, true},
+                            Boid{{2., 0.}, {0., 3.}},
+                            Boid{{20., 20.}, {1., 1.}},
+                            Boid{{12., 10.}, {-1., -.1}}};
+  current[0].id() = 2;
+  current[1].id() = 0;
+  current[2].id() = 7;
+  current[3].id() = 1;
+  std::vector<Boid> result{};
+
+  interpolate(previous, current, 0., result);
+  REQUIRE(result.size() == 4u);
+  CHECK(result[0].position() == Position{4., 4.});
+  CHECK(result[1].velocity() == Velocity{1., 0.});
+  // a new boid is where it is now
+  CHECK(result[2].position() == Position{20., 20.});
+  CHECK(result[0].is_pred());
+  CHECK(result[0].id() == 2);
+
+  interpolate(previous, current, .5, result);
+  CHECK(result[1].position() == Position{1., 0.});
+  CHECK(result[3].position() == Position{11., 10.});
+  // headings turn along the shorter arc (here, through the negative x axis)
+  CHECK(result[3].velocity().x() == doctest::Approx(-std::hypot(1., .1)));
+  CHECK(result[3].velocity().y() == doctest::Approx(0.));
+  // speed changes linearly along the way
+  CHECK(result[1].velocity().x() == doctest::Approx(2. / sqrt2));
+  CHECK(result[1].velocity().y() == doctest::Approx(2. / sqrt2));
+  CHECK(result[0].velocity().x() == doctest::Approx(0.));
+  CHECK(result[0].velocity().y() == doctest::Approx(3.));
+
+  interpolate(previous, current, 1., result);
+  for (int i{0}; i != 4; ++i) {
+    CHECK(result[i].position() == current[i].position());
+    CHECK(result[i].velocity().x()
+          == doctest::Approx(current[i].velocity().x()));
+    CHECK(result[i].velocity().y()
+          == doctest::Approx(current[i].velocity().y()));
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef BYTES_HPP
+#define BYTES_HPP
+#include <cstring>
+
+// defines the copies of values from and to raw bytes shared by the binary
+// formats (the snapshots' arena, the trajectory file): values are copied
+// byte by byte in the machine's representation, never accessed through a
+// cast pointer, so that they needn't be aligned
+
+// writes value at out, returns the first byte after it
+template<class T>
+char* put(char* out, T value)
+{
+  std::memcpy(out, &value, sizeof(T));
+  return out + sizeof(T);
+}
+
+// reads value from in, returns the first byte after it
+template<class T>
+char const* get(char const* in, T& value)
+{
+  std::memcpy(&value, in, sizeof(T));
+  return in + sizeof(T);
+}
+
+// reads a T from in
+template<class T>
+T get(char const* in)
+{
+  T value;
+  std::memcpy(&value, in, sizeof(T));
+  return value;
+}
+
+#endif
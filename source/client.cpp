@@ -0,0 +1,81 @@
+#include "observables.hpp"
+#include "stream.hpp"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+// minimal client of the streaming server: prints a line for every frame
+// received, until the server closes the connection (or frames are enough)
+
+// reads exactly size bytes, returning false if the connection is closed first
+bool receive(int fd, std::uint8_t* data, std::size_t size)
+{
+  while (size != 0) {
+    ssize_t const n{recv(fd, data, size, 0)};
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  try {
+    if (argc < 2) {
+      std::cerr << "usage: boids-client unix:<path>|tcp:<port> [frames]\n";
+      return EXIT_FAILURE;
+    }
+    long const max_frames{(argc > 2) ? std::stol(argv[2]) : -1};
+    int const fd{connect_to(argv[1])};
+
+    std::cout << "\n  FRAME:    TYPE:    BYTES:   BOIDS:   AVERAGE SPEED:\n\n";
+    Frame_decoder decoder{};
+    std::vector<std::uint8_t> message{};
+    long frames{0};
+    long bytes{0};
+    while (frames != max_frames) {
+      std::uint8_t header[4];
+      if (!receive(fd, header, 4)) {
+        break;
+      }
+      std::uint32_t length{0};
+      for (int i{3}; i >= 0; --i) {
+        length = (length << 8) | header[i];
+      }
+      message.resize(length);
+      if (!receive(fd, message.data(), length)) {
+        break;
+      }
+      if (!decoder.decode(message.data(), length)) {
+        std::cerr << "Invalid frame received\n";
+        close(fd);
+        return EXIT_FAILURE;
+      }
+      Welford speed{};
+      for (Boid const& boid : decoder.state()) {
+        speed.add(norm(boid.velocity()));
+      }
+      bool const key{static_cast<Frame_type>(message[0]) == Frame_type::key};
+      std::cout << std::setw(8) << decoder.frame() << std::setw(9)
+                << ((key) ? "key" : "delta") << std::setw(10) << length + 4
+                << std::setw(9) << speed.count() << std::setw(17)
+                << std::setprecision(3) << std::fixed << speed.mean() << '\n';
+      ++frames;
+      bytes += length + 4;
+    }
+    close(fd);
+    std::cout << "\n  " << frames << " frames received, "
+              << ((frames) ? bytes / frames : 0) << " bytes per frame\n";
+  } catch (std::exception const& err) {
+    std::cerr << "An error occurred: " << err.what() << '\n';
+    return EXIT_FAILURE;
+  }
+}
@@ -1,11 +1,17 @@
 #include "flock.hpp"
+#include "kernels.hpp"
+#include "scheduler.hpp"
+#include "tiled.hpp"
 #include <algorithm>
 #include <functional>
 #include <numeric>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
 
 // defining flocks' flying rules (different for regular boid and predator)
-// functions to perform simulation (methods solve and evolve, fill, simulate)
+// functions to perform simulation (method evolve, fill, simulate)
 
 // fills vector with neighbours of boid (inserting also boid itself)
 std::vector<Boid>& neighbours(Boid const& boid, Flock const& flock,
@@ -14,7 +20,17 @@ std::vector<Boid>& neighbours(Boid const& boid, Flock const& flock,
   assert(!(boid.is_pred())); // flocking behavior doesn't apply to predators
   assert(nbrs.empty());      // expects an empty vector to copy neighbours in
   assert(flock.size() > 1);  // expects a flock with more than one boid
-  std::copy_if((flock.state().begin()), (flock.state().end()),
+  return neighbours(boid, flock.state(), nbrs, angle, d);
+}
+
+// same as above, looking for neighbours among candidates only
+std::vector<Boid>& neighbours(Boid const& boid,
+                              std::vector<Boid> const& candidates,
+                              std::vector<Boid>& nbrs, double angle, double d)
+{
+  assert(!(boid.is_pred()));
+  assert(nbrs.empty());
+  std::copy_if((candidates.begin()), (candidates.end()),
                std::back_inserter(nbrs), [=, &boid](Boid const& other) {
                  return (!(other.is_pred())) && (is_seen(boid, other, angle))
                      && (distance(boid, other) < d);
@@ -34,12 +50,30 @@ std::vector<Boid>& predators(Boid const& boid, Flock const& flock,
                              // predators
   assert(preds.empty());     // expects an empty vector to copy predators in
   assert(flock.size() > 1);  // expects a flock with more than one boid
-  std::copy_if((flock.state().begin()), (flock.state().end()),
+  // only the flock's predators are visited
+  for (int i : flock.predator_indices()) {
+    Boid const& other{flock.state()[i]};
+    if (is_seen(boid, other, angle)
+        && distance(boid, other) < d_s_pred) { // separation distance is
+                                               // greater towards predators
+      preds.push_back(other);
+    }
+  }
+  return preds;
+}
+
+// same as above, looking for predators among candidates only
+std::vector<Boid>& predators(Boid const& boid,
+                             std::vector<Boid> const& candidates,
+                             std::vector<Boid>& preds, double angle,
+                             double d_s_pred)
+{
+  assert(!(boid.is_pred()));
+  assert(preds.empty());
+  std::copy_if((candidates.begin()), (candidates.end()),
                std::back_inserter(preds), [=, &boid](Boid const& other) {
-                 return ((other.is_pred()) && (is_seen(boid, other, angle))
-                         && (distance(boid, other)
-                             < d_s_pred)); // separation distance is greater
-                                           // towards predators
+                 return other.is_pred() && is_seen(boid, other, angle)
+                     && distance(boid, other) < d_s_pred;
                });
   return preds;
 }
@@ -52,11 +86,12 @@ std::vector<Boid>& competitors(Boid const& boid, Flock const& flock,
   assert(boid.is_pred());
   assert(comps.empty());    // expects an empty vector to copy competitors in
   assert(flock.size() > 1); // expects a flock with more than one boid
-  std::copy_if((flock.state().begin()), (flock.state().end()),
-               std::back_inserter(comps), [=, &boid](Boid const& other) {
-                 return ((other.is_pred()) && (is_seen(boid, other, angle))
-                         && (distance(boid, other) < d_s));
-               });
+  for (int i : flock.predator_indices()) {
+    Boid const& other{flock.state()[i]};
+    if (is_seen(boid, other, angle) && distance(boid, other) < d_s) {
+      comps.push_back(other);
+    }
+  }
   // predators are peers: they separate with regular separation factor
   return comps;
 }
@@ -91,6 +126,37 @@ Boid const& find_prey(Boid const& boid, Flock const& flock, double angle)
   }
 }
 
+// largest distance at which a boid can influence a regular boid
+double interaction_distance(Parameters const& pars)
+{
+  return std::max(pars.get_d(), pars.get_d_s_pred());
+}
+
+// flags the boids whose update needs the flying rules. A regular boid with no
+// other boid closer than interaction_distance and speed within limits (which
+// normalize would leave unaltered) is sleeping: it only moves straight.
+// Predators are always active, since they seek preys at any distance
+std::vector<bool> active_boids(std::vector<Boid> const& state,
+                               Grid const& grid, Parameters const& pars)
+{
+  double const d_max{interaction_distance(pars)};
+  std::vector<bool> active(state.size(), true);
+  for (int i{0}, N{static_cast<int>(state.size())}; i != N; ++i) {
+    Boid const& boid{state[i]};
+    double const speed{norm(boid.velocity())};
+    if (boid.is_pred() || speed <= pars.get_min_speed()
+        || speed >= pars.get_max_speed()) {
+      continue;
+    }
+    bool alone{true};
+    grid.for_each_near(boid.position(), d_max, [&](int j) {
+      alone = alone && (j == i || distance(boid, state[j]) >= d_max);
+    });
+    active[i] = !alone;
+  }
+  return active;
+}
+
 // NB: the fact that boid itself is inserted in comps or close_nbrs vectors does
 // not influence sum, since (boid.position()-boid.position()) equals {0.,0.}
 Velocity separation(Boid const& boid, Flock const& flock,
@@ -112,27 +178,40 @@ Velocity separation(Boid const& boid, Flock const& flock,
     // separation from close predators
     std::vector<Boid> close_nbrs{};
     neighbours(boid, flock, close_nbrs, pars.get_angle(), pars.get_d_s());
-    auto sum1{std::transform_reduce(
-        (close_nbrs.begin()), (close_nbrs.end()), Position{0., 0.},
-        std::plus<>{}, [&](Boid const& other) {
-          return (other.position() - boid.position()) * (-pars.get_s());
-        })};
     std::vector<Boid> preds{};
     predators(boid, flock, preds, pars.get_angle(), pars.get_d_s_pred());
-    auto sum2{std::transform_reduce(
-        (preds.begin()), (preds.end()), Position{0., 0.}, std::plus<>{},
-        [&](Boid const& other) {
-          return (other.position() - boid.position()) * (-pars.get_s_pred());
-        })};
-    return {sum1.x() + sum2.x(), sum1.y() + sum2.y()};
+    return separation(boid, close_nbrs, preds, pars);
   }
 }
 
+Velocity separation(Boid const& boid, std::vector<Boid> const& close_nbrs,
+                    std::vector<Boid> const& preds, Parameters const& pars)
+{
+  assert(!(boid.is_pred()));
+  auto sum1{std::transform_reduce(
+      (close_nbrs.begin()), (close_nbrs.end()), Position{0., 0.}, std::plus<>{},
+      [&](Boid const& other) {
+        return (other.position() - boid.position()) * (-pars.get_s());
+      })};
+  auto sum2{std::transform_reduce(
+      (preds.begin()), (preds.end()), Position{0., 0.}, std::plus<>{},
+      [&](Boid const& other) {
+        return (other.position() - boid.position()) * (-pars.get_s_pred());
+      })};
+  return {sum1.x() + sum2.x(), sum1.y() + sum2.y()};
+}
+
 Velocity alignment(Boid const& boid, Flock const& flock, Parameters const& pars)
 {
   std::vector<Boid> nbrs{};
   // note that neighbours will assert internally that boid is not a pred
   neighbours(boid, flock, nbrs, pars.get_angle(), pars.get_d());
+  return alignment(boid, nbrs, pars);
+}
+
+Velocity alignment(Boid const& boid, std::vector<Boid> const& nbrs,
+                   Parameters const& pars)
+{
   // not risking narrowing since N_nbrs < N_boids, which is an int
   int vec_size{static_cast<int>(nbrs.size())};
   if (vec_size == 1) { // if nbrs has only 1 element, it's boid itself
@@ -155,6 +234,12 @@ Velocity cohesion(Boid const& boid, Flock const& flock, Parameters const& pars)
   std::vector<Boid> nbrs{};
   // note that neighbours will assert internally that boid is not a pred
   neighbours(boid, flock, nbrs, pars.get_angle(), pars.get_d());
+  return cohesion(boid, nbrs, pars);
+}
+
+Velocity cohesion(Boid const& boid, std::vector<Boid> const& nbrs,
+                  Parameters const& pars)
+{
   int vec_size{static_cast<int>(nbrs.size())}; // not risking narrowing since
   // N_nbrs < N_boids which is an int
   if (vec_size == 1) { // if nbrs has only 1 element, it's boid itself
@@ -199,15 +284,178 @@ Velocity seek(Boid const& boid, Flock const& flock, Parameters const& pars)
   return vel;
 }
 
-Boid Flock::solve(Boid const& boid, Parameters const& pars) const
+// steers boid away from the obstacles closer than d_s_pred, the distance at
+// which boids flee predators: the closer an obstacle, the stronger the drive
+// away from its axis (stronger still for a boid inside it)
+Velocity avoidance(Boid const& boid, Obstacles const& obstacles,
+                   Parameters const& pars)
+{
+  double const range{pars.get_d_s_pred()};
+  Velocity d_v{0., 0.};
+  obstacles.for_each_near(boid.position(), range, [&](Obstacle const& o) {
+    Position const out{boid.position() - axis_point(o, boid.position())};
+    double const dist{norm(out)};
+    double const gap{dist - o.radius};
+    if (gap < range && dist > 0.) {
+      d_v += out * ((range - gap) * pars.get_s_pred() / dist);
+    }
+  });
+  return d_v;
+}
+
+// sums positions and velocities of the regular boids in each cell of grid,
+// keeping track of their bounding box
+std::vector<Cell_sums> cell_sums(std::vector<Boid> const& state,
+                                 Grid const& grid)
+{
+  std::vector<Cell_sums> sums(grid.n_cells());
+  for (int c{0}, n_cells{grid.n_cells()}; c != n_cells; ++c) {
+    Cell_sums& cell{sums[c]};
+    grid.for_each_in_cell(c, [&](int i) {
+      Boid const& boid{state[i]};
+      if (boid.is_pred()) {
+        return;
+      }
+      if (cell.n == 0) {
+        cell.p_min = cell.p_max = boid.position();
+      }
+      ++cell.n;
+      cell.sum_p += boid.position();
+      cell.sum_v += boid.velocity();
+      cell.p_min = {std::min(cell.p_min.x(), boid.position().x()),
+                    std::min(cell.p_min.y(), boid.position().y())};
+      cell.p_max = {std::max(cell.p_max.x(), boid.position().x()),
+                    std::max(cell.p_max.y(), boid.position().y())};
+    });
+  }
+  return sums;
+}
+
+// true if every point of the box [p_min, p_max] is closer than d to boid and
+// within its angle of view (the box must not contain boid's position)
+bool box_in_sight(Boid const& boid, Position const& p_min,
+                  Position const& p_max, double angle, double d)
+{
+  Position const& p{boid.position()};
+  if (p.x() >= p_min.x() && p.x() <= p_max.x() && p.y() >= p_min.y()
+      && p.y() <= p_max.y()) {
+    return false;
+  }
+  // the box's angular extent, seen from p, is spanned by its corners
+  Position const corners[4]{p_min, {p_max.x(), p_min.y()}, p_max,
+                            {p_min.x(), p_max.y()}};
+  double theta_min{pi};
+  double theta_max{-pi};
+  for (Position const& corner : corners) {
+    auto const pos_diff{corner - p};
+    if (norm(pos_diff) >= d) {
+      return false;
+    }
+    // angle in range (-π, π] between boid's velocity and pos_diff
+    double const theta{
+        std::atan2(boid.velocity().x() * pos_diff.y()
+                       - boid.velocity().y() * pos_diff.x(),
+                   boid.velocity().x() * pos_diff.x()
+                       + boid.velocity().y() * pos_diff.y())};
+    theta_min = std::min(theta_min, theta);
+    theta_max = std::max(theta_max, theta);
+  }
+  // a box not containing p spans less than π: a wider interval of angles means
+  // that the box lies behind boid, across the direction opposite to velocity
+  // (a small margin keeps boids on the edge of sight out of the sums)
+  double const half_angle{pi * angle / 360. - 1e-9};
+  return theta_max - theta_min < pi && theta_min >= -half_angle
+      && theta_max <= half_angle;
+}
+
+// sums over the neighbours of a regular boid: cells entirely within distance
+// and sight contribute with their sums, other cells' boids are checked one by
+// one as in function neighbours
+Nbr_sums neighbour_sums(Boid const& boid, std::vector<Boid> const& state,
+                        Grid const& grid, std::vector<Cell_sums> const& sums,
+                        Parameters const& pars)
+{
+  assert(!(boid.is_pred())); // flocking behavior doesn't apply to predators
+  double const d{pars.get_d()};
+  double const angle{pars.get_angle()};
+  Nbr_sums nbrs{};
+  grid.for_each_cell_near(boid.position(), d, [&](int c) {
+    Cell_sums const& cell{sums[c]};
+    if (cell.n == 0) {
+      return;
+    }
+    if (box_in_sight(boid, cell.p_min, cell.p_max, angle, d)) {
+      nbrs.n += cell.n;
+      nbrs.sum_p += cell.sum_p;
+      nbrs.sum_v += cell.sum_v;
+      return;
+    }
+    grid.for_each_in_cell(c, [&](int i) {
+      Boid const& other{state[i]};
+      if (!(other.is_pred()) && is_seen(boid, other, angle)
+          && distance(boid, other) < d) {
+        ++nbrs.n;
+        nbrs.sum_p += other.position();
+        nbrs.sum_v += other.velocity();
+      }
+    });
+  });
+  assert(nbrs.n >= 1); // boid itself is always a neighbour
+  return nbrs;
+}
+
+// same as separation, looking for close neighbours and predators in the cells
+// near boid only
+Velocity separation(Boid const& boid, std::vector<Boid> const& state,
+                    Grid const& grid, Parameters const& pars)
+{
+  assert(!(boid.is_pred()));
+  Position sum1{0., 0.};
+  Position sum2{0., 0.};
+  grid.for_each_near(
+      boid.position(), std::max(pars.get_d_s(), pars.get_d_s_pred()),
+      [&](int i) {
+        Boid const& other{state[i]};
+        if (!is_seen(boid, other, pars.get_angle())) {
+          return;
+        }
+        double const dist{distance(boid, other)};
+        if (!(other.is_pred()) && dist < pars.get_d_s()) {
+          sum1 += (other.position() - boid.position()) * (-pars.get_s());
+        }
+        if (other.is_pred() && dist < pars.get_d_s_pred()) {
+          sum2 += (other.position() - boid.position()) * (-pars.get_s_pred());
+        }
+      });
+  return {sum1.x() + sum2.x(), sum1.y() + sum2.y()};
+}
+
+// alignment and cohesion from the sums over the neighbours: subtracting n times
+// boid's velocity (position) from the sum is the same as summing differences
+Velocity alignment(Boid const& boid, Nbr_sums const& nbrs,
+                   Parameters const& pars)
+{
+  if (nbrs.n == 1) { // the only neighbour is boid itself
+    return {0., 0.};
+  }
+  return (nbrs.sum_v - boid.velocity() * nbrs.n)
+       * (pars.get_a() / (nbrs.n - 1));
+}
+
+Velocity cohesion(Boid const& boid, Nbr_sums const& nbrs,
+                  Parameters const& pars)
+{
+  if (nbrs.n == 1) {
+    return {0., 0.};
+  }
+  auto const diff{(nbrs.sum_p - boid.position() * nbrs.n)
+                  * (pars.get_c() / (nbrs.n - 1))};
+  return {diff.x(), diff.y()};
+}
+
+// time step of a fixed-step evolution
+double nominal_d_t(Parameters const& pars)
 {
-  // different flying rules for predator vs. regular boid
-  Velocity d_v{(boid.is_pred())
-                   ? (separation(boid, *this, pars) + seek(boid, *this, pars))
-                   : (separation(boid, *this, pars)
-                      + alignment(boid, *this, pars)
-                      + cohesion(boid, *this, pars))};
-  Velocity v_f{boid.velocity() + d_v};
 #ifndef GRAPHICS
   double const d_t{pars.get_duration() / pars.get_steps()};
 #endif
@@ -215,23 +463,450 @@ Boid Flock::solve(Boid const& boid, Parameters const& pars) const
   double const d_t{pars.get_duration()};
 #endif
   assert(d_t > 0.);
-  Position x_f{boid.position().x() + (boid.velocity().x() * d_t),
-               boid.position().y() + (boid.velocity().y() * d_t)};
-  Boid b_f{(boid.is_pred()) ? Boid{x_f, v_f, true} : Boid{x_f, v_f}};
-  // Boid returned from solve is always "valid", i.e bound_position has been
-  // applied and speed is within limits:
-  bound_position(b_f, pars.get_x_min(), pars.get_x_max(), pars.get_y_min(),
-                 pars.get_y_max());
-  normalize(b_f.velocity(), pars.get_min_speed(), pars.get_max_speed());
-  return b_f;
+  return d_t;
 }
 
-void Flock::evolve(Parameters const& pars)
+// chooses the time step of an adaptive evolution. Velocity changes returned by
+// the flying rules refer to the nominal step, so they are rescaled by
+// d_t/nominal_d_t, and so are the rules' gains: the step is shortened until
+// the largest gain (separation from predators counting only if there are any)
+// is below 1, as explicit Euler steps overshoot past it and diverge past 2.
+// It's shortened further until no boid's rescaled change is more than half
+// its speed (min_speed, for slower boids), and until no regular boid
+// (predator) covers more than half of d_s (d_s_pred), so that separation
+// can't be skipped over
+double adaptive_d_t(std::vector<Boid> const& state,
+                    std::vector<Velocity> const& d_vs, Parameters const& pars)
 {
-  assert(this->size() > 1);
+  assert(state.size() == d_vs.size());
+  // the adaptive step is kept within these factors of the nominal one
+  double constexpr min_factor{.1};
+  double constexpr max_factor{10.};
+  // largest rescaled gain of a rule, and rescaled change of a boid's velocity
+  // in units of its speed
+  double constexpr max_gain{.9};
+  double constexpr max_change{.5};
+  double const d_t0{nominal_d_t(pars)};
+
+  bool const preds{std::any_of(state.begin(), state.end(),
+                               [](Boid const& boid) { return boid.is_pred(); })};
+  double const gain{std::max({pars.get_a(), pars.get_c(), pars.get_s(),
+                              (preds) ? pars.get_s_pred() : 0.})};
+  double d_t{std::min(max_factor, max_gain / gain) * d_t0};
+  for (std::size_t i{0}; i != state.size(); ++i) {
+    Boid const& boid{state[i]};
+    double const speed{norm(boid.velocity())};
+    double const d_v{norm(d_vs[i])};
+    if (d_v > 0.) {
+      d_t = std::min(d_t, max_change * std::max(speed, pars.get_min_speed())
+                              / d_v * d_t0);
+    }
+    double const d_sep{(boid.is_pred()) ? pars.get_d_s_pred() : pars.get_d_s()};
+    if (speed > 0.) {
+      d_t = std::min(d_t, .5 * d_sep / speed);
+    }
+  }
+  return std::max(d_t, min_factor * d_t0);
+}
+
+Velocity Flock::delta_v(Boid const& boid, Parameters const& pars) const
+{
+  // different flying rules for predator vs. regular boid
+  Velocity const d_v{
+      (boid.is_pred())
+          ? (separation(boid, *this, pars) + seek(boid, *this, pars))
+          : (separation(boid, *this, pars) + alignment(boid, *this, pars)
+             + cohesion(boid, *this, pars))};
+  return (obstacles_.empty()) ? d_v
+                              : d_v + avoidance(boid, obstacles_, pars);
+}
+
+// as delta_v, with alignment and cohesion computed from the cells' sums
+Velocity Flock::approx_delta_v(Boid const& boid, Parameters const& pars,
+                               Grid const& grid,
+                               std::vector<Cell_sums> const& sums) const
+{
+  Velocity d_v{0., 0.};
+  if (boid.is_pred()) {
+    d_v = separation(boid, *this, pars) + seek(boid, *this, pars);
+  } else {
+    Nbr_sums const nbrs{neighbour_sums(boid, flock_, grid, sums, pars)};
+    d_v = separation(boid, flock_, grid, pars) + alignment(boid, nbrs, pars)
+        + cohesion(boid, nbrs, pars);
+  }
+  return (obstacles_.empty()) ? d_v
+                              : d_v + avoidance(boid, obstacles_, pars);
+}
+
+// as delta_v, a regular boid's neighbours being looked for among the boids in
+// the cells near it only. Taken in the order of the state, those are the very
+// neighbours a scan of the whole flock finds, summed in the same order: the
+// velocity change is the same as delta_v's (predators seek preys at any
+// distance, hence scan the whole flock as in delta_v)
+Velocity Flock::cell_delta_v(Boid const& boid, Parameters const& pars,
+                             Grid const& grid) const
+{
+  if (boid.is_pred()) {
+    return delta_v(boid, pars);
+  }
+  std::vector<int> near{};
+  grid.for_each_near(boid.position(), interaction_distance(pars),
+                     [&](int i) { near.push_back(i); });
+  std::sort(near.begin(), near.end());
+  std::vector<Boid> candidates{};
+  candidates.reserve(near.size());
+  for (int i : near) {
+    candidates.push_back(flock_[i]);
+  }
+  double const angle{pars.get_angle()};
+  std::vector<Boid> close_nbrs{};
+  neighbours(boid, candidates, close_nbrs, angle, pars.get_d_s());
+  std::vector<Boid> preds{};
+  predators(boid, candidates, preds, angle, pars.get_d_s_pred());
+  std::vector<Boid> nbrs{};
+  neighbours(boid, candidates, nbrs, angle, pars.get_d());
+  Velocity const d_v{separation(boid, close_nbrs, preds, pars)
+                     + alignment(boid, nbrs, pars)
+                     + cohesion(boid, nbrs, pars)};
+  return (obstacles_.empty()) ? d_v
+                              : d_v + avoidance(boid, obstacles_, pars);
+}
+
+// true if bound_position would modify the velocity of a boid in position p
+bool near_border(Position const& p, Parameters const& pars)
+{
+  return p.x() < pars.get_x_min() + 0.015 * pars.get_x_max()
+      || p.x() > pars.get_x_max() - 0.015 * pars.get_x_max()
+      || p.y() < pars.get_y_min() + 0.015 * pars.get_y_max()
+      || p.y() > pars.get_y_max() - 0.015 * pars.get_y_max();
+}
+
+double Flock::evolve(Parameters const& pars, double max_d_t)
+{
+  return evolve(pars, nullptr, max_d_t);
+}
+
+double Flock::evolve(Parameters const& pars, Observables& observables,
+                     double max_d_t)
+{
+  return evolve(pars, &observables, max_d_t);
+}
+
+void Flock::reference_evolve(Parameters const& pars, double d_t)
+{
+  assert(d_t > 0.);
+  // velocity changes refer to the nominal step
+  double const scale{d_t / nominal_d_t(pars)};
   std::vector<Boid> state_f{};
-  std::transform(flock_.begin(), flock_.end(), std::back_inserter(state_f),
-                 [&](Boid const& boid) { return solve(boid, pars); });
+  state_f.reserve(flock_.size());
+  for (Boid const& boid : flock_) {
+    Velocity const d_v{delta_v(boid, pars)};
+    Position x_f{boid.position()};
+    x_f += boid.velocity() * d_t;
+    Velocity const v_f{boid.velocity() + ((scale != 1.) ? d_v * scale : d_v)};
+    state_f.push_back((boid.is_pred()) ? Boid{x_f, v_f, true} : Boid{x_f, v_f});
+    Boid& b_f{state_f.back()};
+    bound_position(b_f, pars.get_x_min(), pars.get_x_max(), pars.get_y_min(),
+                   pars.get_y_max());
+    normalize(b_f.velocity(), pars.get_min_speed(), pars.get_max_speed());
+    b_f.id() = boid.id();
+  }
+  flock_ = state_f;
+  ++evolutions_;
+}
+
+// distances of a boid from the nearest other boid and, for a predator, from
+// the nearest regular boid (infinity if none), sampled for the observables
+struct Nearest
+{
+  double nn_dist;
+  double prey_dist;
+};
+
+Nearest nearest(std::vector<Boid> const& state, int i, Grid const& grid)
+{
+  Boid const& boid{state[i]};
+  double const nn_dist{grid.nearest(boid.position(), state,
+                                    [=](int j) { return j != i; })};
+  double const prey_dist{
+      (boid.is_pred())
+          ? grid.nearest(boid.position(), state,
+                         [&](int j) { return !(state[j].is_pred()); })
+          : std::numeric_limits<double>::infinity()};
+  return {nn_dist, prey_dist};
+}
+
+// evolves the flock, then sorts it along the Morton curve every
+// reorder_interval evolutions (if that's not 0)
+double Flock::evolve(Parameters const& pars, Observables* observables,
+                     double max_d_t)
+{
+  double const d_t{advance(pars, observables, max_d_t)};
+  ++evolutions_;
+  int const interval{pars.get_reorder_interval()};
+  assert(interval >= 0);
+  if (interval > 0 && evolutions_ % interval == 0) {
+    reorder();
+  }
+  return d_t;
+}
+
+void Flock::reorder()
+{
+  assert(!empty());
+  auto const [x_min, x_max] = std::minmax_element(
+      flock_.begin(), flock_.end(), [](Boid const& b1, Boid const& b2) {
+        return b1.position().x() < b2.position().x();
+      });
+  auto const [y_min, y_max] = std::minmax_element(
+      flock_.begin(), flock_.end(), [](Boid const& b1, Boid const& b2) {
+        return b1.position().y() < b2.position().y();
+      });
+  std::vector<std::pair<std::uint32_t, Boid>> coded;
+  coded.reserve(flock_.size());
+  for (Boid const& boid : flock_) {
+    coded.emplace_back(morton_code(boid.position(), x_min->position().x(),
+                                   x_max->position().x(), y_min->position().y(),
+                                   y_max->position().y()),
+                       boid);
+  }
+  // stable sorting, so that boids sharing a code keep their relative order
+  std::stable_sort(coded.begin(), coded.end(),
+                   [](auto const& c1, auto const& c2) {
+                     return c1.first < c2.first;
+                   });
+  std::transform(coded.begin(), coded.end(), flock_.begin(),
+                 [](auto const& c) { return c.second; });
+  index();
+}
+
+// rebuilds the predators' indices and the index by id from scratch
+void Flock::index()
+{
+  preds_.clear();
+  index_.assign(next_id_, -1);
+  for (int i{0}; i != size(); ++i) {
+    if (flock_[i].is_pred()) {
+      preds_.push_back(i);
+    }
+    index_[flock_[i].id()] = i;
+  }
+}
+
+void Flock::append(Boid const& boid)
+{
+  int const i{size()};
+  flock_.push_back(boid);
+  flock_.back().id() = next_id_++;
+  index_.push_back(i);
+  // the new index is the largest: the predators' indices stay sorted
+  if (boid.is_pred()) {
+    preds_.push_back(i);
+  }
+}
+
+void Flock::insert(std::vector<Boid> const& boids)
+{
+  assert(!empty());
+  flock_.reserve(flock_.size() + boids.size());
+  index_.reserve(index_.size() + boids.size());
+  for (Boid const& boid : boids) {
+    append(boid);
+  }
+}
+
+int Flock::remove(std::vector<int> const& ids)
+{
+  // evolutions need at least two boids, as the constructor does: the boids
+  // to remove are counted (once each) before any is
+  std::vector<int> present{};
+  for (int id : ids) {
+    if (index_of(id) >= 0) {
+      present.push_back(id);
+    }
+  }
+  std::sort(present.begin(), present.end());
+  int const n_present{static_cast<int>(
+      std::unique(present.begin(), present.end()) - present.begin())};
+  if (size() - n_present < 2) {
+    throw std::runtime_error{"ERROR: Cannot remove " + std::to_string(n_present)
+                             + " boids from a flock of "
+                             + std::to_string(size())
+                             + ": at least two must remain"};
+  }
+
+  int removed{0};
+  for (int id : ids) {
+    int const i{index_of(id)};
+    if (i < 0) {
+      continue;
+    }
+    int const last{size() - 1};
+    if (flock_[i].is_pred()) {
+      preds_.erase(std::lower_bound(preds_.begin(), preds_.end(), i));
+    }
+    if (i != last) {
+      if (flock_[last].is_pred()) {
+        // the last index is the largest: it's at the back, and it takes the
+        // place of the index removed in the sorted order
+        preds_.pop_back();
+        preds_.insert(std::lower_bound(preds_.begin(), preds_.end(), i), i);
+      }
+      flock_[i]              = flock_[last];
+      index_[flock_[i].id()] = i;
+    }
+    flock_.pop_back();
+    index_[id] = -1;
+    ++removed;
+  }
+  assert(removed == n_present);
+  return removed;
+}
+
+double Flock::advance(Parameters const& pars, Observables* observables,
+                      double max_d_t)
+{
+  assert(this->size() > 1);
+  assert(max_d_t > 0.);
+  double const d_t0{nominal_d_t(pars)};
+  double d_t{std::min(d_t0, max_d_t)};
+  bool const observe{observables != nullptr && !observables->empty()};
+
+  // a specialized kernel, if one matches pars, takes the place of the generic
+  // evolution below (optional features are only available with the latter)
+  assert(pars.get_cell_list() >= 0);
+  if (!observe && !pars.get_sleeping() && !pars.get_approximate()
+      && pars.get_cell_list() == 0 && !pars.get_tiled()
+      && obstacles_.empty()) {
+    if (auto const d_t_used{specialized_evolve(flock_, pars, max_d_t)}) {
+      updates_ += size();
+      active_updates_ += size();
+      return *d_t_used;
+    }
+  }
+
+  // a grid is needed by the sleeping boids' detection, by the observables'
+  // nearest boids searches, by the approximate rules, whose cells' sums pay
+  // off with cells smaller than d, and by the cell list's searches (cell_list
+  // cells per interaction distance), unless the approximate rules are used
+  bool const cell_list{pars.get_cell_list() > 0 && !pars.get_approximate()};
+  bool const use_grid{pars.get_sleeping() || pars.get_approximate()
+                      || observe || cell_list};
+  double constexpr cells_per_d{4.};
+  Grid const grid{(use_grid) ? flock_ : std::vector<Boid>{},
+                  (pars.get_approximate())
+                      ? pars.get_d() / cells_per_d
+                      : interaction_distance(pars)
+                            / std::max(pars.get_cell_list(), 1),
+                  pars.get_x_min(),
+                  pars.get_x_max(),
+                  pars.get_y_min(),
+                  pars.get_y_max()};
+  std::vector<bool> active(flock_.size(), true);
+  if (pars.get_sleeping()) {
+    active = active_boids(flock_, grid, pars);
+    // boids near an obstacle are steered away from it
+    for (int i{0}, N{size()}; i != N; ++i) {
+      obstacles_.for_each_near(
+          flock_[i].position(), pars.get_d_s_pred(), [&](Obstacle const& o) {
+            active[i] = active[i]
+                     || distance(o, flock_[i].position()) < pars.get_d_s_pred();
+          });
+    }
+  }
+  std::vector<Cell_sums> sums{};
+  if (pars.get_approximate()) {
+    sums = cell_sums(flock_, grid);
+  }
+
+  // flying rules are applied to active boids only (a sleeping boid would get a
+  // null velocity change anyway)
+  std::vector<Velocity> d_vs(flock_.size(), Velocity{0., 0.});
+  // the nearest boids sampled for the observables are searched along with
+  // the rules' neighbours (by a pass of their own with the tiled kernel), the
+  // samples fed to them in the integration pass
+  std::vector<Nearest> near(observe ? flock_.size() : 0);
+  // the tiled kernel sweeps the whole flock block by block of boids. Otherwise,
+  // the work per boid varies by orders of magnitude between clustered and
+  // isolated boids: chunks of boids are rather handed out to threads as they
+  // get idle (and, after reordering, a chunk is a patch of space)
+  bool const tiled{pars.get_tiled() && !pars.get_approximate() && !cell_list};
+  if (tiled) {
+    tiled_delta_vs(flock_, active, obstacles_, pars, d_vs);
+  }
+  if (!tiled || observe) {
+    int constexpr chunk_size{32};
+    parallel_for(
+        size(), chunk_size, pars.get_threads(),
+        (pars.get_work_stealing()) ? Partition::work_stealing
+                                   : Partition::static_chunks,
+        [&](int begin, int end) {
+          for (int i{begin}; i != end; ++i) {
+            if (observe) {
+              near[i] = nearest(flock_, i, grid);
+            }
+            if (tiled) {
+              continue;
+            }
+            if (active[i]) {
+              if (pars.get_approximate()) {
+                d_vs[i] = approx_delta_v(flock_[i], pars, grid, sums);
+              } else if (cell_list) {
+                d_vs[i] = cell_delta_v(flock_[i], pars, grid);
+              } else {
+                d_vs[i] = delta_v(flock_[i], pars);
+              }
+            }
+          }
+        });
+  }
+  double scale{1.};
+  if (pars.get_adaptive_step()) {
+    // velocity changes refer to the nominal step
+    d_t   = std::min(adaptive_d_t(flock_, d_vs, pars), max_d_t);
+    scale = d_t / d_t0;
+  }
+
+  // all boids are integrated in a single pass, then sleeping ones are put back
+  std::vector<Boid> state_f{flock_};
+  if (scale != 1.) {
+    for (Velocity& d_v : d_vs) {
+      d_v *= scale;
+    }
+  }
+  integrate(state_f, d_vs, d_t, pars.get_x_min(), pars.get_x_max(),
+            pars.get_y_min(), pars.get_y_max(), pars.get_min_speed(),
+            pars.get_max_speed());
+  std::vector<int> sleeping{};
+  if (observe) {
+    observables->reset();
+  }
+  for (int i{0}, N{size()}; i != N; ++i) {
+    if (!active[i]) {
+      state_f[i] = flock_[i];
+      sleeping.push_back(i);
+    }
+    if (observe) {
+      observables->add({flock_[i], norm(flock_[i].velocity()),
+                        near[i].nn_dist, near[i].prey_dist});
+    }
+  }
+  // sleeping boids just move straight, unless they got close to a border: then
+  // they are woken and bound_position applies
+  int woken{0};
+  for (int i : sleeping) {
+    Boid& boid{state_f[i]};
+    boid.position() += flock_[i].velocity() * d_t;
+    if (near_border(boid.position(), pars)) {
+      bound_position(boid, pars.get_x_min(), pars.get_x_max(), pars.get_y_min(),
+                     pars.get_y_max());
+      normalize(boid.velocity(), pars.get_min_speed(), pars.get_max_speed());
+      ++woken;
+    }
+  }
+  updates_ += size();
+  active_updates_ += size() - static_cast<int>(sleeping.size()) + woken;
+
   // asserting that vectors have same size, that boids' is_pred attribute is
   // unchanged for all and that order was left unaltered
   assert(flock_.size() == state_f.size());
@@ -239,10 +914,11 @@ void Flock::evolve(Parameters const& pars)
                     [](Boid const& b1, Boid const& b2) {
                       return (b1.is_pred() == b2.is_pred());
                     }));
-  // overwriting only when all new states have been calculated (instead of using
-  // flock_ as the output range in std::transform) to prevent an old boid's
-  // state from being calculated with an already updated boid
+  // overwriting only when all new states have been calculated (instead of
+  // writing them directly into flock_) to prevent an old boid's state from
+  // being calculated with an already updated boid
   flock_ = state_f;
+  return d_t;
 }
 
 // fills empty vector with N_boids with randomly generated positions and
@@ -285,16 +961,90 @@ std::vector<Boid>& fill(std::vector<Boid>& boids, Parameters const& pars,
 }
 
 #ifndef GRAPHICS
-// evolves flock for [steps] times and saves state of the flock in a vector
-// every [prescale] steps
-std::vector<std::vector<Boid>>& simulate(Flock& flock, Parameters const& pars,
-                                         std::vector<std::vector<Boid>>& states)
-{
-  for (int step = 0; step != pars.get_steps(); ++step) {
-    if (step % pars.get_prescale() == 0) {
-      states.push_back(flock.state());
+// evolves flock for [steps] times and saves state of the flock in a store
+// every [prescale] steps. With an adaptive time step the flock is instead
+// evolved until [duration] is reached, saving its state every [prescale]
+// nominal steps of simulated time
+Snapshot_store& simulate(Flock& flock, Parameters const& pars,
+                         Snapshot_store& states)
+{
+  Observables none{};
+  return simulate(flock, pars, states, none);
+}
+
+// same as above, saving with each state the results of observables (fed during
+// the evolution starting from that state) and passing it to on_save, if any.
+// on_step, if any, is called after every evolution. With a convergence monitor
+// the simulation stops early, after the evolution from the first state at
+// which the monitor declares the run converged
+Snapshot_store& simulate(Flock& flock, Parameters const& pars,
+                         Snapshot_store& states, Observables& observables,
+                         Snapshot_callback const& on_save,
+                         Step_callback const& on_step,
+                         Convergence* convergence)
+{
+  assert(convergence == nullptr || !observables.empty());
+  double const d_t0{nominal_d_t(pars)};
+  // a snapshot is completed after the evolution from its state, then stored
+  // (its vectors being reused from one snapshot to the next)
+  Snapshot snapshot{0., d_t0, {}, {}};
+  bool converged{false};
+
+  if (!pars.get_adaptive_step()) {
+    for (int step = 0; step != pars.get_steps() && !converged; ++step) {
+      if (step % pars.get_prescale() == 0) {
+        snapshot.time  = step * d_t0;
+        snapshot.state = flock.state();
+        flock.evolve(pars, observables);
+        snapshot.observations = observables.results();
+        states.push_back(snapshot);
+        if (on_save) {
+          on_save(snapshot);
+        }
+        converged = convergence != nullptr
+                 && convergence->add(snapshot.observations, step,
+                                     snapshot.time);
+      } else {
+        flock.evolve(pars);
+      }
+      if (on_step) {
+        on_step(flock);
+      }
+    }
+    return states;
+  }
+
+  double const interval{pars.get_prescale() * d_t0};
+  // tolerance on time comparisons, absorbing rounding in the sum of the steps
+  double const eps{1e-9 * d_t0};
+  double time{0.};
+  double next_save{0.};
+  int step{0};
+  for (; time < pars.get_duration() - eps && !converged; ++step) {
+    bool const save{time >= next_save - eps};
+    if (save) {
+      snapshot.time  = time;
+      snapshot.state = flock.state();
+      next_save += interval;
+    }
+    // steps are cut short so that states are saved at the exact times
+    double const max_d_t{std::min(next_save, pars.get_duration()) - time};
+    double const d_t{(save) ? flock.evolve(pars, observables, max_d_t)
+                            : flock.evolve(pars, max_d_t)};
+    if (save) {
+      snapshot.d_t          = d_t;
+      snapshot.observations = observables.results();
+      states.push_back(snapshot);
+      if (on_save) {
+        on_save(snapshot);
+      }
+      converged = convergence != nullptr
+               && convergence->add(snapshot.observations, step, snapshot.time);
+    }
+    time += d_t;
+    if (on_step) {
+      on_step(flock);
     }
-    flock.evolve(pars);
   }
 
   return states;
@@ -1,16 +1,66 @@
 #ifndef FLOCK_HPP
 #define FLOCK_HPP
 #include "boids.hpp"
+#include "grid.hpp"
+#include "observables.hpp"
+#include "obstacles.hpp"
 #include "parameters.hpp"
+#include "snapshots.hpp"
+#include <functional>
+#include <limits>
 #include <vector>
 
-// defining class Flock, declaring flocks' flying rules, declaring functions
-// fill and simulate
+// defining class Flock, declaring flocks' flying rules,
+// declaring functions fill and simulate
+
+// sums over the regular boids of a grid's cell, with their bounding box
+struct Cell_sums
+{
+  int n{0};
+  Position sum_p{0., 0.};
+  Velocity sum_v{0., 0.};
+  Position p_min{0., 0.};
+  Position p_max{0., 0.};
+};
+
+// sums over the neighbours of a regular boid (boid itself included), all that
+// alignment and cohesion need
+struct Nbr_sums
+{
+  int n{0};
+  Position sum_p{0., 0.};
+  Velocity sum_v{0., 0.};
+};
 
 class Flock
 {
   std::vector<Boid> flock_;
-  Boid solve(Boid const& boid, Parameters const& pars) const;
+  // boids' updates performed so far, and how many of them were full updates
+  // (i.e. not the straight motion of a sleeping boid)
+  long updates_{0};
+  long active_updates_{0};
+  // evolutions performed so far (drives the periodic reordering) and id to be
+  // given to the next boid pushed back
+  long evolutions_{0};
+  int next_id_{0};
+  // kept up to date by every change of the population: indices of the
+  // predators (in ascending order) and index of every boid by id (-1 once the
+  // boid is removed)
+  std::vector<int> preds_;
+  std::vector<int> index_;
+  Obstacles obstacles_; // avoided by every boid
+  void append(Boid const& boid);
+  void index();
+  Velocity delta_v(Boid const& boid, Parameters const& pars) const;
+  Velocity cell_delta_v(Boid const& boid, Parameters const& pars,
+                        Grid const& grid) const;
+  Velocity approx_delta_v(Boid const& boid, Parameters const& pars,
+                          Grid const& grid,
+                          std::vector<Cell_sums> const& sums) const;
+  double advance(Parameters const& pars, Observables* observables,
+                 double max_d_t);
+  double evolve(Parameters const& pars, Observables* observables,
+                double max_d_t);
 
  public:
   explicit Flock(std::vector<Boid> const& flock)
@@ -18,19 +68,61 @@ class Flock
   {
     // parameter N_boids was verified by the constructor of Parameters to be > 1
     assert(flock_.size() > 1);
+    // boids are identified by their place in the initial state
+    for (int i{0}; i != size(); ++i) flock_[i].id() = i;
+    next_id_ = size();
+    index();
   }
   // clang-format off
   bool empty() const{ return flock_.empty(); }
   //NB not risking narrowing with int as return type since parameter N_boids is an int
   int size() const { return flock_.size(); }
   std::vector<Boid> const& state() const { return flock_; }
+  double active_fraction() const
+  {
+    return (updates_ == 0) ? 1.
+                           : static_cast<double>(active_updates_) / updates_;
+  }
+  std::vector<int> const& predator_indices() const { return preds_; }
+  Obstacles const& obstacles() const { return obstacles_; }
+  void set_obstacles(Obstacles obstacles)
+  {
+    obstacles_ = std::move(obstacles);
+  }
+  // index in the state of the boid with the id given, -1 if it's not there
+  int index_of(int id) const
+  {
+    return (id >= 0 && id < next_id_) ? index_[id] : -1;
+  }
   void push_back(Boid const& boid) 
   {
     assert (!empty());
-    flock_.push_back(boid);
+    append(boid);
   }
-  void evolve(Parameters const& pars);
   // clang-format on
+  // appends boids, giving them new ids
+  void insert(std::vector<Boid> const& boids);
+  // removes the boids with the ids given, moving the last boid of the state
+  // into the place of each one removed (ids not in the flock are ignored).
+  // Returns the number of boids removed; throws, removing none, if fewer than
+  // two boids would be left
+  int remove(std::vector<int> const& ids);
+  // sorts boids along a Morton (Z-order) curve, so that boids close in space
+  // are close in memory too; ids are left untouched
+  void reorder();
+  // evolves the flock by one step (never longer than max_d_t) and returns the
+  // time step that was used
+  double evolve(Parameters const& pars,
+                double max_d_t = std::numeric_limits<double>::infinity());
+  // same as above, feeding observables with every boid of the state being
+  // evolved
+  double evolve(Parameters const& pars, Observables& observables,
+                double max_d_t = std::numeric_limits<double>::infinity());
+  // evolves the flock by one step of d_t with the reference implementation:
+  // the flying rules scanning the whole flock, then every boid moved, bound
+  // and normalized by itself, serially. Slow: meant to verify evolve's faster
+  // paths (see verify.hpp)
+  void reference_evolve(Parameters const& pars, double d_t);
 };
 
 // flying rules' auxiliary functions
@@ -39,10 +131,21 @@ std::vector<Boid>& neighbours(Boid const& boid, Flock const& flock,
 std::vector<Boid>& predators(Boid const& boid, Flock const& flock,
                              std::vector<Boid>& preds, double angle,
                              double d_s_pred);
+// same as above, looking among candidates (e.g. the boids near boid) only
+std::vector<Boid>& neighbours(Boid const& boid,
+                              std::vector<Boid> const& candidates,
+                              std::vector<Boid>& nbrs, double angle, double d);
+std::vector<Boid>& predators(Boid const& boid,
+                             std::vector<Boid> const& candidates,
+                             std::vector<Boid>& preds, double angle,
+                             double d_s_pred);
 std::vector<Boid>& competitors(Boid const& boid, Flock const& flock,
                                std::vector<Boid>& competitors, double angle,
                                double d_s);
 Boid const& find_prey(Boid const& boid, Flock const& flock, double angle);
+double interaction_distance(Parameters const& pars);
+std::vector<bool> active_boids(std::vector<Boid> const& state,
+                               Grid const& grid, Parameters const& pars);
 
 // flying rules' functions
 Velocity separation(Boid const& boid, Flock const& flock,
@@ -51,12 +154,48 @@ Velocity alignment(Boid const& boid, Flock const& flock,
                    Parameters const& pars);
 Velocity cohesion(Boid const& boid, Flock const& flock, Parameters const& pars);
 Velocity seek(Boid const& boid, Flock const& flock, Parameters const& pars);
+Velocity avoidance(Boid const& boid, Obstacles const& obstacles,
+                   Parameters const& pars);
+// regular boids' rules, from the boids found by the searches above
+Velocity separation(Boid const& boid, std::vector<Boid> const& close_nbrs,
+                    std::vector<Boid> const& preds, Parameters const& pars);
+Velocity alignment(Boid const& boid, std::vector<Boid> const& nbrs,
+                   Parameters const& pars);
+Velocity cohesion(Boid const& boid, std::vector<Boid> const& nbrs,
+                  Parameters const& pars);
+
+// approximate flying rules, using a grid and its cells' sums
+std::vector<Cell_sums> cell_sums(std::vector<Boid> const& state,
+                                 Grid const& grid);
+Nbr_sums neighbour_sums(Boid const& boid, std::vector<Boid> const& state,
+                        Grid const& grid, std::vector<Cell_sums> const& sums,
+                        Parameters const& pars);
+Velocity separation(Boid const& boid, std::vector<Boid> const& state,
+                    Grid const& grid, Parameters const& pars);
+Velocity alignment(Boid const& boid, Nbr_sums const& nbrs,
+                   Parameters const& pars);
+Velocity cohesion(Boid const& boid, Nbr_sums const& nbrs,
+                  Parameters const& pars);
+
+// time step functions
+double nominal_d_t(Parameters const& pars);
+double adaptive_d_t(std::vector<Boid> const& state,
+                    std::vector<Velocity> const& d_vs, Parameters const& pars);
 
 std::vector<Boid>& fill(std::vector<Boid>& boids, Parameters const& pars,
                         unsigned int seed);
 
-std::vector<std::vector<Boid>>&
-simulate(Flock& flock, Parameters const& pars,
-         std::vector<std::vector<Boid>>& states);
+// called by simulate with every snapshot, as soon as it's stored, and with the
+// flock after every evolution
+using Snapshot_callback = std::function<void(Snapshot const&)>;
+using Step_callback     = std::function<void(Flock const&)>;
+
+Snapshot_store& simulate(Flock& flock, Parameters const& pars,
+                         Snapshot_store& states);
+Snapshot_store& simulate(Flock& flock, Parameters const& pars,
+                         Snapshot_store& states, Observables& observables,
+                         Snapshot_callback const& on_save = nullptr,
+                         Step_callback const& on_step     = nullptr,
+                         Convergence* convergence         = nullptr);
 
 #endif
@@ -1,8 +1,12 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "flock.hpp"
 #include "doctest.h"
+#include "kernels.hpp"
 #include "parameters.hpp"
+#include "tiled.hpp"
+#include <numeric>
 #include <random>
+#include <stdexcept>
 
 TEST_CASE("testing rules' auxiliary functions")
 {
@@ -282,7 +286,7 @@ TEST_CASE("Testing evolve")
   }
 
   SUBCASE("5 regulars (no neighbours), 2 go out of grid after evolution")
-  { // testing that bound_position is applied within solve when evolve is called
+  { // testing that bound_position is applied when evolve is called
     b1.velocity() = {-1., 1.}; // b1 will cross x_min and get too close to y_min
     Boid b5{{4., .1}, {0., -15.}}; // b5 will cross y_min
     std::vector<Boid> boids{b1, b2, b3, b4, b5};
@@ -301,7 +305,7 @@ TEST_CASE("Testing evolve")
 
   SUBCASE("4 regulars (no neighbours), one crosses x_min and its speed breaks "
           "limits")
-  { // testing that normalize is applied, after bound_position, within solve
+  { // testing that normalize is applied, after bound_position
     // when evolve is called
     b4.position() = {.001, 5.};
     b4.velocity() = {-3., 4.};
@@ -727,6 +731,330 @@ TEST_CASE("Testing evolve")
   }
 }
 
+TEST_CASE("Testing sleeping boids")
+{
+  Parameters pars{300.,    3.,  1.,   2., .5,   1., 100.,
+                  .000005, 30., 3000, 60, 3000, 100};
+  // interaction distance is d_s_pred = 7.
+  CHECK(interaction_distance(pars) == doctest::Approx(7.));
+  Boid b1{{50., 50.}, {1., 1.}};
+  Boid b2{{55., 50.}, {-1., 0.}};  // close to b1
+  Boid b3{{20., 20.}, {0., 2.}};   // isolated
+  Boid b4{{20., 80.}, {0., 200.}}; // isolated, speed above the limit
+  Boid b5_p{{80., 80.}, {1., 0.}, true};
+  Boid b6{{80., 74.}, {1., 0.}}; // close to a predator only
+
+  SUBCASE("testing active_boids")
+  {
+    std::vector<Boid> state{b1, b2, b3, b4, b5_p, b6};
+    Grid grid{state,            interaction_distance(pars),
+              pars.get_x_min(), pars.get_x_max(),
+              pars.get_y_min(), pars.get_y_max()};
+    auto active{active_boids(state, grid, pars)};
+    CHECK(active == std::vector<bool>{true, true, false, true, true, true});
+  }
+
+  SUBCASE("sleeping boids evolve exactly as active ones")
+  {
+    b3.position() = {20., 1.6}; // will get close to y_min
+    std::vector<Boid> boids{b1, b2, b3, b4, b5_p, b6};
+    Flock flock{boids};
+    Flock flock_s{boids};
+    Parameters pars_s{pars};
+    pars_s.set_sleeping() = true;
+    for (int i{0}; i != 10; ++i) {
+      flock.evolve(pars);
+      flock_s.evolve(pars_s);
+    }
+    for (int i{0}; i != 6; ++i) {
+      CHECK(flock.state()[i].position() == flock_s.state()[i].position());
+      CHECK(flock.state()[i].velocity() == flock_s.state()[i].velocity());
+    }
+    CHECK(flock.active_fraction() == 1.);
+    CHECK(flock_s.active_fraction() < 1.);
+    CHECK(flock_s.active_fraction() > .5);
+  }
+
+  SUBCASE("random flock")
+  {
+    Parameters pars_r{300.,    3.,  1.,   2., .5,   1., 100.,
+                      .000005, 30., 3000, 60, 3000, 200};
+    std::vector<Boid> boids{};
+    fill(boids, pars_r, 42);
+    Flock flock{boids};
+    Flock flock_s{boids};
+    Parameters pars_s{pars_r};
+    pars_s.set_sleeping() = true;
+    for (int i{0}; i != 20; ++i) {
+      flock.evolve(pars_r);
+      flock_s.evolve(pars_s);
+    }
+    CHECK(std::equal(flock.state().begin(), flock.state().end(),
+                     flock_s.state().begin(),
+                     [](Boid const& b1, Boid const& b2) {
+                       return b1.position() == b2.position()
+                           && b1.velocity() == b2.velocity();
+                     }));
+  }
+}
+
+TEST_CASE("Testing cell list")
+{
+  Parameters pars{300.,    3.,  1.,   2., .5,   1., 100.,
+                  .000005, 30., 3000, 60, 3000, 300};
+  std::vector<Boid> boids{};
+  fill(boids, pars, 21);
+  boids.push_back(Boid{{50., 50.}, {10., 0.}, true});
+  boids.push_back(Boid{{52., 49.}, {0., 10.}, true});
+  Flock flock{boids};
+  for (int i{0}; i != 10; ++i) {
+    flock.evolve(pars);
+  }
+
+  // the neighbours found in the cells near a boid are those of a scan of the
+  // whole flock, whatever the cells' side: evolutions are the very same
+  for (int cells : {1, 2, 3}) {
+    for (bool sleeping : {false, true}) {
+      Parameters pars_c{pars};
+      pars_c.set_cell_list() = cells;
+      pars_c.set_sleeping()  = sleeping;
+      pars_c.set_threads()   = 2;
+      Flock flock_c{boids};
+      for (int i{0}; i != 10; ++i) {
+        flock_c.evolve(pars_c);
+      }
+      CHECK(std::equal(flock.state().begin(), flock.state().end(),
+                       flock_c.state().begin(),
+                       [](Boid const& b1, Boid const& b2) {
+                         return b1.position() == b2.position()
+                             && b1.velocity() == b2.velocity();
+                       }));
+    }
+  }
+}
+
+TEST_CASE("Testing approximate rules")
+{
+  // dense flock, so that many cells lie entirely within distance and sight
+  Parameters const pars{300.,    20., 2.,   1., .5,   .8, 100.,
+                        .000005, 30., 3000, 60, 3000, 1500};
+  std::vector<Boid> boids{};
+  fill(boids, pars, 7);
+  boids.push_back(Boid{{50., 50.}, {10., 0.}, true});
+  boids.push_back(Boid{{20., 70.}, {0., -10.}, true});
+  Flock flock{boids};
+  Grid grid{boids,            pars.get_d() / 4., pars.get_x_min(),
+            pars.get_x_max(), pars.get_y_min(),  pars.get_y_max()};
+  auto const sums{cell_sums(boids, grid)};
+
+  SUBCASE("testing cell_sums")
+  {
+    CHECK(std::accumulate(sums.begin(), sums.end(), 0,
+                          [](int n, Cell_sums const& cell) {
+                            return n + cell.n;
+                          })
+          == 1500);
+    Cell_sums const& cell{sums[grid.cell(boids[0].position())]};
+    CHECK(cell.n >= 1);
+    CHECK(cell.p_min.x() <= boids[0].position().x());
+    CHECK(cell.p_max.y() >= boids[0].position().y());
+  }
+
+  SUBCASE("approximate rules agree with exact ones")
+  {
+    for (Boid const& boid : flock.state()) {
+      if (boid.is_pred()) {
+        continue;
+      }
+      Nbr_sums const nbrs{
+          neighbour_sums(boid, flock.state(), grid, sums, pars)};
+      std::vector<Boid> exact_nbrs{};
+      neighbours(boid, flock, exact_nbrs, pars.get_angle(), pars.get_d());
+      CHECK(nbrs.n == static_cast<int>(exact_nbrs.size()));
+
+      Velocity const align{alignment(boid, nbrs, pars)};
+      Velocity const align_exact{alignment(boid, flock, pars)};
+      CHECK(align.x() == doctest::Approx(align_exact.x()).epsilon(1e-9));
+      CHECK(align.y() == doctest::Approx(align_exact.y()).epsilon(1e-9));
+      Velocity const coh{cohesion(boid, nbrs, pars)};
+      Velocity const coh_exact{cohesion(boid, flock, pars)};
+      CHECK(coh.x() == doctest::Approx(coh_exact.x()).epsilon(1e-9));
+      CHECK(coh.y() == doctest::Approx(coh_exact.y()).epsilon(1e-9));
+      Velocity const sep{separation(boid, flock.state(), grid, pars)};
+      Velocity const sep_exact{separation(boid, flock, pars)};
+      CHECK(sep.x() == doctest::Approx(sep_exact.x()).epsilon(1e-9));
+      CHECK(sep.y() == doctest::Approx(sep_exact.y()).epsilon(1e-9));
+    }
+  }
+
+  SUBCASE("approximate evolution stays close to the exact one")
+  {
+    Flock flock_a{boids};
+    Parameters pars_a{pars};
+    pars_a.set_approximate() = true;
+    for (int i{0}; i != 5; ++i) {
+      flock.evolve(pars);
+      flock_a.evolve(pars_a);
+    }
+    for (int i{0}, N{flock.size()}; i != N; ++i) {
+      CHECK(flock_a.state()[i].position().x()
+            == doctest::Approx(flock.state()[i].position().x()).epsilon(1e-6));
+      CHECK(flock_a.state()[i].velocity().y()
+            == doctest::Approx(flock.state()[i].velocity().y()).epsilon(1e-6));
+    }
+  }
+}
+
+TEST_CASE("Testing specialized kernels")
+{
+  // default parameters of boids match Headless_preset
+  Parameters pars{300.,  35., 3.5,  .7, .045, .8, 80.,
+                  .05,   30., 3000, 40, 3000, 300};
+  pars.set_specialized() = true;
+  Parameters pars_generic{pars};
+  pars_generic.set_specialized() = false;
+  CHECK(matches<Headless_preset>(pars));
+  CHECK_FALSE(matches<Sfml_preset>(pars));
+  CHECK_FALSE(matches<Headless_preset>(Parameters{
+      300., 35., 3.5, .7, .045, .8, 80., .06, 30., 3000, 40, 3000, 300}));
+
+  std::vector<Boid> boids{};
+  fill(boids, pars, 5);
+  boids.push_back(Boid{{50., 50.}, {10., 0.}, true});
+  boids.push_back(Boid{{52., 50.}, {0., 10.}, true});
+  boids.push_back(Boid{{5., 5.}, {-10., 0.}, true}); // preys in corner
+
+  SUBCASE("dispatcher")
+  {
+    std::vector<Boid> state{boids};
+    CHECK(specialized_evolve(state, pars, 1.).has_value());
+    CHECK_FALSE(specialized_evolve(state, pars_generic, 1.).has_value());
+    CHECK_FALSE(specialized_evolve(
+                    state,
+                    Parameters{301., 35., 3.5, .7, .045, .8, 80., .05, 30.,
+                               3000, 40, 3000, 300},
+                    1.)
+                    .has_value());
+  }
+
+  SUBCASE("velocity changes agree with flying rules")
+  {
+    Flock flock{boids};
+    for (Boid const& boid : boids) {
+      Velocity const d_v{
+          (boid.is_pred())
+              ? predator_delta_v<Headless_preset>(boid, boids, pars)
+              : regular_delta_v<Headless_preset>(boid, boids)};
+      Velocity const expected{
+          (boid.is_pred())
+              ? separation(boid, flock, pars) + seek(boid, flock, pars)
+              : separation(boid, flock, pars) + alignment(boid, flock, pars)
+                    + cohesion(boid, flock, pars)};
+      CHECK(d_v.x() == doctest::Approx(expected.x()).epsilon(1e-9));
+      CHECK(d_v.y() == doctest::Approx(expected.y()).epsilon(1e-9));
+    }
+  }
+
+  SUBCASE("evolutions agree with the generic one")
+  {
+    for (bool adaptive : {false, true}) {
+      pars.set_adaptive_step()         = adaptive;
+      pars_generic.set_adaptive_step() = adaptive;
+      Flock flock{boids};
+      Flock flock_g{boids};
+      for (int i{0}; i != 5; ++i) {
+        CHECK(flock.evolve(pars)
+              == doctest::Approx(flock_g.evolve(pars_generic)));
+      }
+      for (int i{0}, N{flock.size()}; i != N; ++i) {
+        CHECK(flock.state()[i].position().x()
+              == doctest::Approx(flock_g.state()[i].position().x()));
+        CHECK(flock.state()[i].position().y()
+              == doctest::Approx(flock_g.state()[i].position().y()));
+        CHECK(flock.state()[i].velocity().x()
+              == doctest::Approx(flock_g.state()[i].velocity().x()));
+        CHECK(flock.state()[i].velocity().y()
+              == doctest::Approx(flock_g.state()[i].velocity().y()));
+      }
+    }
+  }
+}
+
+TEST_CASE("Testing tiled kernel")
+{
+  // more boids than a tile's sources, not a whole number of target blocks
+  Parameters pars{300.,  35., 3.5,  .7, .045, .8, 80.,
+                  .05,   30., 3000, 40, 3000, 600};
+  std::vector<Boid> boids{};
+  fill(boids, pars, 9);
+  boids.push_back(Boid{{50., 50.}, {10., 0.}, true});
+  boids.push_back(Boid{{52., 50.}, {0., 10.}, true});
+  boids.push_back(Boid{{5., 5.}, {-10., 0.}, true}); // preys in corner
+  boids.push_back(boids[7]); // in the same place as another boid
+  REQUIRE(static_cast<int>(boids.size()) > tile_sources);
+  REQUIRE(boids.size() % tile_targets != 0);
+
+  SUBCASE("velocity changes agree with flying rules")
+  {
+    Flock flock{boids};
+    flock.set_obstacles(Obstacles{{Obstacle{{40., 40.}, {40., 60.}, 2.}}});
+    std::vector<bool> active(boids.size(), true);
+    active[3] = false;
+    std::vector<Velocity> d_vs(boids.size(), Velocity{0., 0.});
+    pars.set_threads() = 3;
+    tiled_delta_vs(boids, active, flock.obstacles(), pars, d_vs);
+    CHECK(d_vs[3] == Velocity{0., 0.});
+    for (int i{0}, N{flock.size()}; i != N; ++i) {
+      if (!active[i]) {
+        continue;
+      }
+      Boid const& boid{boids[i]};
+      Velocity const expected{
+          ((boid.is_pred())
+               ? separation(boid, flock, pars) + seek(boid, flock, pars)
+               : separation(boid, flock, pars) + alignment(boid, flock, pars)
+                     + cohesion(boid, flock, pars))
+          + avoidance(boid, flock.obstacles(), pars)};
+      CHECK(d_vs[i].x() == doctest::Approx(expected.x()).epsilon(1e-9));
+      CHECK(d_vs[i].y() == doctest::Approx(expected.y()).epsilon(1e-9));
+    }
+  }
+
+  SUBCASE("evolutions agree with the generic one, whatever the threads")
+  {
+    Parameters pars_t{pars};
+    pars_t.set_tiled()       = true;
+    pars_t.set_sleeping()    = true;
+    pars.set_specialized()   = false;
+    pars.set_sleeping()      = true;
+    Flock flock{boids};
+    Flock flock_t{boids};
+    for (int i{0}; i != 5; ++i) {
+      flock.evolve(pars);
+      flock_t.evolve(pars_t);
+    }
+    for (int i{0}, N{flock.size()}; i != N; ++i) {
+      CHECK(flock_t.state()[i].position().x()
+            == doctest::Approx(flock.state()[i].position().x()));
+      CHECK(flock_t.state()[i].velocity().y()
+            == doctest::Approx(flock.state()[i].velocity().y()));
+    }
+
+    // a target's sums are taken in the same order by any thread
+    pars_t.set_threads() = 4;
+    Flock threaded{boids};
+    for (int i{0}; i != 5; ++i) {
+      threaded.evolve(pars_t);
+    }
+    CHECK(std::equal(flock_t.state().begin(), flock_t.state().end(),
+                     threaded.state().begin(),
+                     [](Boid const& b1, Boid const& b2) {
+                       return b1.position() == b2.position()
+                           && b1.velocity() == b2.velocity();
+                     }));
+  }
+}
+
 TEST_CASE("Testing simulate")
 {
   Parameters const pars{90.,     5.,  2., 1., 1., 1., 100,
@@ -735,7 +1063,7 @@ TEST_CASE("Testing simulate")
   Boid b1{{5., 2.}, {1., 0.}};
   Boid b2_p{{30., 2.}, {0., 1.}, true};
   Flock flock{std::vector<Boid>{b1, b2_p}};
-  std::vector<std::vector<Boid>> states{};
+  Snapshot_store states{};
   simulate(flock, pars, states);
 
   // checking flock evolved 10 times by confronting final positions
@@ -743,6 +1071,451 @@ TEST_CASE("Testing simulate")
   CHECK(flock.state()[1].position() == Position{30., 12.});
   // checking state was saved for 5 times
   CHECK(states.size() == 5u);
+  // checking times and time steps saved with the states
+  CHECK(states[0].time == 0.);
+  CHECK(states[4].time == doctest::Approx(8.));
+  CHECK(states[2].d_t == doctest::Approx(1.));
+  CHECK(states[2].state[0].position() == Position{9., 2.});
+
+  SUBCASE("adaptive time step")
+  {
+    Parameters pars_a{pars};
+    pars_a.set_adaptive_step() = true;
+    Flock flock_a{std::vector<Boid>{b1, b2_p}};
+    Snapshot_store states_a{};
+    simulate(flock_a, pars_a, states_a);
+
+    // no rule acts on the two boids, but the gain of separation from
+    // predators (10.5) keeps steps to their minimum, a tenth of the nominal
+    // one, and states are saved every 2 units of time
+    CHECK(states_a.size() == 5u);
+    CHECK(states_a[0].time == 0.);
+    CHECK(states_a[1].time == doctest::Approx(2.));
+    CHECK(states_a[4].time == doctest::Approx(8.));
+    CHECK(states_a[3].d_t == doctest::Approx(.1));
+    // the whole duration has been simulated anyway
+    CHECK(flock_a.state()[0].position().x() == doctest::Approx(15.));
+    CHECK(flock_a.state()[1].position().y() == doctest::Approx(12.));
+  }
+
+  SUBCASE("early stop on convergence")
+  {
+    // the boids' speeds never change: the run converges as soon as the
+    // window is full, at the third state (step 4)
+    Flock flock_c{std::vector<Boid>{b1, b2_p}};
+    Snapshot_store states_c{};
+    Observables speed{};
+    speed.add(std::make_unique<Speed>());
+    Convergence convergence{3, .01};
+    simulate(flock_c, pars, states_c, speed, nullptr, nullptr, &convergence);
+    CHECK(convergence.converged());
+    CHECK(convergence.step() == 4);
+    CHECK(convergence.time() == doctest::Approx(4.));
+    CHECK(states_c.size() == 3u);
+    // the evolution from the last state saved was completed
+    CHECK(flock_c.state()[0].position() == Position{10., 2.});
+  }
+}
+
+TEST_CASE("Testing adaptive time step")
+{
+  Parameters pars{300.,    3.,  1.,   2., .5,   1., 100.,
+                  .000005, 30., 3000, 60, 3000, 100};
+  // rules weak enough not to limit the step
+  Parameters weak{300.,    3.,  1.,   .05, .05,  .05, 100.,
+                  .000005, 30., 3000, 60,  3000, 100};
+  double const d_t0{nominal_d_t(pars)};
+  CHECK(d_t0 == doctest::Approx(.01));
+
+  Boid b1{{50., 50.}, {1., 0.}};
+  Boid b2{{60., 50.}, {0., 2.}};
+  Boid b3_p{{70., 50.}, {0., 20.}, true};
+
+  SUBCASE("no velocity change: step limited by the largest rule's gain")
+  {
+    std::vector<Boid> state{b1, b2};
+    std::vector<Velocity> d_vs{{0., 0.}, {0., 0.}};
+    // separation's gain, s = 2
+    CHECK(adaptive_d_t(state, d_vs, pars) == doctest::Approx(.45 * d_t0));
+    // separation from predators counts only if there are any
+    state.push_back(b3_p);
+    d_vs.push_back({0., 0.});
+    CHECK(adaptive_d_t(state, d_vs, pars) == doctest::Approx(.1 * d_t0));
+  }
+
+  SUBCASE("weak rules, slow boids, no velocity change: step grows up to its "
+          "maximum")
+  {
+    std::vector<Boid> state{b1, b2};
+    std::vector<Velocity> d_vs{{0., 0.}, {0., 0.}};
+    CHECK(adaptive_d_t(state, d_vs, weak) == doctest::Approx(10. * d_t0));
+  }
+
+  SUBCASE("step limited by the separation distance of the fastest boid")
+  {
+    b2.velocity() = {0., 250.};
+    std::vector<Boid> state{b1, b2};
+    std::vector<Velocity> d_vs{{0., 0.}, {0., 0.}};
+    CHECK(adaptive_d_t(state, d_vs, pars) == doctest::Approx(.5 / 250.));
+  }
+
+  SUBCASE("predators are limited by the separation distance from predators")
+  {
+    b3_p.velocity() = {0., 700.};
+    std::vector<Boid> state{b1, b3_p};
+    std::vector<Velocity> d_vs{{0., 0.}, {0., 0.}};
+    CHECK(adaptive_d_t(state, d_vs, weak)
+          == doctest::Approx(.5 * weak.get_d_s_pred() / 700.));
+  }
+
+  SUBCASE("step limited by the largest velocity change relative to speed")
+  {
+    std::vector<Boid> state{b1, b2};
+    // a quarter of b1's speed, half of b2's
+    std::vector<Velocity> d_vs{{0., .25}, {1., 0.}};
+    CHECK(adaptive_d_t(state, d_vs, weak) == doctest::Approx(d_t0));
+    // boids at rest are compared with the minimum speed
+    state[0].velocity() = {0., 0.};
+    d_vs[0]             = {weak.get_min_speed(), 0.};
+    CHECK(adaptive_d_t(state, d_vs, weak) == doctest::Approx(.5 * d_t0));
+  }
+
+  SUBCASE("step never shorter than its minimum")
+  {
+    std::vector<Boid> state{b1, b2};
+    std::vector<Velocity> d_vs{{0., 0.}, {0., 5000.}};
+    CHECK(adaptive_d_t(state, d_vs, pars) == doctest::Approx(.1 * d_t0));
+  }
+
+  SUBCASE("adaptive evolutions flock as fixed steps do")
+  {
+    // default parameters of boids, fewer boids and steps
+    Parameters fixed{300., 35., 3.5, .7, .045, .8, 80.,
+                     .05,  15., 1500, 50, 1500, 60};
+    Parameters adaptive{fixed};
+    adaptive.set_adaptive_step() = true;
+    // speeds and polarizations averaged over the second half of the states
+    std::vector<double> speeds{};
+    std::vector<double> polarizations{};
+    for (Parameters const& p : {fixed, adaptive}) {
+      std::vector<Boid> boids{};
+      Flock flock{fill(boids, p, 3)};
+      Snapshot_store states{};
+      Observables observables{default_observables()};
+      simulate(flock, p, states, observables);
+      double speed{0.};
+      double polarization{0.};
+      for (std::size_t i{states.size() / 2}; i != states.size(); ++i) {
+        speed += states[i].observations[0].mean;
+        polarization += states[i].observations[1].mean;
+      }
+      double const n{static_cast<double>(states.size() - states.size() / 2)};
+      speeds.push_back(speed / n);
+      polarizations.push_back(polarization / n);
+    }
+    CHECK(speeds[1] == doctest::Approx(speeds[0]).epsilon(.2));
+    CHECK(polarizations[0] > .7);
+    CHECK(polarizations[1] > .7);
+  }
+}
+
+TEST_CASE("Testing observables fed by evolve")
+{
+  Parameters const pars{300.,    10., 2.,   1., .5,   .8, 100.,
+                        .000005, 10., 100,  10, 100,  300};
+  std::vector<Boid> boids{};
+  fill(boids, pars, 3);
+  boids.push_back(Boid{{50., 50.}, {10., 0.}, true});
+  Flock flock{boids};
+  Snapshot_store states{};
+  Observables observables{default_observables()};
+  simulate(flock, pars, states, observables);
+  CHECK(states.size() == 10u);
+
+  // checking observations against direct computation on the saved states
+  for (Snapshot const& snapshot : states) {
+    REQUIRE(snapshot.observations.size() == 4u);
+    auto const& state{snapshot.state};
+    double sum_speed{0.};
+    double sum_nn{0.};
+    for (Boid const& boid : state) {
+      sum_speed += norm(boid.velocity());
+      double nn{std::numeric_limits<double>::infinity()};
+      for (Boid const& other : state) {
+        if (&other != &boid) {
+          nn = std::min(nn, distance(boid, other));
+        }
+      }
+      sum_nn += nn;
+    }
+    double const N{static_cast<double>(state.size())};
+    CHECK(snapshot.observations[0].mean == doctest::Approx(sum_speed / N));
+    CHECK(snapshot.observations[1].mean <= 1.);
+    CHECK(snapshot.observations[2].mean == doctest::Approx(sum_nn / N));
+    CHECK(snapshot.observations[3].mean > 0.);
+  }
+  // flocking increases polarization
+  CHECK(states.back().observations[1].mean
+        > states.front().observations[1].mean);
+
+  // samples are the same whoever searches the nearest boids: other threads,
+  // or the tiled kernel's pass (whose evolution is equal up to rounding)
+  for (bool tiled : {false, true}) {
+    Parameters pars_t{pars};
+    pars_t.set_tiled()   = tiled;
+    pars_t.set_threads() = 3;
+    Flock flock_t{boids};
+    Snapshot_store states_t{};
+    simulate(flock_t, pars_t, states_t, observables);
+    REQUIRE(states_t.size() == states.size());
+    for (std::size_t i{0}; i != ((tiled) ? 1 : states.size()); ++i) {
+      for (std::size_t k{0}; k != 4; ++k) {
+        CHECK(states_t[i].observations[k].mean
+              == states[i].observations[k].mean);
+      }
+    }
+  }
+}
+
+TEST_CASE("Testing multithreaded evolutions")
+{
+  // default parameters of boids, matching a specialized kernel
+  Parameters pars{300., 35., 3.5,  .7, .045, .8,   80.,
+                  .05,  30., 3000, 40, 3000, 300};
+  std::vector<Boid> boids{};
+  fill(boids, pars, 13);
+  boids.push_back(Boid{{50., 50.}, {10., 0.}, true});
+
+  // every boid's velocity change is computed by a single thread, in the same
+  // way: results don't depend on threads and partition
+  for (bool specialized : {false, true}) {
+    for (bool approximate : {false, true}) {
+      pars.set_specialized() = specialized;
+      pars.set_approximate() = approximate;
+      pars.set_threads()     = 1;
+      Flock flock{boids};
+      for (int i{0}; i != 3; ++i) {
+        flock.evolve(pars);
+      }
+      for (bool stealing : {false, true}) {
+        pars.set_threads()       = 4;
+        pars.set_work_stealing() = stealing;
+        Flock threaded{boids};
+        for (int i{0}; i != 3; ++i) {
+          threaded.evolve(pars);
+        }
+        int different{0};
+        for (int i{0}, N{flock.size()}; i != N; ++i) {
+          Boid const& b{flock.state()[i]};
+          Boid const& b_t{threaded.state()[i]};
+          different += (b.position() != b_t.position())
+                    || (b.velocity() != b_t.velocity());
+        }
+        CHECK(different == 0);
+      }
+    }
+  }
+}
+
+TEST_CASE("Testing ids and reordering")
+{
+  Parameters pars{300.,    10., 2.,  1., .5,  .8, 100.,
+                  .000005, 10., 100, 10, 100, 300};
+  pars.set_specialized() = false;
+  std::vector<Boid> boids{};
+  fill(boids, pars, 11);
+  Flock flock{boids};
+  Flock reordered{boids};
+
+  // boids are identified by their place in the initial state, and so are the
+  // ones pushed back
+  for (int i{0}; i != flock.size(); ++i) {
+    CHECK(flock.state()[i].id() == i);
+  }
+  flock.push_back(Boid{{50., 50.}, {10., 0.}, true});
+  reordered.push_back(Boid{{50., 50.}, {10., 0.}, true});
+  CHECK(flock.state().back().id() == 300);
+
+  SUBCASE("reorder sorts along the Morton curve")
+  {
+    reordered.reorder();
+    auto const& state{reordered.state()};
+    // the curve spans the flock's bounding box
+    double x_min{100.};
+    double x_max{0.};
+    double y_min{100.};
+    double y_max{0.};
+    for (Boid const& boid : state) {
+      x_min = std::min(x_min, boid.position().x());
+      x_max = std::max(x_max, boid.position().x());
+      y_min = std::min(y_min, boid.position().y());
+      y_max = std::max(y_max, boid.position().y());
+    }
+    std::vector<std::uint32_t> codes(state.size());
+    std::transform(state.begin(), state.end(), codes.begin(),
+                   [&](Boid const& boid) {
+                     return morton_code(boid.position(), x_min, x_max, y_min,
+                                        y_max);
+                   });
+    CHECK(std::is_sorted(codes.begin(), codes.end()));
+    std::vector<int> ids(state.size());
+    std::transform(state.begin(), state.end(), ids.begin(),
+                   [](Boid const& boid) { return boid.id(); });
+    std::sort(ids.begin(), ids.end());
+    std::vector<int> expected(ids.size());
+    std::iota(expected.begin(), expected.end(), 0);
+    CHECK(ids == expected);
+  }
+
+  SUBCASE("evolutions don't depend on the order of boids")
+  {
+    Parameters pars_reordered{pars};
+    pars_reordered.set_reorder_interval() = 2;
+    for (int step{0}; step != 6; ++step) {
+      flock.evolve(pars);
+      reordered.evolve(pars_reordered);
+    }
+    auto const by_id{[](Boid const& b1, Boid const& b2) {
+      return b1.id() < b2.id();
+    }};
+    std::vector<Boid> state{reordered.state()};
+    CHECK(!std::is_sorted(state.begin(), state.end(), by_id));
+    std::sort(state.begin(), state.end(), by_id);
+    for (int i{0}; i != flock.size(); ++i) {
+      Boid const& expected{flock.state()[i]};
+      CHECK(state[i].id() == i);
+      CHECK(state[i].is_pred() == expected.is_pred());
+      CHECK(state[i].position().x()
+            == doctest::Approx(expected.position().x()));
+      CHECK(state[i].position().y()
+            == doctest::Approx(expected.position().y()));
+      CHECK(state[i].velocity().x()
+            == doctest::Approx(expected.velocity().x()));
+      CHECK(state[i].velocity().y()
+            == doctest::Approx(expected.velocity().y()));
+    }
+  }
+}
+
+TEST_CASE("Testing batch insert and remove")
+{
+  Parameters pars{300.,    10., 2.,  1., .5,  .8, 100.,
+                  .000005, 10., 100, 10, 100, 300};
+  std::vector<Boid> boids{};
+  fill(boids, pars, 5);
+  boids[3] = Boid{{20., 20.}, {10., 0.}, true};
+  Flock flock{boids};
+  // index and predators' indices must always agree with the state
+  auto const consistent{[&flock] {
+    auto const& state{flock.state()};
+    std::vector<int> preds{};
+    for (int i{0}; i != flock.size(); ++i) {
+      if (state[i].is_pred()) {
+        preds.push_back(i);
+      }
+      if (flock.index_of(state[i].id()) != i) {
+        return false;
+      }
+    }
+    return preds == flock.predator_indices();
+  }};
+  CHECK(consistent());
+  CHECK(flock.predator_indices() == std::vector<int>{3});
+
+  flock.insert({Boid{{50., 50.}, {10., 0.}, true}, Boid{{60., 50.}, {0., 10.}},
+                Boid{{70., 50.}, {10., 0.}, true}});
+  CHECK(flock.size() == 303);
+  CHECK(flock.state()[302].id() == 302);
+  CHECK(flock.predator_indices() == std::vector<int>{3, 300, 302});
+  CHECK(consistent());
+
+  // the last boid takes the place of each boid removed
+  CHECK(flock.remove({10, 3, 12345, 10}) == 2);
+  CHECK(flock.size() == 301);
+  CHECK(flock.index_of(10) == -1);
+  CHECK(flock.index_of(3) == -1);
+  CHECK(flock.state()[10].id() == 302);
+  CHECK(flock.state()[3].id() == 301);
+  CHECK(flock.predator_indices() == std::vector<int>{10, 300});
+  CHECK(consistent());
+
+  // ids are never given twice, and the index survives reordering
+  flock.push_back(Boid{{30., 30.}, {10., 0.}});
+  CHECK(flock.state().back().id() == 303);
+  flock.reorder();
+  CHECK(consistent());
+  std::vector<int> ids{};
+  for (int id{0}; id != 200; ++id) {
+    ids.push_back(id);
+  }
+  CHECK(flock.remove(ids) == 198);
+  CHECK(flock.size() == 104);
+  CHECK(consistent());
+  for (int step{0}; step != 3; ++step) {
+    flock.evolve(pars);
+  }
+  CHECK(consistent());
+
+  // at least two boids must remain: a removal leaving fewer removes none
+  ids.clear();
+  for (int i{1}; i != flock.size(); ++i) {
+    ids.push_back(flock.state()[i].id());
+  }
+  ids.push_back(ids.front()); // counted once
+  CHECK_THROWS_AS(flock.remove(ids), std::runtime_error);
+  CHECK(flock.size() == 104);
+  CHECK(consistent());
+  ids.pop_back();
+  ids.pop_back();
+  CHECK(flock.remove(ids) == 102);
+  CHECK(flock.size() == 2);
+  CHECK(consistent());
+}
+
+TEST_CASE("Testing obstacle avoidance")
+{
+  Parameters pars{300.,    10., 2.,  1., .5,  .8, 100.,
+                  .000005, 10., 100, 10, 100, 300};
+  // d_s_pred is 14, s_pred 10.5
+  Obstacles const obstacles{{Obstacle{{50., 50.}, {50., 50.}, 4.},
+                             Obstacle{{20., 80.}, {80., 80.}, 0.}}};
+  Boid const boid{{40., 50.}, {10., 0.}};
+  // 6 away from the pillar's surface, 30 away from the wall
+  Velocity const d_v{avoidance(boid, obstacles, pars)};
+  CHECK(d_v.x() == doctest::Approx(-8. * 10.5));
+  CHECK(d_v.y() == doctest::Approx(0.));
+  // too far from the pillar, 10 away from the wall
+  Boid const near_wall{{50., 70.}, {10., 0.}};
+  CHECK(avoidance(near_wall, obstacles, pars).y()
+        == doctest::Approx(-4. * 10.5));
+  CHECK(avoidance(Boid{{90., 20.}, {1., 1.}}, obstacles, pars)
+        == Velocity{0., 0.});
+
+  SUBCASE("boids never cross a wall")
+  {
+    // steps short enough for boids to feel the wall before reaching it
+    pars = Parameters{300.,    10., 2.,  1., .5,  .8, 100.,
+                      .000005, 1.,  100, 10, 100, 300};
+    std::vector<Boid> boids{};
+    for (int i{0}; i != 20; ++i) {
+      boids.push_back(Boid{{30. + i * 2., 40.}, {0., 30.}});
+    }
+    for (bool sleeping : {false, true}) {
+      pars.set_sleeping() = sleeping;
+      Flock flock{boids};
+      flock.set_obstacles(
+          Obstacles{{Obstacle{{10., 60.}, {90., 60.}, 1.}}});
+      for (int step{0}; step != 300; ++step) {
+        flock.evolve(pars);
+      }
+      int crossed{0};
+      for (Boid const& b : flock.state()) {
+        crossed += b.position().x() > 12. && b.position().x() < 88.
+                && b.position().y() > 60.;
+      }
+      CHECK(crossed == 0);
+    }
+  }
 }
 
 TEST_CASE("Testing fill")
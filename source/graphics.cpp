@@ -1,10 +1,14 @@
 #include "graphics.hpp"
+#include <algorithm>
+#include <iomanip>
 #include <random>
+#include <sstream>
 
 // defines all functions responsible of graphics
 
 // draws all boids in state, representing each boid as a triangle
-void draw_state(sf::RenderWindow& window, std::vector<Boid> const& state)
+void draw_state(sf::RenderWindow& window, std::vector<Boid> const& state,
+                double scale)
 {
   // creates an array of vertices defining a Triangles primitive (i.e. a set of
   // unconnected triangles)
@@ -12,7 +16,7 @@ void draw_state(sf::RenderWindow& window, std::vector<Boid> const& state)
 
   for (Boid const& boid : state) {
     // predators are represented as bigger triangles
-    double const scale_fac{(boid.is_pred()) ? 1.5 : 1.};
+    double const scale_fac{((boid.is_pred()) ? 1.5 : 1.) * scale};
     double constexpr half_base{3.5};   // half of the base of the triangle
     double constexpr half_height{5.5}; // half of the height of the triangle
     sf::Color grey{169, 169, 169, 255};
@@ -74,14 +78,23 @@ void add_predator(Position const& position, Flock& flock, Parameters& pars,
   normalize(boid.velocity(), pars.get_min_speed(), pars.get_max_speed());
 
   assert(boid.is_pred());
-  flock.push_back(boid);
+  flock.insert({boid});
   assert(init_size + 1 == flock.size());
 }
 
+// the flock is evolved tick_rate times per second (no more than the frames
+// displayed per second): frames in between show the boids interpolated from
+// the last two states, according to the time elapsed since the last evolution
 void game_loop(sf::RenderWindow& window, Flock& flock, Parameters& pars,
-               unsigned int seed)
+               unsigned int seed, int tick_rate)
 {
+  assert(tick_rate > 0 && tick_rate <= pars.get_fps());
+  std::vector<Boid> previous{flock.state()};
+  std::vector<Boid> current{flock.state()};
   std::vector<Boid> state{};
+  double const tick{1. / tick_rate};
+  double elapsed{0.}; // since the last evolution
+  sf::Clock clock;
   window.setFramerateLimit(pars.get_fps());
   sf::Texture t;
   t.loadFromFile("bigsky.png");
@@ -124,11 +137,18 @@ void game_loop(sf::RenderWindow& window, Flock& flock, Parameters& pars,
       }
     }
 
-    // #2 evolving the scene:
+    // #2 evolving the scene, as many times as ticks went by (never more than
+    // a few, should evolutions take longer than ticks):
+    elapsed += clock.restart().asSeconds();
+    for (int ticks{0}; elapsed >= tick && ticks != 4; ++ticks) {
+      previous = std::move(current);
+      current  = evolve(flock, pars);
+      elapsed -= tick;
+    }
+    elapsed = std::min(elapsed, tick);
     window.clear(sf::Color::White);
     window.draw(s);
-    state = evolve(flock, pars);
-    draw_state(window, state);
+    draw_state(window, interpolate(previous, current, elapsed / tick, state));
     // predator can be added by pressing left mouse button
     if (sf::Mouse::isButtonPressed(sf::Mouse::Left)) {
       auto mouse_position{sf::Mouse::getPosition(window)};
@@ -146,3 +166,122 @@ void game_loop(sf::RenderWindow& window, Flock& flock, Parameters& pars,
     window.display();
   }
 }
+
+// scale making triangles as big on screen as with the default view, when the
+// view spans the rectangle given
+double view_scale(sf::RenderWindow const& window, sf::FloatRect const& area)
+{
+  return std::max(area.width / window.getSize().x,
+                  area.height / window.getSize().y);
+}
+
+// replays trajectory at fps frames per second, with no simulation running:
+// space pauses and resumes, left and right arrows seek backward and forward
+// (by a twentieth of the trajectory), up and down arrows double and halve the
+// speed, home goes back to the start
+void replay_loop(sf::RenderWindow& window, Trajectory const& trajectory,
+                 int fps)
+{
+  assert(!trajectory.empty());
+  window.setFramerateLimit(fps);
+  double const first{trajectory.time(0)};
+  double const last{trajectory.time(trajectory.size() - 1)};
+
+  // the view spans the boids of the first and the last frame (the space
+  // simulated, unless the flock gathered in a part of it throughout)
+  std::vector<Boid> state{};
+  std::vector<Boid> boids{};
+  trajectory.read(0, boids);
+  trajectory.read(trajectory.size() - 1, state);
+  boids.insert(boids.end(), state.begin(), state.end());
+  auto const [x_min, x_max] = std::minmax_element(
+      boids.begin(), boids.end(), [](Boid const& b1, Boid const& b2) {
+        return b1.position().x() < b2.position().x();
+      });
+  auto const [y_min, y_max] = std::minmax_element(
+      boids.begin(), boids.end(), [](Boid const& b1, Boid const& b2) {
+        return b1.position().y() < b2.position().y();
+      });
+  double const margin{
+      .05
+      * std::max({x_max->position().x() - x_min->position().x(),
+                  y_max->position().y() - y_min->position().y(), 1.})};
+  sf::FloatRect const area(
+      x_min->position().x() - margin, y_min->position().y() - margin,
+      x_max->position().x() - x_min->position().x() + 2 * margin,
+      y_max->position().y() - y_min->position().y() + 2 * margin);
+  window.setView(sf::View(area));
+  double scale{view_scale(window, area)};
+
+  Playback playback{first, last};
+  double const seek_step{(last - first) / 20.};
+  sf::Clock clock;
+  int shown{-1};
+  std::string title{};
+  while (window.isOpen()) {
+    // #1 processing events:
+    sf::Event event;
+    while (window.pollEvent(event)) {
+      switch (event.type) {
+      case sf::Event::Closed:
+        window.close();
+        break;
+      case sf::Event::KeyPressed:
+        switch (event.key.code) {
+        case sf::Keyboard::Escape:
+          window.close();
+          break;
+        case sf::Keyboard::Space:
+          playback.toggle();
+          break;
+        case sf::Keyboard::Left:
+          playback.seek(-seek_step);
+          break;
+        case sf::Keyboard::Right:
+          playback.seek(seek_step);
+          break;
+        case sf::Keyboard::Up:
+          playback.faster();
+          break;
+        case sf::Keyboard::Down:
+          playback.slower();
+          break;
+        case sf::Keyboard::Home:
+          playback.seek(first - last);
+          break;
+        default:
+          break;
+        }
+        break;
+      // the view keeps spanning the same area
+      case sf::Event::Resized:
+        window.setView(sf::View(area));
+        scale = view_scale(window, area);
+        break;
+      default:
+        break;
+      }
+    }
+
+    // #2 advancing the replay, decoding a frame only when it changes:
+    playback.advance(clock.restart().asSeconds());
+    int const frame{trajectory.frame_at(playback.time())};
+    if (frame != shown) {
+      trajectory.read(frame, state);
+      shown = frame;
+    }
+    std::ostringstream status;
+    status << "Flock replay - t = " << std::fixed << std::setprecision(2)
+           << trajectory.time(frame) << " s, speed x" << playback.speed()
+           << ((playback.playing()) ? "" : " (paused)");
+    if (status.str() != title) {
+      title = status.str();
+      window.setTitle(title);
+    }
+
+    // #3 displaying the frame:
+    window.clear(sf::Color::White);
+    draw_state(window, state, scale);
+    window.display();
+  }
+}
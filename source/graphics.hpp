@@ -3,8 +3,12 @@
 
 #include "flock.hpp"
 #include "parameters.hpp"
+#include "trajectory.hpp"
 
-void draw_state(sf::RenderWindow& window, std::vector<Boid> const& state);
+// boids' triangles are scaled by scale (e.g. to keep their size on screen
+// whatever the view)
+void draw_state(sf::RenderWindow& window, std::vector<Boid> const& state,
+                double scale = 1.);
 
 auto evolve(Flock& flock, Parameters const& pars);
 
@@ -12,6 +16,9 @@ void add_predator(Position const& pos, Flock& flock, Parameters const& pars,
                   unsigned int seed);
 
 void game_loop(sf::RenderWindow& window, Flock& flock, Parameters& pars,
-               unsigned int seed);
+               unsigned int seed, int tick_rate);
+
+void replay_loop(sf::RenderWindow& window, Trajectory const& trajectory,
+                 int fps);
 
 #endif
\ No newline at end of file
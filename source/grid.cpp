@@ -0,0 +1,80 @@
+#include "grid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// defines Grid's constructor, the mapping from positions to cells and the
+// Morton code of a position
+
+Grid::Grid(std::vector<Boid> const& state, double side, double x_min,
+           double x_max, double y_min, double y_max)
+    : x_min_{x_min}
+    , y_min_{y_min}
+{
+  assert(side > 0.);
+  assert(x_max > x_min && y_max > y_min);
+  // cells are never made smaller than side, and their number is capped so that
+  // a tiny side can't exhaust memory (cells just get larger than side)
+  int constexpr max_cells_per_side{1024};
+  n_x_    = std::clamp(static_cast<int>((x_max - x_min) / side), 1,
+                       max_cells_per_side);
+  n_y_    = std::clamp(static_cast<int>((y_max - y_min) / side), 1,
+                       max_cells_per_side);
+  width_  = (x_max - x_min) / n_x_;
+  height_ = (y_max - y_min) / n_y_;
+
+  // counting sort of the boids' indices by cell
+  int const N{static_cast<int>(state.size())};
+  std::vector<int> cells(N);
+  std::transform(state.begin(), state.end(), cells.begin(),
+                 [&](Boid const& boid) { return cell(boid.position()); });
+  start_.assign(n_x_ * n_y_ + 1, 0);
+  std::for_each(cells.begin(), cells.end(), [&](int c) { ++start_[c + 1]; });
+  std::partial_sum(start_.begin(), start_.end(), start_.begin());
+  std::vector<int> fill_pos(start_.begin(), start_.end() - 1);
+  boids_.resize(N);
+  for (int i{0}; i != N; ++i) {
+    boids_[fill_pos[cells[i]]++] = i;
+  }
+}
+
+int Grid::column(double x) const
+{
+  // clamping as a double first, since an int can't represent far positions
+  double const c{std::clamp(std::floor((x - x_min_) / width_), 0.,
+                            static_cast<double>(n_x_ - 1))};
+  return static_cast<int>(c);
+}
+
+int Grid::row(double y) const
+{
+  double const r{std::clamp(std::floor((y - y_min_) / height_), 0.,
+                            static_cast<double>(n_y_ - 1))};
+  return static_cast<int>(r);
+}
+
+// spreads the 16 lower bits of x over the even bits of the result
+std::uint32_t spread_bits(std::uint32_t x)
+{
+  x &= 0x0000ffff;
+  x = (x | (x << 8)) & 0x00ff00ff;
+  x = (x | (x << 4)) & 0x0f0f0f0f;
+  x = (x | (x << 2)) & 0x33333333;
+  x = (x | (x << 1)) & 0x55555555;
+  return x;
+}
+
+std::uint32_t morton_code(Position const& p, double x_min, double x_max,
+                          double y_min, double y_max)
+{
+  assert(x_max >= x_min && y_max >= y_min);
+  double constexpr steps{65535.};
+  // coordinates scaled to [0, steps], degenerate sides mapping to 0
+  auto const scale = [=](double u, double u_min, double u_max) {
+    double const s{(u_max > u_min) ? (u - u_min) / (u_max - u_min) * steps
+                                   : 0.};
+    return static_cast<std::uint32_t>(std::clamp(s, 0., steps));
+  };
+  return spread_bits(scale(p.x(), x_min, x_max))
+       | (spread_bits(scale(p.y(), y_min, y_max)) << 1);
+}
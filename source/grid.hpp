@@ -0,0 +1,129 @@
+#ifndef GRID_HPP
+#define GRID_HPP
+#include "boids.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+// defines class Grid, a uniform cell list used to find the boids near a point
+// without scanning the whole flock
+
+class Grid
+{
+  double x_min_;
+  double y_min_;
+  double width_;  // cells' width, never less than the side requested
+  double height_; // cells' height, never less than the side requested
+  int n_x_;
+  int n_y_;
+  // indices of the boids in the state, sorted by cell: the boids in cell c are
+  // found in boids_[start_[c]] ... boids_[start_[c + 1] - 1]
+  std::vector<int> start_;
+  std::vector<int> boids_;
+
+ public:
+  explicit Grid(std::vector<Boid> const& state, double side, double x_min,
+                double x_max, double y_min, double y_max);
+  // clang-format off
+  int n_x() const{return n_x_;}
+  int n_y() const{return n_y_;}
+  double width() const{return width_;}
+  double height() const{return height_;}
+  // clang-format on
+  // boids outside the grid's limits are assigned to the nearest border cell
+  int column(double x) const;
+  int row(double y) const;
+  int cell(Position const& p) const
+  {
+    return row(p.y()) * n_x_ + column(p.x());
+  }
+
+  int n_cells() const
+  {
+    return n_x_ * n_y_;
+  }
+
+  // calls f with the index of every boid in cell c
+  template<class F>
+  void for_each_in_cell(int c, F&& f) const
+  {
+    assert(c >= 0 && c < n_cells());
+    for (int k{start_[c]}; k != start_[c + 1]; ++k) {
+      f(boids_[k]);
+    }
+  }
+
+  // calls f with every cell that intersects the square of half-side radius
+  // centered in p
+  template<class F>
+  void for_each_cell_near(Position const& p, double radius, F&& f) const
+  {
+    int const c_min{column(p.x() - radius)};
+    int const c_max{column(p.x() + radius)};
+    int const r_min{row(p.y() - radius)};
+    int const r_max{row(p.y() + radius)};
+    for (int r{r_min}; r <= r_max; ++r) {
+      for (int c{r * n_x_ + c_min}; c <= r * n_x_ + c_max; ++c) {
+        f(c);
+      }
+    }
+  }
+
+  // calls f with the index of every boid lying in a cell that intersects the
+  // square of half-side radius centered in p (a superset of the boids closer
+  // than radius to p)
+  template<class F>
+  void for_each_near(Position const& p, double radius, F&& f) const
+  {
+    for_each_cell_near(p, radius, [&](int c) { for_each_in_cell(c, f); });
+  }
+
+  // returns the distance from p of the nearest boid of state whose index is
+  // accepted by accept (infinity if there is none), visiting rings of cells
+  // around p's cell until no closer boid can be found
+  template<class F>
+  double nearest(Position const& p, std::vector<Boid> const& state,
+                 F&& accept) const
+  {
+    int const c0{column(p.x())};
+    int const r0{row(p.y())};
+    double const side{std::min(width_, height_)};
+    double best{std::numeric_limits<double>::infinity()};
+    auto const visit{[&](int r, int c) {
+      if (r < 0 || r >= n_y_ || c < 0 || c >= n_x_) {
+        return;
+      }
+      for_each_in_cell(r * n_x_ + c, [&](int i) {
+        if (accept(i)) {
+          Vector2D const diff{state[i].position() - p};
+          best = std::min(best, norm(diff));
+        }
+      });
+    }};
+    // boids in ring k (cells k steps away from p's cell) are at least k - 1
+    // cells' sides far from p
+    for (int k{0}, k_max{std::max(n_x_, n_y_)};
+         k <= k_max && best > (k - 1) * side; ++k) {
+      for (int r{r0 - k}; r <= r0 + k; ++r) {
+        if (std::abs(r - r0) == k) {
+          for (int c{c0 - k}; c <= c0 + k; ++c) {
+            visit(r, c);
+          }
+        } else {
+          visit(r, c0 - k);
+          visit(r, c0 + k);
+        }
+      }
+    }
+    return best;
+  }
+};
+
+// position of p along a Morton (Z-order) curve spanning the rectangle given,
+// with 2^16 steps per side: points close in space mostly get close codes
+std::uint32_t morton_code(Position const& p, double x_min, double x_max,
+                          double y_min, double y_max);
+
+#endif
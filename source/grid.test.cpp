@@ -0,0 +1,102 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "grid.hpp"
+#include "doctest.h"
+#include <algorithm>
+
+TEST_CASE("testing Grid")
+{
+  Boid b1{{1., 1.}, {1., 0.}};
+  Boid b2{{12., 3.}, {1., 0.}};
+  Boid b3{{15., 15.}, {1., 0.}};
+  Boid b4{{99., 99.}, {1., 0.}};
+  Boid b5{{-7., 120.}, {1., 0.}, true}; // outside the grid's limits
+  std::vector<Boid> state{b1, b2, b3, b4, b5};
+
+  SUBCASE("testing cells")
+  {
+    Grid grid{state, 10., 0., 100., 0., 100.};
+    CHECK(grid.n_x() == 10);
+    CHECK(grid.n_y() == 10);
+    CHECK(grid.width() == doctest::Approx(10.));
+    CHECK(grid.cell(b1.position()) == 0);
+    CHECK(grid.cell(b2.position()) == 1);
+    CHECK(grid.cell(b3.position()) == 11);
+    CHECK(grid.cell(b4.position()) == 99);
+    // positions outside the limits are clamped to the border cells
+    CHECK(grid.cell(b5.position()) == 90);
+  }
+
+  SUBCASE("cells are never smaller than the side requested")
+  {
+    Grid grid{state, 30., 0., 100., 0., 50.};
+    CHECK(grid.n_x() == 3);
+    CHECK(grid.n_y() == 1);
+    CHECK(grid.width() == doctest::Approx(100. / 3.));
+    CHECK(grid.height() == doctest::Approx(50.));
+    Grid grid_large{state, 200., 0., 100., 0., 100.};
+    CHECK(grid_large.n_x() == 1);
+    CHECK(grid_large.n_y() == 1);
+  }
+
+  SUBCASE("testing for_each_near")
+  {
+    Grid grid{state, 10., 0., 100., 0., 100.};
+    std::vector<int> near{};
+    grid.for_each_near({5., 5.}, 8., [&](int i) { near.push_back(i); });
+    std::sort(near.begin(), near.end());
+    CHECK(near == std::vector<int>{0, 1, 2});
+
+    near.clear();
+    grid.for_each_near({95., 95.}, 3., [&](int i) { near.push_back(i); });
+    CHECK(near == std::vector<int>{3});
+
+    near.clear();
+    grid.for_each_near({0., 100.}, 1., [&](int i) { near.push_back(i); });
+    CHECK(near == std::vector<int>{4});
+
+    // every boid closer than radius is found, whatever its cell
+    Grid grid_small{state, 1., 0., 100., 0., 100.};
+    near.clear();
+    grid_small.for_each_near({13., 9.}, 6.5,
+                             [&](int i) { near.push_back(i); });
+    std::sort(near.begin(), near.end());
+    CHECK(near == std::vector<int>{1, 2});
+  }
+
+  SUBCASE("testing nearest")
+  {
+    Grid grid{state, 10., 0., 100., 0., 100.};
+    auto const all_but{[](int i) { return [=](int j) { return j != i; }; }};
+    CHECK(grid.nearest(b1.position(), state, all_but(0))
+          == doctest::Approx(std::sqrt(125.)));
+    CHECK(grid.nearest(b2.position(), state, all_but(1))
+          == doctest::Approx(std::sqrt(125.)));
+    // the nearest boid can lie far beyond the adjacent cells (b5, outside the
+    // grid's limits, is nearer than b3)
+    CHECK(grid.nearest(b4.position(), state, all_but(3))
+          == doctest::Approx(std::sqrt(106. * 106. + 21. * 21.)));
+    CHECK(grid.nearest({-10., 130.}, state, all_but(-1))
+          == doctest::Approx(std::sqrt(9. + 100.)));
+    CHECK(grid.nearest({50., 50.}, state, [](int) { return false; })
+          == std::numeric_limits<double>::infinity());
+  }
+}
+
+TEST_CASE("testing morton_code")
+{
+  // corners of the rectangle are the first and last points of the curve
+  CHECK(morton_code({0., 0.}, 0., 100., 0., 50.) == 0u);
+  CHECK(morton_code({100., 50.}, 0., 100., 0., 50.) == 0xffffffffu);
+  // x fills the even bits, y the odd ones
+  CHECK(morton_code({100., 0.}, 0., 100., 0., 50.) == 0x55555555u);
+  CHECK(morton_code({0., 50.}, 0., 100., 0., 50.) == 0xaaaaaaaau);
+  // positions outside the rectangle are clamped to its borders
+  CHECK(morton_code({-5., 70.}, 0., 100., 0., 50.) == 0xaaaaaaaau);
+  // degenerate sides map to 0
+  CHECK(morton_code({3., 50.}, 3., 3., 0., 50.) == 0xaaaaaaaau);
+  // the curve visits a quadrant entirely before moving on to the next one
+  CHECK(morton_code({49., 49.}, 0., 100., 0., 100.)
+        < morton_code({51., 1.}, 0., 100., 0., 100.));
+  CHECK(morton_code({99., 49.}, 0., 100., 0., 100.)
+        < morton_code({1., 51.}, 0., 100., 0., 100.));
+}
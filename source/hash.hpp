@@ -0,0 +1,79 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// defines class Hash, the key of the results cached on disk (see warm_start.hpp
+// and autotune.hpp), and the files holding them. Every key is fed a version
+// first, changed whenever the format of the result or the way it's obtained
+// do: results cached by older versions are never used
+
+// 64-bit FNV-1a hash, fed value by value with their bytes
+class Hash
+{
+  std::uint64_t hash_{14695981039346656037ull};
+
+ public:
+  template<class T>
+  Hash& add(T value)
+  {
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    for (unsigned char byte : bytes) {
+      hash_ = (hash_ ^ byte) * 1099511628211ull;
+    }
+    return *this;
+  }
+  std::uint64_t value() const
+  {
+    return hash_;
+  }
+};
+
+// file in directory dir caching the result of key: [dir]/[key, in hex][ext]
+inline std::string cache_file(std::string const& dir, std::uint64_t key,
+                              std::string const& ext)
+{
+  std::ostringstream name;
+  name << dir << '/' << std::hex << std::setw(16) << std::setfill('0') << key
+       << ext;
+  return name.str();
+}
+
+// caches a result in filename, in directory dir (created if needed): write
+// writes it to a file of its own first, renamed to filename once complete, so
+// that runs started meanwhile never read a result cut short
+template<class Write>
+void write_cache_file(std::string const& dir, std::string const& filename,
+                      Write write)
+{
+  if (mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST) {
+    throw std::ios_base::failure{"ERROR: Cannot create directory " + dir + ": "
+                                 + std::strerror(errno) + '\n'};
+  }
+  std::string const partial{filename + '.' + std::to_string(getpid())};
+  {
+    std::ofstream file{partial, std::ios::binary};
+    write(file);
+    if (!file) {
+      std::remove(partial.c_str());
+      throw std::ios_base::failure{"ERROR: Cannot write file " + partial
+                                   + '\n'};
+    }
+  }
+  if (std::rename(partial.c_str(), filename.c_str()) != 0) {
+    std::remove(partial.c_str());
+    throw std::ios_base::failure{"ERROR: Cannot write file " + filename + ": "
+                                 + std::strerror(errno) + '\n'};
+  }
+}
+
+#endif
@@ -0,0 +1,38 @@
+#include "kernels.hpp"
+
+// defines the dispatcher choosing among the prebuilt specialized kernels
+
+template<class Preset>
+std::optional<double> evolve_with(std::vector<Boid>& state,
+                                  Parameters const& pars, double max_d_t)
+{
+#ifdef GRAPHICS
+  return evolve_kernel<Preset, Frame_step>(state, pars, max_d_t);
+#endif
+#ifndef GRAPHICS
+  return (pars.get_adaptive_step())
+           ? evolve_kernel<Preset, Adaptive_step>(state, pars, max_d_t)
+           : evolve_kernel<Preset, Fixed_step>(state, pars, max_d_t);
+#endif
+}
+
+bool has_specialized_kernel(Parameters const& pars)
+{
+  return matches<Headless_preset>(pars) || matches<Sfml_preset>(pars);
+}
+
+std::optional<double> specialized_evolve(std::vector<Boid>& state,
+                                         Parameters const& pars,
+                                         double max_d_t)
+{
+  if (!pars.get_specialized()) {
+    return std::nullopt;
+  }
+  if (matches<Headless_preset>(pars)) {
+    return evolve_with<Headless_preset>(state, pars, max_d_t);
+  }
+  if (matches<Sfml_preset>(pars)) {
+    return evolve_with<Sfml_preset>(state, pars, max_d_t);
+  }
+  return std::nullopt;
+}
@@ -0,0 +1,224 @@
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+#include "flock.hpp"
+#include "scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+// defines flock's evolution kernels specialized at compile time: parameters of
+// a preset are constants the compiler can fold, regular boids and predators
+// are handled by separate loops (no per-boid branch on is_pred) and the time
+// step mode is a policy. Evolutions are equivalent to the generic one, up to
+// rounding (sums are taken in a different order): kernels are used only if
+// asked for (see Parameters::set_specialized), so that default runs are
+// reproduced exactly
+
+// presets: rule coefficients of configurations that never change
+struct Headless_preset // defaults of boids
+{
+  static constexpr double angle{300.};
+  static constexpr double d{35.};
+  static constexpr double d_s{3.5};
+  static constexpr double s{.7};
+  static constexpr double c{.045};
+  static constexpr double a{.8};
+  static constexpr double max_speed{80.};
+  static constexpr double min_speed{max_speed * .05};
+  static constexpr double d_s_pred{7. * d_s};
+  static constexpr double s_pred{10.5 * s};
+};
+
+struct Sfml_preset // defaults of boids-sfml
+{
+  static constexpr double angle{310.};
+  static constexpr double d{55.};
+  static constexpr double d_s{10.};
+  static constexpr double s{4.9};
+  static constexpr double c{.0015};
+  static constexpr double a{.1};
+  static constexpr double max_speed{500.};
+  static constexpr double min_speed{max_speed * .5};
+  static constexpr double d_s_pred{7. * d_s};
+  static constexpr double s_pred{10.5 * s};
+};
+
+// true if pars' rule coefficients are exactly those of Preset
+template<class Preset>
+bool matches(Parameters const& pars)
+{
+  return pars.get_angle() == Preset::angle && pars.get_d() == Preset::d
+      && pars.get_d_s() == Preset::d_s && pars.get_s() == Preset::s
+      && pars.get_c() == Preset::c && pars.get_a() == Preset::a
+      && pars.get_max_speed() == Preset::max_speed
+      && pars.get_min_speed() == Preset::min_speed
+      && pars.get_d_s_pred() == Preset::d_s_pred
+      && pars.get_s_pred() == Preset::s_pred;
+}
+
+// time step policies: fixed step duration/steps (simulate), fixed step
+// duration (boids-sfml, one evolution per duration), adaptive step
+struct Fixed_step
+{
+  static double nominal(Parameters const& pars)
+  {
+    return pars.get_duration() / pars.get_steps();
+  }
+};
+struct Frame_step
+{
+  static double nominal(Parameters const& pars)
+  {
+    return pars.get_duration();
+  }
+};
+struct Adaptive_step : Fixed_step
+{};
+
+// same as is_seen, with the angle of view known at compile time (the cosine of
+// a constant is folded by the compiler)
+template<class Preset>
+bool seen(Boid const& b1, Boid const& b2)
+{
+  if (b1.position() == b2.position()) {
+    return true;
+  }
+  auto const pos_diff{b2.position() - b1.position()};
+  double const scalar_prod{pos_diff.x() * b1.velocity().x()
+                           + pos_diff.y() * b1.velocity().y()};
+  return scalar_prod / (norm(b1.velocity()) * norm(pos_diff))
+      >= std::cos(pi * Preset::angle / 360.);
+}
+
+// velocity change of a regular boid: separation, alignment and cohesion in a
+// single pass over the flock
+template<class Preset>
+Velocity regular_delta_v(Boid const& boid, std::vector<Boid> const& flock)
+{
+  Position sep{0., 0.};
+  Position sep_pred{0., 0.};
+  Position sum_p{0., 0.};
+  Velocity sum_v{0., 0.};
+  int n{0};
+  for (Boid const& other : flock) {
+    if (!seen<Preset>(boid, other)) {
+      continue;
+    }
+    double const dist{distance(boid, other)};
+    if (other.is_pred()) {
+      if (dist < Preset::d_s_pred) {
+        sep_pred += (other.position() - boid.position()) * (-Preset::s_pred);
+      }
+    } else if (dist < Preset::d) {
+      ++n;
+      sum_p += other.position();
+      sum_v += other.velocity();
+      if (dist < Preset::d_s) {
+        sep += (other.position() - boid.position()) * (-Preset::s);
+      }
+    }
+  }
+  Velocity d_v{sep.x() + sep_pred.x(), sep.y() + sep_pred.y()};
+  if (n > 1) { // boid itself is always among the n neighbours
+    d_v += (sum_v - boid.velocity() * n) * (Preset::a / (n - 1));
+    d_v += (sum_p - boid.position() * n) * (Preset::c / (n - 1));
+  }
+  return d_v;
+}
+
+// velocity change of a predator: separation from competitors and seek in a
+// single pass over the flock
+template<class Preset>
+Velocity predator_delta_v(Boid const& boid, std::vector<Boid> const& flock,
+                          Parameters const& pars)
+{
+  Position sep{0., 0.};
+  Boid const* prey{nullptr};
+  double prey_dist{0.};
+  for (Boid const& other : flock) {
+    if (!seen<Preset>(boid, other)) {
+      continue;
+    }
+    double const dist{distance(boid, other)};
+    if (other.is_pred()) {
+      if (dist < Preset::d_s) {
+        sep += (other.position() - boid.position()) * (-Preset::s);
+      }
+    } else if (prey == nullptr || dist < prey_dist) {
+      prey      = &other;
+      prey_dist = dist;
+    }
+  }
+  Velocity d_v{sep.x(), sep.y()};
+  // same as seek: no drive if no prey is in sight or if it's in a corner
+  if (prey == nullptr
+      || in_corner(*prey, pars.get_x_max(), pars.get_y_max())) {
+    return d_v;
+  }
+  auto const pos_diff{prey->position() - boid.position()};
+  Velocity vel{pos_diff.x() + prey->velocity().x(),
+               pos_diff.y() + prey->velocity().y()};
+  if (norm(vel)) {
+    vel = (vel / norm(vel))
+        * (norm(pos_diff) * (norm(boid.velocity()) / Preset::max_speed));
+  }
+  return d_v + vel;
+}
+
+// evolves state by one step (never longer than max_d_t), returns the step used
+template<class Preset, class Step>
+double evolve_kernel(std::vector<Boid>& state, Parameters const& pars,
+                     double max_d_t)
+{
+  int const N{static_cast<int>(state.size())};
+  std::vector<int> regulars{};
+  std::vector<int> preds{};
+  for (int i{0}; i != N; ++i) {
+    (state[i].is_pred() ? preds : regulars).push_back(i);
+  }
+  std::vector<Velocity> d_vs(N, Velocity{0., 0.});
+  // same chunks of boids as the generic evolution's
+  int constexpr chunk_size{32};
+  parallel_for(static_cast<int>(regulars.size()), chunk_size,
+               pars.get_threads(),
+               (pars.get_work_stealing()) ? Partition::work_stealing
+                                          : Partition::static_chunks,
+               [&](int begin, int end) {
+                 for (int k{begin}; k != end; ++k) {
+                   int const i{regulars[k]};
+                   d_vs[i] = regular_delta_v<Preset>(state[i], state);
+                 }
+               });
+  for (int i : preds) {
+    d_vs[i] = predator_delta_v<Preset>(state[i], state, pars);
+  }
+
+  double const d_t0{Step::nominal(pars)};
+  double d_t{std::min(d_t0, max_d_t)};
+  if constexpr (std::is_same_v<Step, Adaptive_step>) {
+    d_t = std::min(adaptive_d_t(state, d_vs, pars), max_d_t);
+    double const scale{d_t / d_t0};
+    for (Velocity& d_v : d_vs) {
+      d_v *= scale;
+    }
+  }
+
+  integrate(state, d_vs, d_t, pars.get_x_min(), pars.get_x_max(),
+            pars.get_y_min(), pars.get_y_max(), Preset::min_speed,
+            Preset::max_speed);
+  return d_t;
+}
+
+// true if a specialization matches pars' rule coefficients
+bool has_specialized_kernel(Parameters const& pars);
+
+// picks the specialization matching pars and evolves state with it, returning
+// the step used (nothing if no specialization matches or if pars asks for the
+// generic evolution)
+std::optional<double> specialized_evolve(std::vector<Boid>& state,
+                                         Parameters const& pars,
+                                         double max_d_t);
+
+#endif
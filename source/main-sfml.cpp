@@ -24,7 +24,10 @@ int main(int argc, char* argv[])
     double min_speed_fraction{.5};
     int delta_t{1};
     int fps{60};
+    int tick_rate{0};
     int N_boids{80};
+    std::string replay{};
+    auto kernels{false};
     auto show_help{false};
 
     // display width and height
@@ -33,8 +36,9 @@ int main(int argc, char* argv[])
 
     // Parser with multiple option arguments and help option
     auto parser = get_parser(angle, d, d_s, s, c, a, max_speed,
-                             min_speed_fraction, delta_t, fps, N_boids,
-                             display_width, display_height, show_help);
+                             min_speed_fraction, delta_t, fps, tick_rate,
+                             N_boids, display_width, display_height, replay,
+                             kernels, show_help);
 
     // Parses the arguments
     auto result = parser.parse({argc, argv});
@@ -54,6 +58,19 @@ int main(int argc, char* argv[])
 
     assert(result && (!show_help));
 
+    // a trajectory replayed needs no parameters but the frame rate
+    if (!replay.empty()) {
+      is_greater_than(fps, 0, "frames-per-second");
+      Trajectory const trajectory{replay};
+      if (trajectory.empty()) {
+        throw std::runtime_error{"ERROR: No frames in " + replay};
+      }
+      sf::RenderWindow window(sf::VideoMode(display_width, display_height),
+                              "Flock replay");
+      replay_loop(window, trajectory, fps);
+      return EXIT_SUCCESS;
+    }
+
     // delta_t is the only input par not passed directly to Parameters'
     // constructor, so its input is validated before
     if (delta_t <= 0 || delta_t >= 125) {
@@ -61,13 +78,23 @@ int main(int argc, char* argv[])
     }
 
     double const duration{sf::milliseconds(delta_t).asSeconds()};
-    int const steps{1000 / (delta_t * fps)}; // steps per evolution
+    // the flock is evolved tick_rate times per second, frames in between are
+    // interpolated
+    if (tick_rate == 0) {
+      tick_rate = fps;
+    }
+    if (tick_rate < 0 || tick_rate > fps) {
+      throw Invalid_Parameter{
+          "Parameter tick-rate is not in the required range"};
+    }
+    int const steps{1000 / (delta_t * tick_rate)}; // steps per evolution
     int const fps_limit{1000 / delta_t};
 
     Parameters pars{angle,    d,     d_s,       s,
                     c,        a,     max_speed, min_speed_fraction,
                     duration, steps, fps,       fps_limit,
                     N_boids};
+    pars.set_specialized() = kernels;
 
     // obtains seed to pass to random number engine
     std::random_device rd;
@@ -80,7 +107,7 @@ int main(int argc, char* argv[])
     // graphics
     sf::RenderWindow window(sf::VideoMode(display_width, display_height),
                             "Flock simulation");
-    game_loop(window, flock, pars, seed);
+    game_loop(window, flock, pars, seed, tick_rate);
 
   } catch (Invalid_Parameter const& par_err) {
     std::cerr << "Invalid Parameter: " << par_err.what() << '\n';
@@ -1,10 +1,20 @@
+#include "autotune.hpp"
 #include "boids.hpp"
 #include "flock.hpp"
+#include "output.hpp"
 #include "parameters.hpp"
 #include "parser.hpp"
+#include "raster.hpp"
+#include "shm_ring.hpp"
 #include "stats.hpp"
+#include "stream.hpp"
+#include "trajectory.hpp"
+#include "verify.hpp"
+#include "warm_start.hpp"
 
+#include <algorithm>
 #include <fstream>
+#include <optional>
 #include <random>
 
 int main(int argc, char* argv[])
@@ -24,12 +34,48 @@ int main(int argc, char* argv[])
     int prescale{40};
     int N_boids{120};
     auto save_data{false};
+    auto adaptive_step{false};
+    auto sleeping{false};
+    auto approximate{false};
+    auto kernels{false};
+    int reorder_interval{0};
+    int threads{1};
+    auto static_partition{false};
+    int cell_list{0};
+    auto tiled{false};
+    auto tune{false};
+    int memory{256};
+    std::string output{};
+    std::string serve{};
+    std::string shm{};
+    std::string obstacles{};
+    std::string frames{};
+    std::string render{"boids"};
+    int frame_width{800};
+    std::string trajectory{};
+    int seed{-1};
+    int burn_in{0};
+    std::string warm_cache{".boids_cache"};
+    int converge{0};
+    double tolerance{.05};
+    std::string rdf_file{};
+    double rdf_cutoff{3.};
+    int rdf_bins{30};
+    int verify_steps{0};
+    double verify_tolerance{1e-9};
+    double rate{30.};
     auto show_help{false};
 
     // Parser with multiple option arguments and help option
     auto parser =
         get_parser(angle, d, d_s, s, c, a, max_speed, min_speed_fraction,
-                   duration, steps, prescale, N_boids, save_data, show_help);
+                   duration, steps, prescale, N_boids, save_data, adaptive_step,
+                   sleeping, approximate, kernels, reorder_interval, threads,
+                   static_partition, cell_list, tiled, tune, memory, output,
+                   serve, rate, shm, obstacles, frames, render, frame_width,
+                   trajectory, seed, burn_in, warm_cache, converge, tolerance,
+                   rdf_file, rdf_cutoff, rdf_bins, verify_steps,
+                   verify_tolerance, show_help);
 
     // Parses the arguments
     auto result = parser.parse({argc, argv});
@@ -51,31 +97,270 @@ int main(int argc, char* argv[])
 
     int const prescale_limit{steps};
 
-    Parameters const pars{angle,    d,     d_s,       s,
-                          c,        a,     max_speed, min_speed_fraction,
-                          duration, steps, prescale,  prescale_limit,
-                          N_boids};
+    Parameters pars{angle,    d,     d_s,       s,
+                    c,        a,     max_speed, min_speed_fraction,
+                    duration, steps, prescale,  prescale_limit,
+                    N_boids};
+    pars.set_adaptive_step() = adaptive_step;
+    pars.set_sleeping()      = sleeping;
+    pars.set_approximate()   = approximate;
+    pars.set_specialized()   = kernels;
+    is_greater_than(reorder_interval, -1, "reorder interval");
+    pars.set_reorder_interval() = reorder_interval;
+    is_greater_than(threads, 0, "threads");
+    pars.set_threads()       = threads;
+    pars.set_work_stealing() = !static_partition;
+    is_greater_than(cell_list, -1, "cells");
+    pars.set_cell_list() = cell_list;
+    pars.set_tiled()     = tiled;
+    is_greater_than(memory, 0, "memory");
+    is_greater_than(rate, 0., "rate");
+    is_greater_than(frame_width, 0, "frame-width");
+    // -1 stands for a random seed
+    if (seed != -1) {
+      is_greater_than(seed, -1, "seed");
+    }
+    is_greater_than(burn_in, -1, "burn-in-steps");
+    if (converge != 0) {
+      is_greater_than(converge, 1, "window");
+    }
+    is_greater_than(tolerance, 0., "tolerance");
+    is_greater_than(rdf_cutoff, 0., "cutoff");
+    is_greater_than(rdf_bins, 0, "bins");
+    is_greater_than(verify_steps, -1, "steps");
+    if (verify_tolerance < 0.) {
+      throw Invalid_Parameter{
+          "Parameter tolerance must be greater than or equal to 0"};
+    }
+    Render_mode const render_mode{to_render_mode(render)};
+    if (!trajectory.empty() && frames.empty()) {
+      throw Invalid_Parameter{"Rendering a trajectory requires --frames"};
+    }
+    // frames are drawn in tiles by as many threads as the flying rules
+    Rasterizer const rasterizer{
+        pars.get_x_min(), pars.get_x_max(), pars.get_y_min(), pars.get_y_max(),
+        frame_width,
+        std::max(static_cast<int>(frame_width
+                                  * (pars.get_y_max() - pars.get_y_min())
+                                  / (pars.get_x_max() - pars.get_x_min())),
+                 1),
+        threads};
+    Image image{};
+    int frame{0};
+
+    // a trajectory is rendered as it is, no simulation taking place
+    if (!trajectory.empty()) {
+      Trajectory const file{trajectory};
+      std::vector<Boid> state{};
+      for (; frame != file.size(); ++frame) {
+        write_ppm(
+            rasterizer.render(file.read(frame, state), render_mode, image),
+            frame_name(frames, frame));
+      }
+      std::cout << frame << " frames of " << trajectory << " rendered to "
+                << frames << "_*.ppm\n";
+      return EXIT_SUCCESS;
+    }
 
-    // obtains seed to pass to random number engine
+    // obtains seed to pass to random number engine, unless one was given
     std::random_device rd;
-    auto const seed{rd()};
+    auto const flock_seed{(seed == -1) ? rd()
+                                       : static_cast<unsigned int>(seed)};
     // fills empty vector with N_boids randomly generated and uses it to
     // initialize flock
     std::vector<Boid> boids{};
-    Flock flock{fill(boids, pars, seed)};
+    Flock flock{fill(boids, pars, flock_seed)};
+    if (!obstacles.empty()) {
+      flock.set_obstacles(read_obstacles(obstacles));
+      std::cout << flock.obstacles().size() << " obstacles read from "
+                << obstacles << '\n';
+    }
+    // the transient from the random state is skipped by starting from the
+    // state it ended in, if an earlier run cached it. A random seed's state is
+    // never met again: it's burnt in without filling the cache
+    if (burn_in > 0 && seed == -1) {
+      for (int i{0}; i != burn_in; ++i) {
+        flock.evolve(pars);
+      }
+      std::cout << "Burn-in done: state not cached, as no seed was given\n";
+    } else if (burn_in > 0) {
+      std::cout << ((warm_start(flock, pars, flock_seed, burn_in, warm_cache))
+                        ? "Burn-in skipped: cached state found in "
+                        : "Burn-in done: state cached in ")
+                << warm_cache << '\n';
+    }
+
+    // the neighbours' search and the number of threads are chosen from trials
+    // on the flock (or from earlier runs' ones)
+    if (tune) {
+      bool const cached{autotune(flock, pars, warm_cache)};
+      std::string const search{
+          (pars.get_cell_list() > 0)
+              ? std::to_string(pars.get_cell_list()) + " cells per distance"
+          : (pars.get_tiled())       ? "whole flock in tiles"
+          : (pars.get_specialized()) ? "whole flock (kernels)"
+                                     : "whole flock"};
+      std::cout << ((cached) ? "Tuning read from " : "Tuning tried, cached in ")
+                << warm_cache << ": search " << search << ", "
+                << pars.get_threads() << " threads\n";
+    }
+
+    // the evolution of the flock is checked against its reference instead
+    if (verify_steps > 0) {
+      Verification const verification{
+          verify(flock, pars, verify_steps, verify_tolerance)};
+      // deviations accumulated over many steps are amplified by the flock's
+      // chaotic motion: those of each step alone judge the evolution
+      std::cout << "\n  STEP:    MAX DEVIATION IN THE STEP:     MAX DEVIATION "
+                   "ACCUMULATED:\n"
+                   "          POSITION:       VELOCITY:      POSITION:       "
+                   "VELOCITY:\n\n"
+                << std::scientific << std::setprecision(3);
+      for (int step{0}; step != verify_steps; ++step) {
+        Deviation const& d{verification.steps[step]};
+        Deviation const& a{verification.accumulated[step]};
+        std::cout << std::setw(8) << step + 1 << std::setw(15) << d.position
+                  << std::setw(16) << d.velocity << std::setw(15)
+                  << a.position << std::setw(16) << a.velocity << '\n';
+      }
+      if (verification.first_step < 0) {
+        std::cout << "\nNo boid deviated by more than " << verify_tolerance
+                  << " in a step\n";
+      } else {
+        std::cout << "\nFirst boid deviating by more than " << verify_tolerance
+                  << " in a step: boid " << verification.first_id
+                  << " in step " << verification.first_step + 1 << '\n';
+      }
+      return (verification.first_step < 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-    // performs the simulation and saves its data in vector 'states'
-    std::vector<std::vector<Boid>> states;
-    simulate(flock, pars, states);
+    // performs the simulation and saves its data in store 'states'
+    // observables are computed while the flock is evolved
+    Snapshot_store states{static_cast<std::size_t>(memory) << 20};
+    Observables observables{default_observables()};
+    // snapshots are written to file by a thread of their own, and frames are
+    // streamed to the connected clients, while the simulation goes on
+    std::optional<Async_writer> writer{};
+    if (!output.empty()) {
+      writer.emplace(output);
+    }
+    // snapshots are also published in a shared memory ring for local readers
+    std::optional<Shm_ring_writer> ring{};
+    if (!shm.empty()) {
+      int constexpr ring_slots{8};
+      ring.emplace(shm, ring_slots, N_boids);
+      std::cout << "Publishing states in shared memory " << shm << '\n';
+    }
+    // the statistics of every stored state are computed by workers of their
+    // own, using the cores the flying rules leave idle
+    // g(r) of each state is written as soon as it's computed
+    Rdf_binning rdf_binning{};
+    std::ofstream rdf_out{};
+    Stats_callback on_stats{};
+    if (!rdf_file.empty()) {
+      rdf_binning = {rdf_cutoff * pars.get_d(), rdf_bins,
+                     (pars.get_x_max() - pars.get_x_min())
+                         * (pars.get_y_max() - pars.get_y_min())};
+      rdf_out.open(rdf_file);
+      if (!rdf_out) {
+        throw std::ios_base::failure{"ERROR: Cannot open file " + rdf_file
+                                     + '\n'};
+      }
+      write_rdf_bins(rdf_out, rdf_binning);
+      on_stats = [&](double time, State_stats const& s) {
+        write_rdf_line(rdf_out, time, s);
+      };
+    }
+    Stats_pool stats{
+        pars.get_d(),
+        std::max(static_cast<int>(std::thread::hardware_concurrency())
+                     - pars.get_threads(),
+                 1),
+        rdf_binning, on_stats};
+    Snapshot_callback on_save{[&](Snapshot const& snapshot) {
+      stats.push(snapshot);
+      if (writer) {
+        writer->push(snapshot);
+      }
+      if (ring) {
+        ring->publish(snapshot);
+      }
+      if (!frames.empty()) {
+        write_ppm(rasterizer.render(snapshot.state, render_mode, image),
+                  frame_name(frames, frame++));
+      }
+    }};
+    std::optional<Stream_server> server{};
+    Step_callback on_step{};
+    if (!serve.empty()) {
+      server.emplace(serve,
+                     Quantization{pars.get_x_min(), pars.get_x_max(),
+                                  pars.get_y_min(), pars.get_y_max(),
+                                  pars.get_max_speed()},
+                     rate);
+      on_step = [&](Flock const& f) { server->publish(f.state()); };
+      std::cout << "Streaming frames on " << serve << '\n';
+    }
+    // the simulation may stop as soon as the observables are steady
+    std::optional<Convergence> convergence{};
+    if (converge != 0) {
+      convergence.emplace(converge, tolerance);
+    }
+    simulate(flock, pars, states, observables, on_save, on_step,
+             (convergence) ? &*convergence : nullptr);
+    if (convergence) {
+      if (convergence->converged()) {
+        std::cout << "Converged at step " << convergence->step() << " (time "
+                  << convergence->time() << "), simulation stopped\n";
+      } else {
+        std::cout << "No convergence within the simulation\n";
+      }
+    }
+    if (writer) {
+      writer->close();
+      std::cout << "Data and trajectories have been saved to files " << output
+                << ".txt and " << output << ".trj\n";
+    }
+    if (!frames.empty()) {
+      std::cout << frame << " frames rendered to " << frames << "_*.ppm\n";
+    }
+    if (server) {
+      std::cout << "Frames streamed: " << server->sent() << ", dropped: "
+                << server->dropped() << '\n';
+    }
 
     // data analysis and printing
+    auto const& state_stats{stats.close()};
+    assert(state_stats.size() == states.size());
+    if (!rdf_file.empty()) {
+      rdf_out.close();
+      if (!rdf_out) {
+        throw std::ios_base::failure{"ERROR: Cannot write file " + rdf_file
+                                     + '\n'};
+      }
+      std::cout << "Radial distribution functions have been saved to file "
+                << rdf_file << '\n';
+    }
     std::cout << "\n  Report for each of the stored states:\n";
     std::cout << "\n  AVERAGE DISTANCE:              AVERAGE SPEED: \n\n";
-    std::for_each(states.begin(), states.end(), print_state);
+    std::for_each(state_stats.begin(), state_stats.end(),
+                  [](State_stats const& s) { print_state(s); });
+    std::cout << "\n  Observables for each of the stored states:\n\n ";
+    for (auto const& name : observables.names()) {
+      std::cout << ' ' << name << " |";
+    }
+    std::cout << "\n\n";
+    std::for_each(states.begin(), states.end(), print_observations);
+    std::cout << "\n  Clusters of boids closer than d, for each of the stored "
+                 "states:\n";
+    std::cout << "\n  NUMBER:        SIZES: \n\n";
+    std::for_each(state_stats.begin(), state_stats.end(),
+                  [](State_stats const& s) { print_clusters(s); });
 
     std::cout << '\n' << std::setfill('=') << std::setw(53);
     std::cout << '\n' << "    SUMMARY: Parameters used in the simulation\n\n";
     print_parameters(pars);
+    print_profile(flock, states);
 
     // Saves data if asked for
     if (save_data) {
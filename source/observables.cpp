@@ -0,0 +1,231 @@
+#include "observables.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// defines Welford's accumulator, the predefined observables, the engine
+// feeding them and the convergence monitor
+
+Result not_sampled()
+{
+  double constexpr nan{std::numeric_limits<double>::quiet_NaN()};
+  return {nan, nan};
+}
+
+void Welford::add(double x)
+{
+  ++n_;
+  double const delta{x - mean_};
+  mean_ += delta / n_;
+  m2_ += delta * (x - mean_);
+}
+
+double Welford::variance() const
+{
+  return (n_ > 1) ? m2_ / (n_ - 1) : 0.;
+}
+
+double Welford::std_dev() const
+{
+  return std::sqrt(variance());
+}
+
+Result Welford::result() const
+{
+  return (n_ > 0) ? Result{mean_, std_dev()} : not_sampled();
+}
+
+std::string Speed::name() const
+{
+  return "speed";
+}
+void Speed::reset()
+{
+  speed_ = {};
+}
+void Speed::add(Sample const& sample)
+{
+  speed_.add(sample.speed);
+}
+Result Speed::result() const
+{
+  return speed_.result();
+}
+
+std::string Polarization::name() const
+{
+  return "polarization";
+}
+void Polarization::reset()
+{
+  x_ = {};
+  y_ = {};
+}
+void Polarization::add(Sample const& sample)
+{
+  if (sample.boid.is_pred() || sample.speed == 0.) {
+    return;
+  }
+  x_.add(sample.boid.velocity().x() / sample.speed);
+  y_.add(sample.boid.velocity().y() / sample.speed);
+}
+Result Polarization::result() const
+{
+  if (x_.count() == 0) {
+    return not_sampled();
+  }
+  return {std::sqrt(x_.mean() * x_.mean() + y_.mean() * y_.mean()),
+          std::sqrt(x_.variance() + y_.variance())};
+}
+
+std::string Nn_distance::name() const
+{
+  return "nearest-neighbour distance";
+}
+void Nn_distance::reset()
+{
+  dist_ = {};
+}
+void Nn_distance::add(Sample const& sample)
+{
+  if (std::isfinite(sample.nn_dist)) {
+    dist_.add(sample.nn_dist);
+  }
+}
+Result Nn_distance::result() const
+{
+  return dist_.result();
+}
+
+std::string Prey_distance::name() const
+{
+  return "predator-to-prey distance";
+}
+void Prey_distance::reset()
+{
+  dist_ = {};
+}
+void Prey_distance::add(Sample const& sample)
+{
+  if (sample.boid.is_pred() && std::isfinite(sample.prey_dist)) {
+    dist_.add(sample.prey_dist);
+  }
+}
+Result Prey_distance::result() const
+{
+  return dist_.result();
+}
+
+void Observables::add(std::unique_ptr<Observable> observable)
+{
+  assert(observable);
+  observables_.push_back(std::move(observable));
+}
+
+void Observables::reset()
+{
+  for (auto& observable : observables_) {
+    observable->reset();
+  }
+}
+
+void Observables::add(Sample const& sample)
+{
+  for (auto& observable : observables_) {
+    observable->add(sample);
+  }
+}
+
+std::vector<std::string> Observables::names() const
+{
+  std::vector<std::string> names{};
+  std::transform(observables_.begin(), observables_.end(),
+                 std::back_inserter(names),
+                 [](auto const& observable) { return observable->name(); });
+  return names;
+}
+
+std::vector<Result> Observables::results() const
+{
+  std::vector<Result> results{};
+  std::transform(observables_.begin(), observables_.end(),
+                 std::back_inserter(results),
+                 [](auto const& observable) { return observable->result(); });
+  return results;
+}
+
+Observables default_observables()
+{
+  Observables observables{};
+  observables.add(std::make_unique<Speed>());
+  observables.add(std::make_unique<Polarization>());
+  observables.add(std::make_unique<Nn_distance>());
+  observables.add(std::make_unique<Prey_distance>());
+  return observables;
+}
+
+Convergence::Convergence(int window, double tolerance)
+    : window_{window}
+    , tolerance_{tolerance}
+{
+  assert(window_ > 1 && tolerance_ >= 0.);
+}
+
+// every quantity's range over the window is within tolerance of its mean over
+// the window (quantities that never changed, even infinite ones, are steady)
+bool Convergence::steady() const
+{
+  std::size_t const n_results{recent_.front().size()};
+  for (std::size_t i{0}; i != 2 * n_results; ++i) {
+    auto value = [&](std::vector<Result> const& results) {
+      Result const& r{results[i / 2]};
+      return (i % 2 == 0) ? r.mean : r.std_dev;
+    };
+    double const first{value(recent_.front())};
+    double min{first};
+    double max{first};
+    double sum{0.};
+    std::size_t not_sampled{0};
+    for (auto const& results : recent_) {
+      if (std::isnan(value(results))) {
+        ++not_sampled;
+        continue;
+      }
+      min = std::min(min, value(results));
+      max = std::max(max, value(results));
+      sum += value(results);
+    }
+    // quantities never sampled over the window (e.g. the distance of
+    // predators from their preys, with no predators) are left out, while
+    // those sampled only by some states aren't steady yet
+    if (not_sampled == recent_.size()) {
+      continue;
+    }
+    if (not_sampled != 0) {
+      return false;
+    }
+    if (min != max
+        && !(max - min <= tolerance_ * std::abs(sum / recent_.size()))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Convergence::add(std::vector<Result> const& results, int step,
+                      double time)
+{
+  if (converged()) {
+    return true;
+  }
+  assert(recent_.empty() || results.size() == recent_.front().size());
+  recent_.push_back(results);
+  if (static_cast<int>(recent_.size()) > window_) {
+    recent_.pop_front();
+  }
+  if (static_cast<int>(recent_.size()) == window_ && steady()) {
+    step_ = step;
+    time_ = time;
+  }
+  return converged();
+}
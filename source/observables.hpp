@@ -0,0 +1,165 @@
+#ifndef OBSERVABLES_HPP
+#define OBSERVABLES_HPP
+#include "boids.hpp"
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+// defines the observables engine: quantities accumulated boid by boid while the
+// flock is evolved, without further passes over its state
+
+// mean and standard deviation of a quantity, both NaN if it wasn't sampled
+// (e.g. the distance of predators from their preys, with no predators)
+struct Result
+{
+  double mean;
+  double std_dev;
+};
+
+// running mean and variance of a quantity, updated one value at a time
+// (Welford's algorithm, numerically stable)
+class Welford
+{
+  long n_{0};
+  double mean_{0.};
+  double m2_{0.}; // sum of squared differences from the current mean
+
+ public:
+  void add(double x);
+  // clang-format off
+  long count() const{return n_;}
+  double mean() const{return mean_;}
+  // clang-format on
+  // sample variance (null with less than two values)
+  double variance() const;
+  double std_dev() const;
+  Result result() const;
+};
+
+// quantities of a boid made available to the observables by the evolution
+struct Sample
+{
+  Boid const& boid;
+  double speed;     // norm of boid's velocity
+  double nn_dist;   // distance from the nearest other boid (infinity if none)
+  double prey_dist; // predators only: distance from the nearest regular boid
+                    // (infinity if none, or if boid is regular)
+};
+
+// interface of an observable: reset before each evolution, then fed with one
+// sample for every boid in the flock
+class Observable
+{
+ public:
+  virtual ~Observable() = default;
+  virtual std::string name() const       = 0;
+  virtual void reset()                   = 0;
+  virtual void add(Sample const& sample) = 0;
+  virtual Result result() const          = 0;
+};
+
+class Speed : public Observable
+{
+  Welford speed_;
+
+ public:
+  std::string name() const override;
+  void reset() override;
+  void add(Sample const& sample) override;
+  Result result() const override;
+};
+
+// order parameter: norm of the mean heading of regular boids (1 when they all
+// fly in the same direction), with the spread of headings around the mean
+class Polarization : public Observable
+{
+  Welford x_;
+  Welford y_;
+
+ public:
+  std::string name() const override;
+  void reset() override;
+  void add(Sample const& sample) override;
+  Result result() const override;
+};
+
+class Nn_distance : public Observable
+{
+  Welford dist_;
+
+ public:
+  std::string name() const override;
+  void reset() override;
+  void add(Sample const& sample) override;
+  Result result() const override;
+};
+
+class Prey_distance : public Observable
+{
+  Welford dist_;
+
+ public:
+  std::string name() const override;
+  void reset() override;
+  void add(Sample const& sample) override;
+  Result result() const override;
+};
+
+// set of observables fed together
+class Observables
+{
+  std::vector<std::unique_ptr<Observable>> observables_;
+
+ public:
+  void add(std::unique_ptr<Observable> observable);
+  bool empty() const
+  {
+    return observables_.empty();
+  }
+  void reset();
+  void add(Sample const& sample);
+  std::vector<std::string> names() const;
+  std::vector<Result> results() const;
+};
+
+// speed, polarization, nearest-neighbour and predator-to-prey distance
+Observables default_observables();
+
+// convergence monitor of a run, fed with the results of the observables of
+// every state stored: the run has converged once every mean and standard
+// deviation stayed within tolerance (relative to its mean over the window)
+// for the last window states. With the default observables these are the
+// mean speed, the polarization and the nearest-neighbour distance, standing
+// for the mean distance between boids (which takes every pair, see stats.hpp),
+// and the distance of predators from their preys; quantities with no samples
+// over the window (NaN results, e.g. the latter with no predators) are left
+// out
+class Convergence
+{
+  int window_;
+  double tolerance_;
+  std::deque<std::vector<Result>> recent_; // the last window results at most
+  int step_{-1};                           // step at which it converged
+  double time_{0.};
+
+  bool steady() const;
+
+ public:
+  explicit Convergence(int window, double tolerance);
+
+  // returns whether the run has converged, with results those of the state
+  // of step (at time) or any earlier one
+  bool add(std::vector<Result> const& results, int step, double time);
+  bool converged() const
+  {
+    return step_ >= 0;
+  }
+  // clang-format off
+  int window() const{return window_;}
+  int step() const{return step_;}
+  double time() const{return time_;}
+  // clang-format on
+};
+
+#endif
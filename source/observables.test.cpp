@@ -0,0 +1,152 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "observables.hpp"
+#include "doctest.h"
+#include <cmath>
+#include <limits>
+
+TEST_CASE("testing Welford")
+{
+  Welford w{};
+  CHECK(w.count() == 0);
+  CHECK(w.variance() == 0.);
+  w.add(2.);
+  CHECK(w.mean() == 2.);
+  CHECK(w.variance() == 0.);
+  w.add(4.);
+  w.add(4.);
+  w.add(4.);
+  w.add(5.);
+  w.add(5.);
+  w.add(7.);
+  w.add(9.);
+  CHECK(w.count() == 8);
+  CHECK(w.mean() == doctest::Approx(5.));
+  CHECK(w.variance() == doctest::Approx(32. / 7.));
+  CHECK(w.result().std_dev == doctest::Approx(std::sqrt(32. / 7.)));
+
+  SUBCASE("large offset doesn't spoil variance")
+  {
+    Welford w_off{};
+    for (double x : {1e9 + 4., 1e9 + 7., 1e9 + 13., 1e9 + 16.}) {
+      w_off.add(x);
+    }
+    CHECK(w_off.variance() == doctest::Approx(30.));
+  }
+}
+
+TEST_CASE("testing observables")
+{
+  double const inf{std::numeric_limits<double>::infinity()};
+  Boid b1{{0., 0.}, {3., 4.}};
+  Boid b2{{1., 0.}, {0., 2.}};
+  Boid b3{{5., 5.}, {-6., 8.}};
+  Boid b4_p{{9., 9.}, {1., 0.}, true};
+  std::vector<Sample> samples{{b1, 5., 1., inf},
+                              {b2, 2., 1., inf},
+                              {b3, 10., 5.6568542, inf},
+                              {b4_p, 1., 5.6568542, 5.6568542}};
+
+  SUBCASE("testing Speed")
+  {
+    Speed speed{};
+    for (auto const& sample : samples) {
+      speed.add(sample);
+    }
+    CHECK(speed.result().mean == doctest::Approx(4.5));
+    CHECK(speed.result().std_dev == doctest::Approx(std::sqrt(49. / 3.)));
+    speed.reset();
+    CHECK(std::isnan(speed.result().mean));
+    CHECK(std::isnan(speed.result().std_dev));
+  }
+
+  SUBCASE("testing Polarization")
+  {
+    Polarization pol{};
+    pol.add(samples[0]);
+    pol.add(samples[0]);
+    CHECK(pol.result().mean == doctest::Approx(1.));
+    CHECK(pol.result().std_dev == doctest::Approx(0.));
+    pol.add(samples[2]); // heading (-.6, .8)
+    pol.add(samples[3]); // predators are ignored
+    CHECK(pol.result().mean
+          == doctest::Approx(std::sqrt(.2 * .2 + .8 * .8) * 1.));
+    CHECK(pol.result().mean < 1.);
+  }
+
+  SUBCASE("testing distances")
+  {
+    Nn_distance nn{};
+    Prey_distance prey{};
+    for (auto const& sample : samples) {
+      nn.add(sample);
+      prey.add(sample);
+    }
+    CHECK(nn.result().mean == doctest::Approx(3.3284271));
+    CHECK(prey.result().mean == doctest::Approx(5.6568542));
+    CHECK(prey.result().std_dev == 0.);
+
+    // with no predators, nothing is sampled
+    Prey_distance no_prey{};
+    Polarization no_pol{};
+    no_prey.add(samples[0]);
+    no_pol.add(samples[3]);
+    CHECK(std::isnan(no_prey.result().mean));
+    CHECK(std::isnan(no_pol.result().mean));
+  }
+
+  SUBCASE("testing Observables")
+  {
+    Observables observables{default_observables()};
+    CHECK(observables.names()
+          == std::vector<std::string>{"speed", "polarization",
+                                      "nearest-neighbour distance",
+                                      "predator-to-prey distance"});
+    for (auto const& sample : samples) {
+      observables.add(sample);
+    }
+    auto const results{observables.results()};
+    CHECK(results.size() == 4u);
+    CHECK(results[0].mean == doctest::Approx(4.5));
+    CHECK(results[3].mean == doctest::Approx(5.6568542));
+    observables.reset();
+    CHECK(std::isnan(observables.results()[0].mean));
+    CHECK(Observables{}.empty());
+  }
+}
+
+TEST_CASE("testing Convergence")
+{
+  Convergence convergence{3, .1};
+  CHECK(convergence.window() == 3);
+  // spreads of 1 around speeds of 10: steady within 10% only from step 3
+  CHECK_FALSE(convergence.add({{5., 1.}, {0., 0.}}, 0, 0.));
+  CHECK_FALSE(convergence.add({{10., 1.}, {0., 0.}}, 1, .5));
+  CHECK_FALSE(convergence.add({{10.5, 1.}, {0., 0.}}, 2, 1.));
+  CHECK_FALSE(convergence.converged());
+  CHECK(convergence.add({{10., 1.05}, {0., 0.}}, 3, 1.5));
+  CHECK(convergence.converged());
+  CHECK(convergence.step() == 3);
+  CHECK(convergence.time() == 1.5);
+  // once converged, the run stays so
+  CHECK(convergence.add({{50., 1.}, {0., 0.}}, 4, 2.));
+  CHECK(convergence.step() == 3);
+
+  // spreads are monitored as well as means, constant quantities are steady
+  // even if infinite
+  double const inf{std::numeric_limits<double>::infinity()};
+  Convergence spread{2, .1};
+  CHECK_FALSE(spread.add({{10., 1.}, {inf, 0.}}, 0, 0.));
+  CHECK_FALSE(spread.add({{10., 2.}, {inf, 0.}}, 1, 1.));
+  CHECK(spread.add({{10., 2.1}, {inf, 0.}}, 2, 2.));
+  CHECK(spread.step() == 2);
+
+  // quantities not sampled are left out, unless sampled by some states
+  double const nan{std::numeric_limits<double>::quiet_NaN()};
+  Convergence unsampled{2, .1};
+  CHECK_FALSE(unsampled.add({{10., 1.}, {nan, nan}}, 0, 0.));
+  CHECK(unsampled.add({{10., 1.}, {nan, nan}}, 1, 1.));
+  Convergence partial{2, .1};
+  CHECK_FALSE(partial.add({{10., 1.}, {nan, nan}}, 0, 0.));
+  CHECK_FALSE(partial.add({{10., 1.}, {5., 1.}}, 1, 1.));
+  CHECK(partial.add({{10., 1.}, {5., 1.}}, 2, 2.));
+}
@@ -0,0 +1,131 @@
+#include "obstacles.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+// defines obstacles' geometry, the construction of their hierarchy and the
+// reading of obstacles from file
+
+Position axis_point(Obstacle const& obstacle, Position const& p)
+{
+  Position const ab{obstacle.b - obstacle.a};
+  Position const ap{p - obstacle.a};
+  double const length2{ab.x() * ab.x() + ab.y() * ab.y()};
+  // projection of p on the segment, clamped to its ends
+  double t{0.};
+  if (length2 != 0.) {
+    t = std::clamp((ap.x() * ab.x() + ap.y() * ab.y()) / length2, 0., 1.);
+  }
+  return Position{obstacle.a.x() + ab.x() * t, obstacle.a.y() + ab.y() * t};
+}
+
+double distance(Obstacle const& obstacle, Position const& p)
+{
+  return norm(p - axis_point(obstacle, p)) - obstacle.radius;
+}
+
+// obstacles in a leaf: few enough that testing them all costs less than
+// descending further
+int constexpr leaf_size{4};
+
+Obstacles::Obstacles(std::vector<Obstacle> obstacles)
+    : obstacles_{std::move(obstacles)}
+{
+  if (!obstacles_.empty()) {
+    nodes_.reserve(2 * obstacles_.size() / leaf_size + 1);
+    build(0, size(), 1);
+  }
+}
+
+// builds the subtree of obstacles_[first] ... obstacles_[last - 1], splitting
+// them in halves along the longest side of their centres' bounding box, and
+// returns the index of its root
+int Obstacles::build(int first, int last, int depth)
+{
+  assert(last > first);
+  depth_ = std::max(depth_, depth);
+  int const index{static_cast<int>(nodes_.size())};
+  Node node{obstacles_[first].a, obstacles_[first].a, first, 0, 0};
+  Position c_min{obstacles_[first].a};
+  Position c_max{obstacles_[first].a};
+  for (int i{first}; i != last; ++i) {
+    Obstacle const& o{obstacles_[i]};
+    node.min = Position{std::min({node.min.x(), o.a.x() - o.radius,
+                                  o.b.x() - o.radius}),
+                        std::min({node.min.y(), o.a.y() - o.radius,
+                                  o.b.y() - o.radius})};
+    node.max = Position{std::max({node.max.x(), o.a.x() + o.radius,
+                                  o.b.x() + o.radius}),
+                        std::max({node.max.y(), o.a.y() + o.radius,
+                                  o.b.y() + o.radius})};
+    Position const centre{(o.a + o.b) * .5};
+    c_min = Position{std::min(c_min.x(), centre.x()),
+                     std::min(c_min.y(), centre.y())};
+    c_max = Position{std::max(c_max.x(), centre.x()),
+                     std::max(c_max.y(), centre.y())};
+  }
+  if (last - first <= leaf_size) {
+    node.count = last - first;
+    nodes_.push_back(node);
+    return index;
+  }
+  nodes_.push_back(node);
+
+  bool const along_x{c_max.x() - c_min.x() >= c_max.y() - c_min.y()};
+  auto const centre{[along_x](Obstacle const& o) {
+    return (along_x) ? o.a.x() + o.b.x() : o.a.y() + o.b.y();
+  }};
+  int const middle{first + (last - first) / 2};
+  std::nth_element(obstacles_.begin() + first, obstacles_.begin() + middle,
+                   obstacles_.begin() + last,
+                   [&](Obstacle const& o1, Obstacle const& o2) {
+                     return centre(o1) < centre(o2);
+                   });
+  build(first, middle, depth + 1);
+  int const right{build(middle, last, depth + 1)};
+  nodes_[index].right = right;
+  return index;
+}
+
+Obstacles read_obstacles(std::string const& filename)
+{
+  std::ifstream file{filename};
+  if (!file) {
+    throw std::runtime_error{"ERROR: Cannot open file " + filename};
+  }
+  std::vector<Obstacle> obstacles{};
+  std::string line{};
+  for (int n{1}; std::getline(file, line); ++n) {
+    std::istringstream words{line};
+    std::string kind{};
+    if (!(words >> kind) || kind[0] == '#') {
+      continue;
+    }
+    double x1{0.};
+    double y1{0.};
+    double x2{0.};
+    double y2{0.};
+    double size{0.};
+    bool valid{false};
+    if (kind == "pillar") {
+      valid = static_cast<bool>(words >> x1 >> y1 >> size) && size > 0.;
+      obstacles.push_back(Obstacle{{x1, y1}, {x1, y1}, size});
+    } else if (kind == "wall") {
+      valid = static_cast<bool>(words >> x1 >> y1 >> x2 >> y2);
+      // thickness is optional
+      if (valid && !(words >> size)) {
+        size = 0.;
+        words.clear();
+      }
+      valid = valid && size >= 0.;
+      obstacles.push_back(Obstacle{{x1, y1}, {x2, y2}, size / 2.});
+    }
+    std::string rest{};
+    if (!valid || words >> rest) {
+      throw std::runtime_error{"ERROR: Invalid obstacle in " + filename
+                               + ", line " + std::to_string(n)};
+    }
+  }
+  return Obstacles{std::move(obstacles)};
+}
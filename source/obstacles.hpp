@@ -0,0 +1,90 @@
+#ifndef OBSTACLES_HPP
+#define OBSTACLES_HPP
+#include "boids.hpp"
+#include <string>
+#include <vector>
+
+// defines static obstacles (walls and pillars) and class Obstacles, which
+// indexes them with a bounding volume hierarchy built once: finding the
+// obstacles near a point visits a number of nodes logarithmic in their number
+
+// points closer than radius to the segment from a to b: a wall (with
+// thickness 2 * radius) or, if a and b coincide, a pillar
+struct Obstacle
+{
+  Position a;
+  Position b;
+  double radius;
+};
+
+// point of the segment from a to b closest to p
+Position axis_point(Obstacle const& obstacle, Position const& p);
+// distance of p from the obstacle's surface (negative if p is inside it)
+double distance(Obstacle const& obstacle, Position const& p);
+
+class Obstacles
+{
+  // nodes are stored depth first: the left child of a node follows it, its
+  // right child is at index right. Leaves hold obstacles_[first] ...
+  // obstacles_[first + count - 1]
+  struct Node
+  {
+    Position min;
+    Position max;
+    int first;
+    int count; // 0 for inner nodes
+    int right;
+  };
+  std::vector<Obstacle> obstacles_; // in the order of the leaves
+  std::vector<Node> nodes_;
+  int depth_{0};
+  int build(int first, int last, int depth);
+
+ public:
+  Obstacles() = default;
+  explicit Obstacles(std::vector<Obstacle> obstacles);
+  // clang-format off
+  bool empty() const{return obstacles_.empty();}
+  int size() const{return obstacles_.size();}
+  int depth() const{return depth_;}
+  // clang-format on
+
+  // calls f with every obstacle whose bounding box is closer than range to p
+  // (a superset of the obstacles closer than range)
+  template<class F>
+  void for_each_near(Position const& p, double range, F&& f) const
+  {
+    if (nodes_.empty()) {
+      return;
+    }
+    // the tree is balanced: its depth never exceeds 64
+    int stack[64];
+    int top{0};
+    stack[top++] = 0;
+    while (top != 0) {
+      Node const& node{nodes_[stack[--top]]};
+      if (p.x() < node.min.x() - range || p.x() > node.max.x() + range
+          || p.y() < node.min.y() - range || p.y() > node.max.y() + range) {
+        continue;
+      }
+      if (node.count != 0) {
+        for (int i{node.first}; i != node.first + node.count; ++i) {
+          f(obstacles_[i]);
+        }
+      } else {
+        stack[top++] = node.right;
+        stack[top++] = static_cast<int>(&node - nodes_.data()) + 1;
+      }
+    }
+  }
+};
+
+// reads obstacles from a file with a line for each one, either
+//   pillar <x> <y> <radius>
+// or
+//   wall <x1> <y1> <x2> <y2> [<thickness>]
+// (empty lines and lines starting with # are ignored). Throws if the file
+// can't be read or a line isn't valid
+Obstacles read_obstacles(std::string const& filename);
+
+#endif
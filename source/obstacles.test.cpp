@@ -0,0 +1,107 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "obstacles.hpp"
+#include "doctest.h"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+TEST_CASE("testing obstacles' geometry")
+{
+  Obstacle const pillar{{10., 10.}, {10., 10.}, 2.};
+  Obstacle const wall{{0., 0.}, {10., 0.}, .5};
+
+  CHECK(axis_point(pillar, Position{20., 10.}) == Position{10., 10.});
+  CHECK(distance(pillar, Position{20., 10.}) == doctest::Approx(8.));
+  CHECK(distance(pillar, Position{10., 11.}) == doctest::Approx(-1.));
+
+  CHECK(axis_point(wall, Position{4., 3.}) == Position{4., 0.});
+  CHECK(distance(wall, Position{4., 3.}) == doctest::Approx(2.5));
+  // beyond its ends, the nearest point of a wall is an end
+  CHECK(axis_point(wall, Position{-3., 4.}) == Position{0., 0.});
+  CHECK(distance(wall, Position{-3., 4.}) == doctest::Approx(4.5));
+  CHECK(axis_point(wall, Position{13., -4.}) == Position{10., 0.});
+}
+
+TEST_CASE("testing the obstacles' hierarchy")
+{
+  std::default_random_engine eng{7};
+  std::uniform_real_distribution<double> coordinate{0., 1000.};
+  std::uniform_real_distribution<double> size{.5, 5.};
+  std::vector<Obstacle> list{};
+  for (int i{0}; i != 5000; ++i) {
+    Position const a{coordinate(eng), coordinate(eng)};
+    // pillars and short walls
+    Position const b{(i % 2) ? a : a + Position{size(eng) * 4., size(eng)}};
+    list.push_back(Obstacle{a, b, size(eng)});
+  }
+  Obstacles const obstacles{list};
+  CHECK(obstacles.size() == 5000);
+  // the tree is balanced: 2^11 leaves of at most 4 obstacles each at most
+  CHECK(obstacles.depth() <= 12);
+
+  // every obstacle closer than range is found, and only a few more are
+  int missed{0};
+  long found{0};
+  long near{0};
+  for (int q{0}; q != 200; ++q) {
+    Position const p{coordinate(eng), coordinate(eng)};
+    double const range{20.};
+    int count{0};
+    obstacles.for_each_near(p, range, [&](Obstacle const&) { ++count; });
+    found += count;
+    int expected{0};
+    for (Obstacle const& o : list) {
+      if (distance(o, p) < range) {
+        ++expected;
+      }
+    }
+    near += expected;
+    missed += count < expected;
+  }
+  CHECK(missed == 0);
+  CHECK(found < 4 * near + 200 * 8);
+
+  Obstacles const none{};
+  int count{0};
+  none.for_each_near(Position{1., 1.}, 10., [&](Obstacle const&) { ++count; });
+  CHECK(none.empty());
+  CHECK(count == 0);
+}
+
+TEST_CASE("testing read_obstacles")
+{
+  std::string const filename{"obstacles_test.txt"};
+  {
+    std::ofstream file{filename};
+    file << "# a pillar and two walls\n"
+         << "pillar 50 50 5\n\n"
+         << "wall 10 10 10 90 2\n"
+         << "  wall 20 10 90 10\n";
+  }
+  Obstacles const obstacles{read_obstacles(filename)};
+  CHECK(obstacles.size() == 3);
+  int pillars{0};
+  obstacles.for_each_near(Position{50., 50.}, 1000., [&](Obstacle const& o) {
+    pillars += o.a == o.b;
+    if (o.a == Position{10., 10.}) {
+      CHECK(o.radius == 1.);
+    }
+    if (o.a == Position{20., 10.}) {
+      CHECK(o.radius == 0.);
+    }
+  });
+  CHECK(pillars == 1);
+
+  for (std::string const line :
+       {"pillar 1 2", "pillar 1 2 -3", "wall 1 2 3", "wall 1 2 3 4 five",
+        "wall 1 2 3 4 5 6", "tower 1 2 3"}) {
+    {
+      std::ofstream file{filename};
+      file << "pillar 50 50 5\n" << line << '\n';
+    }
+    CHECK_THROWS(read_obstacles(filename));
+  }
+  CHECK_THROWS(read_obstacles("no_such_file.txt"));
+  std::remove(filename.c_str());
+}
@@ -0,0 +1,92 @@
+#include "output.hpp"
+#include "bytes.hpp"
+#include "stats.hpp"
+#include <cstdint>
+#include <vector>
+
+// defines the writer thread of the output pipeline and the trajectory file's
+// frames
+
+void write_frame(std::ofstream& os, Snapshot const& snapshot)
+{
+  std::vector<char> frame(frame_header_bytes
+                          + snapshot.state.size() * boid_record_bytes);
+  char* out{frame.data()};
+  out = put(out, snapshot.time);
+  out = put(out, static_cast<std::int32_t>(snapshot.state.size()));
+  for (Boid const& boid : snapshot.state) {
+    out = put(out, boid.position().x());
+    out = put(out, boid.position().y());
+    out = put(out, boid.velocity().x());
+    out = put(out, boid.velocity().y());
+    out = put(out, static_cast<std::int32_t>(boid.id()));
+    out = put(out, static_cast<std::int32_t>(boid.is_pred()));
+  }
+  assert(out == frame.data() + frame.size());
+  os.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+}
+
+Async_writer::Async_writer(std::string const& filename, std::size_t capacity)
+    : filename_{filename}
+    , data_{filename + ".txt"}
+    , trajectory_{filename + ".trj", std::ios::binary}
+    , queue_{capacity}
+{
+  if (!data_ || !trajectory_) {
+    throw std::ios_base::failure{"ERROR: Cannot open files " + filename
+                                 + ".txt and " + filename + ".trj\n"};
+  }
+  trajectory_.write(trajectory_magic, trajectory_header_bytes);
+  thread_ = std::thread{&Async_writer::write, this};
+}
+
+Async_writer::~Async_writer()
+{
+  // errors can't be reported from here: close should have been called
+  if (!closed_) {
+    queue_.close();
+    thread_.join();
+  }
+}
+
+void Async_writer::write()
+{
+  try {
+    while (auto snapshot = queue_.pop()) {
+      print_data(data_, *snapshot);
+      write_frame(trajectory_, *snapshot);
+      if (!data_ || !trajectory_) {
+        throw std::ios_base::failure{"ERROR: Cannot write to files "
+                                     + filename_ + ".txt and " + filename_
+                                     + ".trj\n"};
+      }
+    }
+    data_.flush();
+    trajectory_.flush();
+  } catch (...) {
+    error_ = std::current_exception();
+    // unblocks the simulation, whose later snapshots are dropped
+    queue_.close();
+    while (queue_.pop()) {
+    }
+  }
+}
+
+void Async_writer::push(Snapshot const& snapshot)
+{
+  assert(!closed_);
+  // after an error the writer has closed the queue, which drops snapshot
+  queue_.push(snapshot);
+}
+
+void Async_writer::close()
+{
+  if (!closed_) {
+    closed_ = true;
+    queue_.close();
+    thread_.join();
+  }
+  if (error_) {
+    std::rethrow_exception(error_);
+  }
+}
@@ -0,0 +1,115 @@
+#ifndef OUTPUT_HPP
+#define OUTPUT_HPP
+#include "snapshots.hpp"
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+
+// defines the output pipeline writing snapshots to file while the simulation
+// goes on: a bounded queue and a writer thread emptying it
+
+// queue shared by producers and consumers: push blocks while the queue is full,
+// pop while it's empty and still open. Items pushed after closing are dropped
+template<class T>
+class Bounded_queue
+{
+  std::size_t capacity_;
+  std::queue<T> items_;
+  bool closed_{false};
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+
+ public:
+  explicit Bounded_queue(std::size_t capacity)
+      : capacity_{capacity}
+  {
+    assert(capacity_ > 0);
+  }
+
+  // returns false if item was dropped
+  bool push(T item)
+  {
+    std::unique_lock<std::mutex> lock{mutex_};
+    not_full_.wait(lock, [&] { return items_.size() < capacity_ || closed_; });
+    if (closed_) {
+      return false;
+    }
+    items_.push(std::move(item));
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // returns nothing once the queue is closed and empty
+  std::optional<T> pop()
+  {
+    std::unique_lock<std::mutex> lock{mutex_};
+    not_empty_.wait(lock, [&] { return !items_.empty() || closed_; });
+    if (items_.empty()) {
+      return std::nullopt;
+    }
+    T item{std::move(items_.front())};
+    items_.pop();
+    not_full_.notify_one();
+    return item;
+  }
+
+  void close()
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    closed_ = true;
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+};
+
+// trajectory file: the 8 characters of trajectory_magic, then the frames one
+// after the other, each made of the time (double), the number of boids
+// (int32) and a record per boid (doubles x, y, v_x, v_y, int32 id and is_pred)
+inline constexpr char trajectory_magic[]{"BOIDSTRJ"};
+std::size_t constexpr trajectory_header_bytes{8};
+std::size_t constexpr frame_header_bytes{sizeof(double) + 4};
+std::size_t constexpr boid_record_bytes{4 * sizeof(double) + 2 * 4};
+
+// appends the trajectory frame of snapshot to os
+void write_frame(std::ofstream& os, Snapshot const& snapshot);
+
+// writes the data line (see write_data) and the trajectory frame of every
+// snapshot pushed to files filename.txt and filename.trj, from a thread of its
+// own. Errors met by the writer are thrown by close
+class Async_writer
+{
+  std::string filename_;
+  std::ofstream data_;
+  std::ofstream trajectory_;
+  Bounded_queue<Snapshot> queue_;
+  std::exception_ptr error_{};
+  std::thread thread_;
+  bool closed_{false};
+
+  void write();
+
+ public:
+  static constexpr std::size_t default_capacity{16};
+
+  explicit Async_writer(std::string const& filename,
+                        std::size_t capacity = default_capacity);
+  ~Async_writer();
+  Async_writer(Async_writer const&)            = delete;
+  Async_writer& operator=(Async_writer const&) = delete;
+
+  // blocks while the writer is capacity snapshots behind
+  void push(Snapshot const& snapshot);
+  // waits for every snapshot pushed to be written
+  void close();
+};
+
+#endif
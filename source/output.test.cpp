@@ -0,0 +1,118 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "output.hpp"
+#include "doctest.h"
+#include "stats.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <sstream>
+
+TEST_CASE("testing Bounded_queue")
+{
+  Bounded_queue<int> queue{3};
+
+  SUBCASE("items come out in order, across threads")
+  {
+    int const n{1000};
+    std::thread producer{[&] {
+      for (int i{0}; i != n; ++i) {
+        queue.push(i);
+      }
+      queue.close();
+    }};
+    int expected{0};
+    int wrong{0};
+    while (auto item = queue.pop()) {
+      wrong += (*item != expected);
+      ++expected;
+    }
+    producer.join();
+    CHECK(wrong == 0);
+    CHECK(expected == n);
+  }
+
+  SUBCASE("closing")
+  {
+    CHECK(queue.push(1));
+    CHECK(queue.push(2));
+    queue.close();
+    // items pushed before closing are still popped, later ones are dropped
+    CHECK_FALSE(queue.push(3));
+    CHECK(queue.pop() == std::optional<int>{1});
+    CHECK(queue.pop() == std::optional<int>{2});
+    CHECK_FALSE(queue.pop().has_value());
+  }
+}
+
+TEST_CASE("testing Async_writer")
+{
+  std::vector<Snapshot> snapshots{};
+  for (int i{0}; i != 5; ++i) {
+    Snapshot snapshot{i * .5, .5, {}, {}};
+    snapshot.state.push_back(Boid{{1. + i, 2.}, {3., 4.}});
+    snapshot.state.push_back(Boid{{5., 6. - i}, {7., 8.}});
+    snapshot.state.push_back(Boid{{9., 10.}, {11., 12. * i}, true});
+    snapshot.state[1].id() = 1;
+    snapshot.state[2].id() = 2;
+    snapshots.push_back(snapshot);
+  }
+  {
+    // a queue shorter than the snapshots pushed makes push wait for the writer
+    Async_writer writer{"output_test", 2};
+    for (Snapshot const& snapshot : snapshots) {
+      writer.push(snapshot);
+    }
+    writer.close();
+  }
+
+  // data file, same as the one written by write_data
+  std::ifstream data{"output_test.txt"};
+  std::ostringstream expected{};
+  for (Snapshot const& snapshot : snapshots) {
+    print_data(expected, snapshot);
+  }
+  std::string const written{std::istreambuf_iterator<char>{data},
+                            std::istreambuf_iterator<char>{}};
+  CHECK(written == expected.str());
+
+  // trajectory file
+  std::ifstream trajectory{"output_test.trj", std::ios::binary};
+  std::vector<char> const bytes{std::istreambuf_iterator<char>{trajectory},
+                                std::istreambuf_iterator<char>{}};
+  REQUIRE(bytes.size()
+          == trajectory_header_bytes
+                 + 5 * (frame_header_bytes + 3 * boid_record_bytes));
+  CHECK(std::string(bytes.data(), trajectory_header_bytes)
+        == trajectory_magic);
+  char const* in{bytes.data() + trajectory_header_bytes};
+  for (Snapshot const& snapshot : snapshots) {
+    double time{};
+    std::int32_t n{};
+    std::memcpy(&time, in, sizeof(double));
+    std::memcpy(&n, in + sizeof(double), 4);
+    CHECK(time == snapshot.time);
+    CHECK(n == 3);
+    in += frame_header_bytes;
+    for (Boid const& boid : snapshot.state) {
+      double values[4]{};
+      std::int32_t ints[2]{};
+      std::memcpy(values, in, sizeof(values));
+      std::memcpy(ints, in + sizeof(values), sizeof(ints));
+      CHECK(values[0] == boid.position().x());
+      CHECK(values[1] == boid.position().y());
+      CHECK(values[2] == boid.velocity().x());
+      CHECK(values[3] == boid.velocity().y());
+      CHECK(ints[0] == boid.id());
+      CHECK(ints[1] == boid.is_pred());
+      in += boid_record_bytes;
+    }
+  }
+  data.close();
+  trajectory.close();
+  std::remove("output_test.txt");
+  std::remove("output_test.trj");
+
+  CHECK_THROWS_AS(Async_writer{"no_such_directory/output_test"},
+                  std::ios_base::failure);
+}
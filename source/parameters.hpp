@@ -54,6 +54,18 @@ class Parameters
   double d_s_pred_; // separation distance for predators
   double s_pred_;   // separation factor for predators
 
+  // optional features, changed through their setters:
+  bool adaptive_step_{false}; // time step chosen at each evolution
+  bool sleeping_{false};      // isolated boids advanced by straight motion
+  bool approximate_{false};   // alignment and cohesion from cells' sums
+  bool specialized_{false};   // prebuilt kernels used when pars match them
+  int reorder_interval_{0};   // evolutions between Morton sorts (0: never)
+  int threads_{1};            // threads applying the flying rules
+  bool work_stealing_{true};  // idle threads take others' boids' chunks
+  int cell_list_{0};          // cells per interaction distance of the grid
+                              // neighbours are searched in (0: whole flock)
+  bool tiled_{false};         // whole flock swept in cache-sized tiles
+
   // values set by developer:
   double x_min_{0.};
   double y_min_{0.};
@@ -154,6 +166,24 @@ class Parameters
   double& set_y_max(){return y_max_;}
   double get_d_s_pred() const{return d_s_pred_;}
   double get_s_pred() const{return s_pred_;}
+  bool get_adaptive_step() const{return adaptive_step_;}
+  bool& set_adaptive_step(){return adaptive_step_;}
+  bool get_sleeping() const{return sleeping_;}
+  bool& set_sleeping(){return sleeping_;}
+  bool get_approximate() const{return approximate_;}
+  bool& set_approximate(){return approximate_;}
+  bool get_specialized() const{return specialized_;}
+  bool& set_specialized(){return specialized_;}
+  int get_reorder_interval() const{return reorder_interval_;}
+  int& set_reorder_interval(){return reorder_interval_;}
+  int get_threads() const{return threads_;}
+  int& set_threads(){return threads_;}
+  bool get_work_stealing() const{return work_stealing_;}
+  bool& set_work_stealing(){return work_stealing_;}
+  int get_cell_list() const{return cell_list_;}
+  int& set_cell_list(){return cell_list_;}
+  bool get_tiled() const{return tiled_;}
+  bool& set_tiled(){return tiled_;}
   // clang-format on
 };
 
@@ -7,8 +7,9 @@
 inline auto get_parser(double& angle, double& d, double& d_s, double& s,
                        double& c, double& a, double& max_speed,
                        double& min_speed_fraction, int& delta_t, int& fps,
-                       int& N_boids, double const display_width,
-                       double const display_height, bool& show_help)
+                       int& tick_rate, int& N_boids, double const display_width,
+                       double const display_height, std::string& replay,
+                       bool& kernels, bool& show_help)
 {
   return lyra::cli{
       lyra::help(show_help)
@@ -48,9 +49,20 @@ inline auto get_parser(double& angle, double& d, double& d_s, double& s,
           "Set frames per second - must be greater than 0 and less than "
           "1000/delta_t  "
           "[Default value is 60]")
+      | lyra::opt(tick_rate, "evolutions-per-second")["-T"]["--tick_rate"](
+          "Set evolutions per second, frames in between being interpolated - "
+          "must be greater than 0 and not greater than fps  [Default is fps]")
       | lyra::opt(N_boids, "number-of-boids")["-b"]["--boids"](
           "Set number of boids  - must be greater than 1  [Default value is "
-          "80]")};
+          "80]")
+      | lyra::opt(replay, "filename")["-r"]["--replay"](
+          "Replays trajectory file [filename] (e.g. written by boids -o) "
+          "instead of simulating: space pauses, arrows seek and change "
+          "speed  [Default is simulating]")
+      | lyra::opt(kernels)["--kernels"](
+          "Uses the kernels specialized for the default parameters, faster "
+          "but equal to the generic rules only up to rounding  [Default is "
+          "OFF]")};
 }
 
 #endif
\ No newline at end of file
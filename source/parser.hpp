@@ -1,15 +1,30 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
+#include "flock.hpp"
 #include <lyra/lyra.hpp>
 #include <iomanip>
 #include <iostream>
+#include <string>
 
 inline auto get_parser(double& angle, double& d, double& d_s, double& s,
                        double& c, double& a, double& max_speed,
                        double& min_speed_fraction, double& duration, int& steps,
                        int& prescale, int& N_boids, bool& save_data,
-                       bool& show_help)
+                       bool& adaptive_step, bool& sleeping, bool& approximate,
+                       bool& kernels, int& reorder_interval, int& threads,
+                       bool& static_partition, int& cell_list, bool& tiled,
+                       bool& tune,
+                       int& memory,
+                       std::string& output, std::string& serve,
+                       double& rate, std::string& shm,
+                       std::string& obstacles, std::string& frames,
+                       std::string& render, int& frame_width,
+                       std::string& trajectory, int& seed, int& burn_in,
+                       std::string& warm_cache, int& converge,
+                       double& tolerance, std::string& rdf_file,
+                       double& rdf_cutoff, int& rdf_bins, int& verify_steps,
+                       double& verify_tolerance, bool& show_help)
 {
   return lyra::cli{
       lyra::help(show_help)
@@ -52,7 +67,127 @@ inline auto get_parser(double& angle, double& d, double& d_s, double& s,
           "120]")
       | lyra::opt(save_data)["--ON"]("Saves data obtained from statistical "
                                      "analysis to specified file  [Default is "
-                                     "OFF]")};
+                                     "OFF]")
+      | lyra::opt(adaptive_step)["--adaptive"](
+          "Chooses the time step of each evolution from the flock's state, "
+          "evolving until duration is reached  [Default is OFF]")
+      | lyra::opt(sleeping)["--sleep"](
+          "Advances isolated boids by straight motion, skipping flying rules  "
+          "[Default is OFF]")
+      | lyra::opt(approximate)["--approx"](
+          "Computes alignment and cohesion from sums over the grid's cells "
+          "entirely in sight, faster for dense flocks  [Default is OFF]")
+      | lyra::opt(kernels)["--kernels"](
+          "Uses the kernels specialized for the default parameters, faster "
+          "but equal to the generic rules only up to rounding  [Default is "
+          "OFF]")
+      | lyra::opt(reorder_interval, "reorder-interval")["--reorder"](
+          "Sorts boids in memory along a Morton curve every "
+          "[reorder-interval] steps - must be greater than or equal to 0 (0 "
+          "never sorts)  "
+          "[Default value is 0]")
+      | lyra::opt(threads, "threads")["-j"]["--threads"](
+          "Set number of threads applying the flying rules - must be greater "
+          "than 0  [Default value is 1]")
+      | lyra::opt(static_partition)["--static"](
+          "Splits boids evenly among threads once and for all, instead of "
+          "letting idle threads take over the others' boids  [Default is "
+          "OFF]")
+      | lyra::opt(cell_list, "cells")["--cells"](
+          "Searches regular boids' neighbours among the boids in the cells "
+          "near them only, [cells] cells per interaction distance, instead of "
+          "in the whole flock - must be greater than or equal to 0 (0 "
+          "searches the whole flock)  [Default value is 0]")
+      | lyra::opt(tiled)["--tiled"](
+          "Sweeps the whole flock for every boid's neighbours in blocks of "
+          "boids against tiles of boids that fit in the cache, applying all "
+          "flying rules in a single pass  [Default is OFF]")
+      | lyra::opt(tune)["--autotune"](
+          "Times a few evolutions with each neighbours' search (whole flock, "
+          "tiled or not, or cells, see --tiled and --cells) and number of "
+          "threads, then simulates with the fastest, caching the choice for "
+          "later runs on this machine with the same parameters and number of "
+          "boids, which skip the trials (overrides --tiled, --cells and "
+          "--threads)  [Default is OFF]")
+      | lyra::opt(memory, "memory{MiB}")["--memory"](
+          "Set memory budget of the stored states, older ones being moved to "
+          "a temporary file beyond it - must be greater than 0  [Default "
+          "value is 256]")
+      | lyra::opt(output, "filename")["-o"]["--output"](
+          "Writes data and trajectories to files [filename].txt and "
+          "[filename].trj while simulating, without prompting  [Default is "
+          "no output]")
+      | lyra::opt(serve, "address")["--serve"](
+          "Streams frames to clients connecting to address unix:[path] or "
+          "tcp:[port] (loopback interface), e.g. with boids-client  [Default "
+          "is no streaming]")
+      | lyra::opt(rate, "frames-per-second")["--rate"](
+          "Set maximum rate of the frames streamed - must be greater than 0.  "
+          "[Default value is 30.]")
+      | lyra::opt(shm, "name")["--shm"](
+          "Publishes every stored state in POSIX shared memory [name] (e.g. "
+          "/boids), a ring of frames readers on the same host can map  "
+          "[Default is no shared memory]")
+      | lyra::opt(obstacles, "filename")["--obstacles"](
+          "Reads obstacles boids avoid from [filename], a line for each: "
+          "'pillar x y radius' or 'wall x1 y1 x2 y2 [thickness]'  [Default "
+          "is no obstacles]")
+      | lyra::opt(frames, "prefix")["--frames"](
+          "Renders every stored state, without a display, to image "
+          "[prefix]_[number].ppm  [Default is no frames]")
+      | lyra::opt(render, "mode")["--render"](
+          "Set what frames show: boids, density (a heatmap of the boids per "
+          "pixel) or heading (the boids' mean direction as a hue)  [Default "
+          "is boids]")
+      | lyra::opt(frame_width, "pixels")["--frame_width"](
+          "Set width of the frames, their height following from the space's "
+          "- must be greater than 0  [Default value is 800]")
+      | lyra::opt(trajectory, "filename")["--render_trajectory"](
+          "Renders the frames of trajectory file [filename] (see --output) "
+          "instead of simulating, --frames being required  [Default is "
+          "simulating]")
+      | lyra::opt(seed, "seed")["--seed"](
+          "Set seed of the flock's random initial state - must be greater "
+          "than or equal to 0  [Default is a random seed]")
+      | lyra::opt(burn_in, "burn-in-steps")["--burn_in"](
+          "Evolves the flock [burn-in-steps] times before simulating, caching "
+          "the state reached for later runs with the same parameters, "
+          "number of boids and seed, which start from it (only if --seed is "
+          "given) - must be greater than or equal to 0  [Default value is 0]")
+      | lyra::opt(warm_cache, "directory")["--warm_cache"](
+          "Set directory of the states cached after burn-in and of the "
+          "tunings cached by --autotune  [Default is .boids_cache]")
+      | lyra::opt(converge, "window")["--converge"](
+          "Stops the simulation once the observables' means and standard "
+          "deviations (speed, polarization, nearest-neighbour and predator "
+          "to prey distances, if sampled) stayed within tolerance for the "
+          "last [window] stored states - must be 0 (never stops early) or "
+          "greater than 1  [Default value is 0]")
+      | lyra::opt(tolerance, "tolerance")["--tolerance"](
+          "Set tolerance of convergence, relative to the mean of each "
+          "quantity over the window - must be greater than 0.  [Default value "
+          "is 0.05]")
+      | lyra::opt(rdf_file, "filename")["--rdf"](
+          "Writes the radial distribution function g(r) of the regular boids "
+          "of every stored state to [filename]  [Default is no g(r)]")
+      | lyra::opt(rdf_cutoff, "cutoff")["--rdf_cutoff"](
+          "Set largest distance of g(r), as a multiple of neighbour-distance "
+          "- must be greater than 0.  [Default value is 3.]")
+      | lyra::opt(rdf_bins, "bins")["--rdf_bins"](
+          "Set number of bins of g(r) - must be greater than 0  [Default "
+          "value is 30]")
+      | lyra::opt(verify_steps, "steps")["--verify"](
+          "Instead of simulating, evolves the flock [steps] times side by "
+          "side with the reference implementation (brute-force rules, serial "
+          "updates), reporting the largest deviations in each step (the "
+          "reference taking it from the flock's state) and accumulated since "
+          "the start, and the first boid deviating beyond tolerance in a "
+          "step - must be greater than or "
+          "equal to 0 (0 doesn't verify)  [Default value is 0]")
+      | lyra::opt(verify_tolerance, "tolerance")["--verify_tolerance"](
+          "Set largest deviation of position or velocity not considered a "
+          "divergence - must be greater than or equal to 0.  [Default value "
+          "is 1e-9]")};
 }
 
 // prints summary of values of parameters used in the simulation
@@ -78,7 +213,30 @@ inline void print_parameters(Parameters const& pars)
             << '\n'
             << std::setw(15) << "presc p:  " << std::setw(7)
             << pars.get_prescale() << std::setw(20)
-            << "N_boids N: " << std::setw(10) << pars.get_N_boids() << "\n\n";
+            << "N_boids N: " << std::setw(10) << pars.get_N_boids() << '\n'
+            << std::setw(15) << "time step:  " << std::setw(7)
+            << (pars.get_adaptive_step() ? "adapt." : "fixed") << std::setw(20)
+            << "sleeping: " << std::setw(10)
+            << (pars.get_sleeping() ? "ON" : "OFF") << '\n'
+            << std::setw(15) << "approx.:  " << std::setw(7)
+            << (pars.get_approximate() ? "ON" : "OFF") << std::setw(20)
+            << "reorder: " << std::setw(10) << pars.get_reorder_interval()
+            << '\n'
+            << std::setw(15) << "threads:  " << std::setw(7)
+            << pars.get_threads() << std::setw(20)
+            << "partition: " << std::setw(10)
+            << (pars.get_work_stealing() ? "stealing" : "static") << "\n\n";
+}
+
+// prints summary of how the simulation performed
+inline void print_profile(Flock const& flock, Snapshot_store const& states)
+{
+  std::cout << "    PROFILE:\n\n"
+            << std::setprecision(3) << std::fixed << std::setw(30)
+            << "fraction of active boids:  " << std::setw(7)
+            << flock.active_fraction() << '\n'
+            << std::setw(30) << "states moved to disk:  " << std::setw(7)
+            << states.spilled() << " of " << states.size() << "\n\n";
 }
 
 #endif
\ No newline at end of file
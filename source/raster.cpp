@@ -0,0 +1,343 @@
+#include "raster.hpp"
+#include "parameters.hpp"
+#include "scheduler.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+// defines the rasterizer's drawing of triangles and heatmaps, tile by tile,
+// and the writing of images
+
+Render_mode to_render_mode(std::string const& name)
+{
+  if (name == "boids") {
+    return Render_mode::boids;
+  }
+  if (name == "density") {
+    return Render_mode::density;
+  }
+  if (name == "heading") {
+    return Render_mode::heading;
+  }
+  throw Invalid_Parameter{"Render mode " + name
+                          + " is not one of boids, density, heading"};
+}
+
+Rasterizer::Rasterizer(double x_min, double x_max, double y_min, double y_max,
+                       int width, int height, int threads, double radius)
+    : x_min_{x_min}
+    , y_min_{y_min}
+    , scale_x_{width / (x_max - x_min)}
+    , scale_y_{height / (y_max - y_min)}
+    , width_{width}
+    , height_{height}
+    , threads_{threads}
+    , radius_{radius}
+{
+  assert(x_max > x_min && y_max > y_min);
+  assert(width_ > 0 && height_ > 0 && threads_ > 0 && radius_ > 0.);
+}
+
+struct Rgb
+{
+  float r;
+  float g;
+  float b;
+};
+
+Rgb mix(Rgb const& c0, Rgb const& c1, float t)
+{
+  return {c0.r + (c1.r - c0.r) * t, c0.g + (c1.g - c0.g) * t,
+          c0.b + (c1.b - c0.b) * t};
+}
+
+Rgb constexpr white{255.f, 255.f, 255.f};
+
+void put_pixel(Image& image, int x, int y, Rgb const& color)
+{
+  auto const i{3 * (static_cast<std::size_t>(y) * image.width + x)};
+  image.pixels[i]     = static_cast<std::uint8_t>(color.r + .5f);
+  image.pixels[i + 1] = static_cast<std::uint8_t>(color.g + .5f);
+  image.pixels[i + 2] = static_cast<std::uint8_t>(color.b + .5f);
+}
+
+// pixels [x_begin, x_end) x [y_begin, y_end) of a tile
+struct Tile
+{
+  int x_begin;
+  int x_end;
+  int y_begin;
+  int y_end;
+};
+
+// the boids' triangles, with a color for each vertex (blended in between), in
+// pixels
+struct Triangle
+{
+  std::array<float, 3> x;
+  std::array<float, 3> y;
+  std::array<Rgb, 3> color;
+};
+
+// same shape and colors as those of draw_state
+Triangle triangle(Boid const& boid, double p_x, double p_y)
+{
+  double const scale_fac{(boid.is_pred()) ? 1.5 : 1.};
+  double const half_base{3.5 * scale_fac};
+  double const half_height{5.5 * scale_fac};
+  double const speed{norm(boid.velocity())};
+  // unit vector along the velocity, and its normal
+  double const u_x{(speed > 0.) ? boid.velocity().x() / speed : 0.};
+  double const u_y{(speed > 0.) ? boid.velocity().y() / speed : 1.};
+  Rgb const tip{(boid.is_pred()) ? Rgb{255.f, 0.f, 0.f} : Rgb{0.f, 0.f, 0.f}};
+  Rgb const base{(boid.is_pred()) ? Rgb{255.f, 155.f, 0.f}
+                                  : Rgb{169.f, 169.f, 169.f}};
+  double const b_x{p_x - half_height * u_x};
+  double const b_y{p_y - half_height * u_y};
+  return {{static_cast<float>(p_x + half_height * u_x),
+           static_cast<float>(b_x + half_base * u_y),
+           static_cast<float>(b_x - half_base * u_y)},
+          {static_cast<float>(p_y + half_height * u_y),
+           static_cast<float>(b_y - half_base * u_x),
+           static_cast<float>(b_y + half_base * u_x)},
+          {tip, base, base}};
+}
+
+// fills the pixels of tile whose centers lie in triangle t
+void fill(Image& image, Tile const& tile, Triangle const& t)
+{
+  auto const [x_lo, x_hi] = std::minmax({t.x[0], t.x[1], t.x[2]});
+  auto const [y_lo, y_hi] = std::minmax({t.y[0], t.y[1], t.y[2]});
+  int const x_begin{std::max(tile.x_begin, static_cast<int>(x_lo))};
+  int const x_end{std::min(tile.x_end, static_cast<int>(x_hi) + 1)};
+  int const y_begin{std::max(tile.y_begin, static_cast<int>(y_lo))};
+  int const y_end{std::min(tile.y_end, static_cast<int>(y_hi) + 1)};
+  float const area{(t.x[1] - t.x[0]) * (t.y[2] - t.y[0])
+                   - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0])};
+  if (area == 0.f) {
+    return;
+  }
+  for (int y{y_begin}; y < y_end; ++y) {
+    float const c_y{y + .5f};
+    for (int x{x_begin}; x < x_end; ++x) {
+      float const c_x{x + .5f};
+      // barycentric coordinates of the pixel's center
+      float const w_0{((t.x[2] - t.x[1]) * (c_y - t.y[1])
+                       - (c_x - t.x[1]) * (t.y[2] - t.y[1]))
+                      / area};
+      float const w_1{((t.x[0] - t.x[2]) * (c_y - t.y[2])
+                       - (c_x - t.x[2]) * (t.y[0] - t.y[2]))
+                      / area};
+      float const w_2{1.f - w_0 - w_1};
+      if (w_0 >= 0.f && w_1 >= 0.f && w_2 >= 0.f) {
+        put_pixel(image, x, y,
+                  {w_0 * t.color[0].r + w_1 * t.color[1].r
+                       + w_2 * t.color[2].r,
+                   w_0 * t.color[0].g + w_1 * t.color[1].g
+                       + w_2 * t.color[2].g,
+                   w_0 * t.color[0].b + w_1 * t.color[1].b
+                       + w_2 * t.color[2].b});
+      }
+    }
+  }
+}
+
+// from white (no boids) through yellow and red to dark red (the densest pixel)
+Rgb density_color(float t)
+{
+  std::array<Rgb, 5> constexpr ramp{Rgb{255.f, 255.f, 255.f},
+                                    Rgb{255.f, 237.f, 160.f},
+                                    Rgb{254.f, 178.f, 76.f},
+                                    Rgb{240.f, 59.f, 32.f},
+                                    Rgb{128.f, 0.f, 38.f}};
+  float const x{std::clamp(t, 0.f, 1.f) * (ramp.size() - 1)};
+  auto const i{std::min(static_cast<std::size_t>(x), ramp.size() - 2)};
+  return mix(ramp[i], ramp[i + 1], x - i);
+}
+
+// fully saturated color whose hue is angle (in radians)
+Rgb hue_color(float angle)
+{
+  float const h{(angle / static_cast<float>(pi) + 1.f) * 3.f}; // in [0, 6]
+  auto channel = [&](float n) {
+    float const k{std::fmod(n + h, 6.f)};
+    return 255.f * (1.f - std::clamp(std::min(k, 4.f - k), 0.f, 1.f));
+  };
+  return {channel(5.f), channel(3.f), channel(1.f)};
+}
+
+Image& Rasterizer::render(std::vector<Boid> const& state, Render_mode mode,
+                          Image& image) const
+{
+  image.width  = width_;
+  image.height = height_;
+  image.pixels.resize(3 * static_cast<std::size_t>(width_) * height_);
+  int const tiles_x{(width_ + tile_size - 1) / tile_size};
+  int const tiles_y{(height_ + tile_size - 1) / tile_size};
+  auto tile = [&](int i) {
+    int const x{i % tiles_x * tile_size};
+    int const y{i / tiles_x * tile_size};
+    return Tile{x, std::min(x + tile_size, width_), y,
+                std::min(y + tile_size, height_)};
+  };
+
+  // what each boid draws is binned to the tiles its bounding box overlaps, in
+  // the boids' order: drawing doesn't depend on the number of threads. A
+  // predator's triangle reaches as far as the corners of its base, and a pixel
+  // more covers rounding
+  double const reach{(mode == Render_mode::boids)
+                         ? 1.5 * std::hypot(5.5, 3.5) + 1.
+                         : radius_};
+  std::vector<std::vector<int>> bins(tiles_x * tiles_y);
+  std::vector<Position> pixel_positions{};
+  pixel_positions.reserve(state.size());
+  for (int i{0}; i != static_cast<int>(state.size()); ++i) {
+    Position const& p{state[i].position()};
+    pixel_positions.push_back(
+        Position{(p.x() - x_min_) * scale_x_, (p.y() - y_min_) * scale_y_});
+    Position const& q{pixel_positions.back()};
+    int const first_x{std::max(static_cast<int>(std::floor(q.x() - reach)), 0)};
+    int const last_x{std::min(static_cast<int>(std::floor(q.x() + reach)),
+                              width_ - 1)};
+    int const first_y{std::max(static_cast<int>(std::floor(q.y() - reach)), 0)};
+    int const last_y{std::min(static_cast<int>(std::floor(q.y() + reach)),
+                              height_ - 1)};
+    for (int t_y{first_y / tile_size}; t_y <= last_y / tile_size; ++t_y) {
+      for (int t_x{first_x / tile_size}; t_x <= last_x / tile_size; ++t_x) {
+        bins[t_y * tiles_x + t_x].push_back(i);
+      }
+    }
+  }
+
+  if (mode == Render_mode::boids) {
+    parallel_for(tiles_x * tiles_y, 1, threads_, Partition::work_stealing,
+                 [&](int begin, int end) {
+                   for (int i{begin}; i != end; ++i) {
+                     Tile const t{tile(i)};
+                     for (int y{t.y_begin}; y != t.y_end; ++y) {
+                       for (int x{t.x_begin}; x != t.x_end; ++x) {
+                         put_pixel(image, x, y, white);
+                       }
+                     }
+                     for (int j : bins[i]) {
+                       fill(image, t,
+                            triangle(state[j], pixel_positions[j].x(),
+                                     pixel_positions[j].y()));
+                     }
+                   }
+                 });
+    return image;
+  }
+
+  // heatmaps: each boid is spread over radius pixels by a kernel of weight
+  // 1 - (distance / radius)^2, summed per pixel along with the weighted
+  // directions of the boids
+  std::size_t const n_pixels{static_cast<std::size_t>(width_) * height_};
+  std::vector<float> weight(n_pixels);
+  std::vector<float> dir_x((mode == Render_mode::heading) ? n_pixels : 0);
+  std::vector<float> dir_y(dir_x.size());
+  std::vector<float> tile_max(tiles_x * tiles_y);
+  double const r2{radius_ * radius_};
+  parallel_for(
+      tiles_x * tiles_y, 1, threads_, Partition::work_stealing,
+      [&](int begin, int end) {
+        for (int i{begin}; i != end; ++i) {
+          Tile const t{tile(i)};
+          for (int j : bins[i]) {
+            Position const& q{pixel_positions[j]};
+            double const speed{norm(state[j].velocity())};
+            int const x_begin{std::max(
+                t.x_begin, static_cast<int>(std::floor(q.x() - radius_)))};
+            int const x_end{std::min(
+                t.x_end, static_cast<int>(std::floor(q.x() + radius_)) + 1)};
+            int const y_begin{std::max(
+                t.y_begin, static_cast<int>(std::floor(q.y() - radius_)))};
+            int const y_end{std::min(
+                t.y_end, static_cast<int>(std::floor(q.y() + radius_)) + 1)};
+            for (int y{y_begin}; y < y_end; ++y) {
+              double const d_y{y + .5 - q.y()};
+              for (int x{x_begin}; x < x_end; ++x) {
+                double const d_x{x + .5 - q.x()};
+                double const d2{d_x * d_x + d_y * d_y};
+                if (d2 >= r2) {
+                  continue;
+                }
+                auto const k{static_cast<std::size_t>(y) * width_ + x};
+                auto const w{static_cast<float>(1. - d2 / r2)};
+                weight[k] += w;
+                if (mode == Render_mode::heading && speed > 0.) {
+                  dir_x[k] += w * static_cast<float>(state[j].velocity().x()
+                                                     / speed);
+                  dir_y[k] += w * static_cast<float>(state[j].velocity().y()
+                                                     / speed);
+                }
+              }
+            }
+          }
+          for (int y{t.y_begin}; y != t.y_end; ++y) {
+            for (int x{t.x_begin}; x != t.x_end; ++x) {
+              tile_max[i] =
+                  std::max(tile_max[i],
+                           weight[static_cast<std::size_t>(y) * width_ + x]);
+            }
+          }
+        }
+      });
+
+  // densities are scaled to the densest pixel, directions are shown where
+  // there are boids, the more saturated the more aligned they are
+  float const max_weight{*std::max_element(tile_max.begin(), tile_max.end())};
+  parallel_for(
+      tiles_x * tiles_y, 1, threads_, Partition::work_stealing,
+      [&](int begin, int end) {
+        for (int i{begin}; i != end; ++i) {
+          Tile const t{tile(i)};
+          for (int y{t.y_begin}; y != t.y_end; ++y) {
+            for (int x{t.x_begin}; x != t.x_end; ++x) {
+              auto const k{static_cast<std::size_t>(y) * width_ + x};
+              if (weight[k] == 0.f) {
+                put_pixel(image, x, y, white);
+              } else if (mode == Render_mode::density) {
+                put_pixel(image, x, y, density_color(weight[k] / max_weight));
+              } else {
+                float const alignment{
+                    std::hypot(dir_x[k], dir_y[k]) / weight[k]};
+                put_pixel(image, x, y,
+                          mix(white, hue_color(std::atan2(dir_y[k], dir_x[k])),
+                              std::min(alignment * std::min(weight[k], 1.f),
+                                       1.f)));
+              }
+            }
+          }
+        }
+      });
+  return image;
+}
+
+void write_ppm(Image const& image, std::string const& filename)
+{
+  assert(image.pixels.size()
+         == 3 * static_cast<std::size_t>(image.width) * image.height);
+  std::ofstream file{filename, std::ios::binary};
+  if (!file) {
+    throw std::runtime_error{"ERROR: Cannot open file " + filename};
+  }
+  file << "P6\n" << image.width << ' ' << image.height << "\n255\n";
+  file.write(reinterpret_cast<char const*>(image.pixels.data()),
+             static_cast<std::streamsize>(image.pixels.size()));
+  if (!file) {
+    throw std::runtime_error{"ERROR: Cannot write file " + filename};
+  }
+}
+
+std::string frame_name(std::string const& prefix, int frame)
+{
+  std::ostringstream name;
+  name << prefix << '_' << std::setw(6) << std::setfill('0') << frame
+       << ".ppm";
+  return name.str();
+}
@@ -0,0 +1,70 @@
+#ifndef RASTER_HPP
+#define RASTER_HPP
+#include "boids.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// defines a software rasterizer drawing states into images held in memory, so
+// that frames can be exported without a display: the image is split in tiles,
+// drawn in parallel, each one by a single thread
+
+// pixels stored row by row, from the top one, as red, green and blue bytes
+struct Image
+{
+  int width{0};
+  int height{0};
+  std::vector<std::uint8_t> pixels{};
+};
+
+enum class Render_mode
+{
+  boids,   // a triangle for each boid, as draw_state draws it
+  density, // boids per pixel, smoothed over radius pixels
+  heading  // mean direction of the boids within radius pixels, as a hue
+};
+
+// parses "boids", "density" or "heading"; throws Invalid_Parameter
+Render_mode to_render_mode(std::string const& name);
+
+// maps region [x_min, x_max] x [y_min, y_max] onto images of width x height
+// pixels, y growing downwards as in the window of boids-sfml. Triangles are as
+// many pixels big as they are in that window
+class Rasterizer
+{
+  double x_min_;
+  double y_min_;
+  double scale_x_; // pixels per unit of length
+  double scale_y_;
+  int width_;
+  int height_;
+  int threads_;
+  double radius_; // of the heatmaps' smoothing kernel, in pixels
+
+ public:
+  static constexpr int tile_size{64};
+
+  explicit Rasterizer(double x_min, double x_max, double y_min, double y_max,
+                      int width, int height, int threads = 1,
+                      double radius = 8.);
+
+  int width() const
+  {
+    return width_;
+  }
+  int height() const
+  {
+    return height_;
+  }
+  // draws state into image, resized if needed
+  Image& render(std::vector<Boid> const& state, Render_mode mode,
+                Image& image) const;
+};
+
+// writes image as a binary PPM (P6) file; throws std::runtime_error
+void write_ppm(Image const& image, std::string const& filename);
+
+// name of frame number frame: [prefix]_[frame, 6 digits].ppm
+std::string frame_name(std::string const& prefix, int frame);
+
+#endif
@@ -0,0 +1,146 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "raster.hpp"
+#include "doctest.h"
+#include "parameters.hpp"
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+// color of pixel (x, y)
+std::array<int, 3> pixel(Image const& image, int x, int y)
+{
+  auto const i{3 * (static_cast<std::size_t>(y) * image.width + x)};
+  return {image.pixels[i], image.pixels[i + 1], image.pixels[i + 2]};
+}
+
+std::array<int, 3> constexpr white{255, 255, 255};
+
+TEST_CASE("testing to_render_mode")
+{
+  CHECK(to_render_mode("boids") == Render_mode::boids);
+  CHECK(to_render_mode("density") == Render_mode::density);
+  CHECK(to_render_mode("heading") == Render_mode::heading);
+  CHECK_THROWS_AS(to_render_mode("speed"), Invalid_Parameter);
+}
+
+TEST_CASE("testing Rasterizer")
+{
+  // 2 pixels per unit of length
+  Rasterizer const rasterizer{0., 100., 0., 50., 200, 100};
+  Image image{};
+
+  SUBCASE("boids")
+  {
+    // a boid flying along x, in the middle of the image, and a predator
+    std::vector<Boid> state{Boid{{50., 25.}, {10., 0.}},
+                            Boid{{10., 10.}, {0., -5.}, true}};
+    rasterizer.render(state, Render_mode::boids, image);
+    REQUIRE(image.width == 200);
+    REQUIRE(image.height == 100);
+    REQUIRE(image.pixels.size() == 200u * 100u * 3u);
+    // the tip is darker than the base, the triangle is longer than wide
+    auto const tip{pixel(image, 102, 50)};
+    auto const base{pixel(image, 96, 50)};
+    CHECK(tip[0] < base[0]);
+    CHECK(base != white);
+    CHECK(pixel(image, 100, 56) == white);
+    CHECK(pixel(image, 100, 48) != white);
+    // the predator is red and orange, pointing at negative y
+    auto const pred_tip{pixel(image, 20, 15)};
+    CHECK(pred_tip[0] > pred_tip[1]);
+    CHECK(pred_tip[0] > 200);
+    CHECK(pixel(image, 20, 28) == white);
+    CHECK(pixel(image, 150, 80) == white);
+  }
+
+  SUBCASE("heatmaps")
+  {
+    std::vector<Boid> state{Boid{{50., 25.}, {10., 0.}},
+                            Boid{{50.5, 25.}, {10., 0.}},
+                            Boid{{20., 10.}, {10., 0.}}};
+    rasterizer.render(state, Render_mode::density, image);
+    // the densest pixel is the darkest, nothing is drawn beyond radius
+    auto const peak{pixel(image, 101, 50)};
+    auto const single{pixel(image, 40, 20)};
+    CHECK(peak[1] < single[1]);
+    CHECK(peak[0] < 200);
+    CHECK(pixel(image, 101, 60) == white);
+    CHECK(pixel(image, 101, 56) != white);
+
+    // opposite directions cancel out, aligned ones are saturated
+    state.push_back(Boid{{80., 40.}, {-10., 0.}});
+    state.push_back(Boid{{80., 40.}, {10., 0.}});
+    rasterizer.render(state, Render_mode::heading, image);
+    auto const aligned{pixel(image, 101, 50)};
+    CHECK(aligned[0] == 0);
+    CHECK(aligned[1] == 255);
+    CHECK(aligned[2] == 255);
+    CHECK(pixel(image, 160, 80) == white);
+
+    rasterizer.render({}, Render_mode::density, image);
+    CHECK(pixel(image, 101, 50) == white);
+  }
+
+  SUBCASE("boids across tiles")
+  {
+    // 1 pixel per unit of length: the corners of a predator's base reach
+    // 1.5 * hypot(5.5, 3.5) pixels from its position, the same predator drawn
+    // past the edge of its tile (at pixel 64) and inside a tile must match
+    Rasterizer const square{0., 200., 0., 200., 200, 200};
+    Image interior{};
+    Velocity const v{10., 10.};
+    square.render({Boid{{72.25, 72.5}, v, true}}, Render_mode::boids, image);
+    square.render({Boid{{104.25, 104.5}, v, true}}, Render_mode::boids,
+                  interior);
+    int drawn{0};
+    for (int y{50}; y != 90; ++y) {
+      for (int x{50}; x != 90; ++x) {
+        CHECK(pixel(image, x, y) == pixel(interior, x + 32, y + 32));
+        // counting pixels of the tiles left of and above the predator's
+        drawn += (x < 64 || y < 64) && pixel(image, x, y) != white;
+      }
+    }
+    CHECK(drawn > 0);
+  }
+
+  SUBCASE("tiles drawn by more threads")
+  {
+    std::default_random_engine eng{3};
+    std::uniform_real_distribution<double> x{-5., 105.};
+    std::uniform_real_distribution<double> v{-10., 10.};
+    std::vector<Boid> state{};
+    for (int i{0}; i != 2000; ++i) {
+      Position const p{x(eng), x(eng) / 2.};
+      Velocity const u{v(eng), v(eng)};
+      state.push_back((i < 10) ? Boid{p, u, true} : Boid{p, u});
+    }
+    Rasterizer const parallel{0., 100., 0., 50., 200, 100, 3};
+    Image other{};
+    for (auto mode :
+         {Render_mode::boids, Render_mode::density, Render_mode::heading}) {
+      rasterizer.render(state, mode, image);
+      parallel.render(state, mode, other);
+      CHECK(image.pixels == other.pixels);
+    }
+  }
+}
+
+TEST_CASE("testing write_ppm")
+{
+  CHECK(frame_name("frames/run", 42) == "frames/run_000042.ppm");
+
+  Rasterizer const rasterizer{0., 10., 0., 10., 3, 2};
+  Image image{};
+  rasterizer.render({}, Render_mode::boids, image);
+  std::string const filename{frame_name("raster_test", 0)};
+  write_ppm(image, filename);
+  std::ifstream file{filename, std::ios::binary};
+  std::string const bytes{std::istreambuf_iterator<char>{file},
+                          std::istreambuf_iterator<char>{}};
+  file.close();
+  CHECK(bytes == "P6\n3 2\n255\n" + std::string(18, '\xff'));
+  std::remove(filename.c_str());
+
+  CHECK_THROWS(write_ppm(image, "no_such_directory/frame.ppm"));
+}
@@ -0,0 +1,188 @@
+#include "scheduler.hpp"
+#include <algorithm>
+#include <cassert>
+#include <exception>
+
+// defines the chunks' ranges, the worker pool and parallel_for
+
+std::uint64_t pack(int front, int back)
+{
+  return static_cast<std::uint32_t>(front)
+       | (static_cast<std::uint64_t>(static_cast<std::uint32_t>(back)) << 32);
+}
+
+int front(std::uint64_t range)
+{
+  return static_cast<int>(range & 0xffffffffu);
+}
+
+int back(std::uint64_t range)
+{
+  return static_cast<int>(range >> 32);
+}
+
+void Chunk_range::assign(int front, int back)
+{
+  assert(front >= 0 && back >= front);
+  range_.store(pack(front, back));
+}
+
+bool Chunk_range::pop_front(int& chunk)
+{
+  std::uint64_t range{range_.load()};
+  // a failed compare-exchange reloads range, which a thief may have shrunk
+  while (front(range) < back(range)) {
+    if (range_.compare_exchange_weak(range,
+                                     pack(front(range) + 1, back(range)))) {
+      chunk = front(range);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Chunk_range::steal_back(int& chunk)
+{
+  std::uint64_t range{range_.load()};
+  while (front(range) < back(range)) {
+    if (range_.compare_exchange_weak(range,
+                                     pack(front(range), back(range) - 1))) {
+      chunk = back(range) - 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+Worker_pool::~Worker_pool()
+{
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void Worker_pool::work()
+{
+  std::unique_lock<std::mutex> lock{mutex_};
+  while (true) {
+    wake_.wait(lock, [this] { return stop_ || next_ < n_tasks_; });
+    if (stop_) {
+      return;
+    }
+    int const t{next_++};
+    lock.unlock();
+    // an exception leaving a worker would terminate the program: it's handed
+    // to the caller of the job instead
+    std::exception_ptr error{};
+    try {
+      (*task_)(t);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    lock.lock();
+    if (error && !error_) {
+      error_ = error;
+    }
+    if (--pending_ == 0) {
+      done_.notify_one();
+    }
+  }
+}
+
+bool Worker_pool::run(int n_tasks, std::function<void(int)> const& task)
+{
+  assert(n_tasks > 0);
+  std::unique_lock<std::mutex> busy{busy_, std::try_to_lock};
+  if (!busy) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    while (static_cast<int>(workers_.size()) < n_tasks - 1) {
+      workers_.emplace_back(&Worker_pool::work, this);
+    }
+    task_    = &task;
+    n_tasks_ = n_tasks;
+    next_    = 1;
+    pending_ = n_tasks - 1;
+  }
+  wake_.notify_all();
+  // the workers' tasks refer to the caller's state: they must be done before
+  // an exception leaves it
+  std::exception_ptr error{};
+  try {
+    task(0);
+  } catch (...) {
+    error = std::current_exception();
+  }
+  {
+    std::unique_lock<std::mutex> lock{mutex_};
+    done_.wait(lock, [this] { return pending_ == 0; });
+    task_    = nullptr;
+    n_tasks_ = 0;
+    if (!error) {
+      error = error_;
+    }
+    error_ = nullptr;
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return true;
+}
+
+Worker_pool& worker_pool()
+{
+  static Worker_pool pool{};
+  return pool;
+}
+
+void parallel_for(int n, int chunk_size, int n_threads, Partition partition,
+                  std::function<void(int, int)> const& body)
+{
+  assert(n >= 0);
+  assert(chunk_size > 0);
+  int const n_chunks{(n + chunk_size - 1) / chunk_size};
+  auto const run = [&](int chunk) {
+    body(chunk * chunk_size, std::min(n, (chunk + 1) * chunk_size));
+  };
+  n_threads = std::clamp(n_threads, 1, std::max(n_chunks, 1));
+  if (n_threads == 1) {
+    for (int chunk{0}; chunk != n_chunks; ++chunk) {
+      run(chunk);
+    }
+    return;
+  }
+
+  // every thread starts with a contiguous share of the chunks
+  std::vector<Chunk_range> ranges(n_threads);
+  for (int t{0}; t != n_threads; ++t) {
+    ranges[t].assign(n_chunks * t / n_threads, n_chunks * (t + 1) / n_threads);
+  }
+  auto const work = [&](int t) {
+    int chunk{};
+    while (ranges[t].pop_front(chunk)) {
+      run(chunk);
+    }
+    if (partition == Partition::work_stealing) {
+      // ranges only ever shrink, so a single pass emptying the others' ones
+      // leaves no chunk behind
+      for (int k{1}; k != n_threads; ++k) {
+        Chunk_range& victim{ranges[(t + k) % n_threads]};
+        while (victim.steal_back(chunk)) {
+          run(chunk);
+        }
+      }
+    }
+  };
+  if (!worker_pool().run(n_threads, work)) {
+    for (int chunk{0}; chunk != n_chunks; ++chunk) {
+      run(chunk);
+    }
+  }
+}
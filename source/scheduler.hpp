@@ -0,0 +1,74 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// defines parallel_for, which splits a loop in chunks run by a few threads,
+// either statically partitioned among them or work-stealing, and the pool of
+// worker threads it runs them on
+
+enum class Partition
+{
+  static_chunks, // each thread runs its contiguous share of the chunks only
+  work_stealing  // idle threads take chunks from the others' shares
+};
+
+// chunks [front, back) owned by a thread: the owner takes them from the front,
+// thieves from the back, both through a compare-exchange on the packed range
+class Chunk_range
+{
+  std::atomic<std::uint64_t> range_{0}; // front in the lower 32 bits
+
+ public:
+  void assign(int front, int back);
+  bool pop_front(int& chunk);
+  bool steal_back(int& chunk);
+};
+
+// threads parked between jobs, so that a job doesn't pay for creating and
+// joining them: a job runs task(0) on the calling thread and task(1) ...
+// task(n_tasks - 1) on the workers, which are created the first time a job
+// needs that many. One job runs at a time
+class Worker_pool
+{
+  std::mutex mutex_; // guards the job's state below
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  std::vector<std::thread> workers_;
+  std::function<void(int)> const* task_{nullptr};
+  int n_tasks_{0};
+  int next_{1};    // next task handed out to a worker
+  int pending_{0}; // tasks of workers not finished yet
+  std::exception_ptr error_{}; // first exception thrown by a worker's task
+  bool stop_{false};
+  std::mutex busy_; // held by the caller of the job running
+  void work();
+
+ public:
+  Worker_pool() = default;
+  Worker_pool(Worker_pool const&) = delete;
+  Worker_pool& operator=(Worker_pool const&) = delete;
+  ~Worker_pool();
+  // runs the job and returns once every task is done (rethrowing then task(0)'s
+  // exception or, if none, the first one thrown by the workers' tasks).
+  // Returns false at once, running nothing, if another job is running (e.g.
+  // the one calling run from one of its tasks)
+  bool run(int n_tasks, std::function<void(int)> const& task);
+};
+
+// the pool shared by every parallel_for
+Worker_pool& worker_pool();
+
+// calls body(begin, end) for consecutive ranges of at most chunk_size items
+// covering [0, n), with n_threads threads (the calling one included) of the
+// pool. If the pool is busy, the calling thread runs every chunk by itself
+void parallel_for(int n, int chunk_size, int n_threads, Partition partition,
+                  std::function<void(int, int)> const& body);
+
+#endif
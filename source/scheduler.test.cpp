@@ -0,0 +1,171 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "scheduler.hpp"
+#include "doctest.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST_CASE("testing Chunk_range")
+{
+  Chunk_range range{};
+  int chunk{-1};
+  CHECK(!range.pop_front(chunk));
+  CHECK(!range.steal_back(chunk));
+
+  range.assign(3, 7);
+  CHECK(range.pop_front(chunk));
+  CHECK(chunk == 3);
+  CHECK(range.steal_back(chunk));
+  CHECK(chunk == 6);
+  CHECK(range.steal_back(chunk));
+  CHECK(chunk == 5);
+  CHECK(range.pop_front(chunk));
+  CHECK(chunk == 4);
+  CHECK(!range.pop_front(chunk));
+  CHECK(!range.steal_back(chunk));
+  CHECK(chunk == 4);
+}
+
+TEST_CASE("testing parallel_for")
+{
+  int const n{1000};
+  std::vector<std::atomic<int>> visits(n);
+  std::atomic<int> too_long{0}; // chunks longer than requested
+  auto const count = [&](int begin, int end) {
+    too_long += (end - begin > 7);
+    for (int i{begin}; i != end; ++i) {
+      ++visits[i];
+    }
+  };
+
+  SUBCASE("every item is visited once, whatever the partition")
+  {
+    for (auto partition :
+         {Partition::static_chunks, Partition::work_stealing}) {
+      for (int n_threads : {1, 2, 5, 1000}) {
+        for (auto& v : visits) {
+          v = 0;
+        }
+        parallel_for(n, 7, n_threads, partition, count);
+        int wrong{0};
+        for (auto const& v : visits) {
+          wrong += (v != 1);
+        }
+        CHECK(wrong == 0);
+        CHECK(too_long == 0);
+      }
+    }
+  }
+
+  SUBCASE("unbalanced work")
+  {
+    // the first chunks cost much more than the others
+    std::atomic<long> sum{0};
+    parallel_for(n, 7, 4, Partition::work_stealing, [&](int begin, int end) {
+      for (int i{begin}; i != end; ++i) {
+        long const reps{(i < 50) ? 20000 : 1};
+        for (long r{0}; r != reps; ++r) {
+          sum += 1;
+        }
+      }
+    });
+    CHECK(sum == 50 * 20000 + (n - 50));
+  }
+
+  SUBCASE("empty loop")
+  {
+    bool called{false};
+    parallel_for(0, 7, 4, Partition::work_stealing,
+                 [&](int, int) { called = true; });
+    CHECK(!called);
+  }
+}
+
+TEST_CASE("testing Worker_pool")
+{
+  SUBCASE("workers are parked between jobs, not created again")
+  {
+    Worker_pool pool{};
+    // the threads running a job's tasks
+    auto const threads_of_job = [&] {
+      std::mutex mutex{};
+      std::set<std::thread::id> ids{};
+      CHECK(pool.run(4, [&](int) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{5});
+        std::lock_guard<std::mutex> lock{mutex};
+        ids.insert(std::this_thread::get_id());
+      }));
+      return ids;
+    };
+    auto const first{threads_of_job()};
+    CHECK(first.size() == 4);
+    CHECK(first.count(std::this_thread::get_id()) == 1);
+    CHECK(threads_of_job() == first);
+  }
+
+  SUBCASE("loops nested in a loop, or run meanwhile, visit every item")
+  {
+    std::atomic<int> visits{0};
+    std::thread other{[&] {
+      for (int k{0}; k != 20; ++k) {
+        parallel_for(100, 3, 3, Partition::work_stealing,
+                     [&](int begin, int end) { visits += end - begin; });
+      }
+    }};
+    for (int k{0}; k != 20; ++k) {
+      parallel_for(10, 1, 4, Partition::work_stealing, [&](int, int) {
+        parallel_for(10, 2, 2, Partition::static_chunks,
+                     [&](int begin, int end) { visits += end - begin; });
+      });
+    }
+    other.join();
+    CHECK(visits == 20 * 100 + 20 * 10 * 10);
+  }
+
+  SUBCASE("the caller's exception waits for the workers")
+  {
+    std::atomic<int> done{0};
+    Worker_pool pool{};
+    CHECK_THROWS_AS(pool.run(3,
+                             [&](int t) {
+                               if (t == 0) {
+                                 throw std::runtime_error{"task 0"};
+                               }
+                               std::this_thread::sleep_for(
+                                   std::chrono::milliseconds{5});
+                               ++done;
+                             }),
+                    std::runtime_error);
+    CHECK(done == 2);
+  }
+
+  SUBCASE("the workers' exceptions are thrown by the caller")
+  {
+    std::atomic<int> done{0};
+    Worker_pool pool{};
+    CHECK_THROWS_AS(pool.run(3,
+                             [&](int t) {
+                               if (t == 2) {
+                                 throw std::runtime_error{"task 2"};
+                               }
+                               ++done;
+                             }),
+                    std::runtime_error);
+    CHECK(done == 2);
+    // the caller's exception comes first, a job after a failed one runs
+    CHECK_THROWS_AS(pool.run(3,
+                             [&](int t) {
+                               if (t == 0) {
+                                 throw std::logic_error{"task 0"};
+                               }
+                               throw std::runtime_error{"worker"};
+                             }),
+                    std::logic_error);
+    CHECK(pool.run(3, [&](int) { ++done; }));
+    CHECK(done == 5);
+  }
+}
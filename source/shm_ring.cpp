@@ -0,0 +1,228 @@
+#include "shm_ring.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// defines the shared memory ring's layout, its writer and its readers
+
+char constexpr ring_magic[]{"BOIDSHM"};
+std::size_t constexpr alignment{64};
+
+std::size_t round_up(std::size_t bytes)
+{
+  return (bytes + alignment - 1) / alignment * alignment;
+}
+
+std::size_t slot_bytes(std::uint32_t capacity)
+{
+  return round_up(sizeof(Slot_header)
+                  + capacity * (4 * sizeof(double) + sizeof(std::int32_t) + 1));
+}
+
+std::size_t ring_bytes(std::uint32_t slots, std::uint32_t capacity)
+{
+  return round_up(sizeof(Ring_header)) + slots * slot_bytes(capacity);
+}
+
+std::runtime_error shm_error(std::string const& what)
+{
+  return std::runtime_error{"ERROR: " + what + ": " + std::strerror(errno)};
+}
+
+Slot_header& Shm_mapping::slot(std::uint64_t frame) const
+{
+  Ring_header const& h{header()};
+  char* const slots{static_cast<char*>(data_)
+                    + round_up(sizeof(Ring_header))};
+  return *reinterpret_cast<Slot_header*>(
+      slots + (frame % h.slots) * slot_bytes(h.capacity));
+}
+
+char* Shm_mapping::arrays(std::uint64_t frame) const
+{
+  return reinterpret_cast<char*>(&slot(frame)) + sizeof(Slot_header);
+}
+
+Shm_mapping::~Shm_mapping()
+{
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+}
+
+Shm_ring_writer::Shm_ring_writer(std::string const& name, std::uint32_t slots,
+                                 std::uint32_t capacity)
+{
+  assert(slots > 1 && capacity > 0);
+  int const fd{shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644)};
+  if (fd < 0) {
+    throw shm_error("Cannot create shared memory " + name);
+  }
+  std::size_t const size{ring_bytes(slots, capacity)};
+  if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    auto const error{shm_error("Cannot size shared memory " + name)};
+    close(fd);
+    shm_unlink(name.c_str());
+    throw error;
+  }
+  void* const data{
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)};
+  close(fd);
+  if (data == MAP_FAILED) {
+    auto const error{shm_error("Cannot map shared memory " + name)};
+    shm_unlink(name.c_str());
+    throw error;
+  }
+  name_ = name;
+  data_ = data;
+  size_ = size;
+
+  // the object is zero-filled by ftruncate: slots' sequence numbers start at 0
+  auto* const h{new (data_) Ring_header{{}, slots, capacity, {0}}};
+  std::memcpy(h->magic, ring_magic, sizeof(h->magic));
+  for (std::uint32_t s{0}; s != slots; ++s) {
+    new (&slot(s)) Slot_header{{0}, 0, 0., 0};
+  }
+}
+
+Shm_ring_writer::~Shm_ring_writer()
+{
+  shm_unlink(name_.c_str());
+}
+
+void Shm_ring_writer::publish(Snapshot const& snapshot)
+{
+  Ring_header& h{header()};
+  auto const n{static_cast<std::uint32_t>(snapshot.state.size())};
+  if (n > h.capacity) {
+    throw std::runtime_error{"ERROR: Flock too large for shared memory "
+                             + name_};
+  }
+  std::uint64_t const frame{h.published.load(std::memory_order_relaxed)};
+  Slot_header& s{slot(frame)};
+  std::uint64_t const sequence{s.sequence.load(std::memory_order_relaxed)};
+  // an odd sequence number tells readers the slot is being written
+  s.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  s.frame   = frame;
+  s.time    = snapshot.time;
+  s.n_boids = n;
+  auto* const x{reinterpret_cast<double*>(arrays(frame))};
+  double* const y{x + h.capacity};
+  double* const v_x{y + h.capacity};
+  double* const v_y{v_x + h.capacity};
+  auto* const id{reinterpret_cast<std::int32_t*>(v_y + h.capacity)};
+  auto* const is_pred{reinterpret_cast<std::uint8_t*>(id + h.capacity)};
+  for (std::uint32_t i{0}; i != n; ++i) {
+    Boid const& boid{snapshot.state[i]};
+    x[i]       = boid.position().x();
+    y[i]       = boid.position().y();
+    v_x[i]     = boid.velocity().x();
+    v_y[i]     = boid.velocity().y();
+    id[i]      = boid.id();
+    is_pred[i] = boid.is_pred();
+  }
+
+  s.sequence.store(sequence + 2, std::memory_order_release);
+  h.published.store(frame + 1, std::memory_order_release);
+}
+
+Shm_ring_reader::Shm_ring_reader(std::string const& name)
+{
+  int const fd{shm_open(name.c_str(), O_RDONLY, 0)};
+  if (fd < 0) {
+    throw shm_error("Cannot open shared memory " + name);
+  }
+  struct stat st{};
+  void* data{MAP_FAILED};
+  if (fstat(fd, &st) == 0
+      && st.st_size >= static_cast<off_t>(sizeof(Ring_header))) {
+    data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED) {
+    throw shm_error("Cannot map shared memory " + name);
+  }
+  name_ = name;
+  data_ = data;
+  size_ = st.st_size;
+  Ring_header const& h{header()};
+  if (std::memcmp(h.magic, ring_magic, sizeof(h.magic)) != 0 || h.slots < 2
+      || size_ < ring_bytes(h.slots, h.capacity)) {
+    throw std::runtime_error{"ERROR: " + name + " is not a ring of frames"};
+  }
+}
+
+bool Shm_ring_reader::latest(Frame_view& view) const
+{
+  Ring_header const& h{header()};
+  while (true) {
+    std::uint64_t const published{this->published()};
+    if (published == 0) {
+      return false;
+    }
+    std::uint64_t const frame{published - 1};
+    Slot_header const& s{slot(frame)};
+    std::uint64_t const sequence{s.sequence.load(std::memory_order_acquire)};
+    if (sequence % 2 != 0) {
+      // the writer went round the ring and is overwriting the slot
+      continue;
+    }
+    auto const* const x{reinterpret_cast<double const*>(arrays(frame))};
+    auto const* const id{
+        reinterpret_cast<std::int32_t const*>(x + 4 * h.capacity)};
+    // values read while the slot is overwritten are discarded below, but must
+    // not lead out of the arrays meanwhile
+    view = {frame,
+            sequence,
+            s.time,
+            std::min(s.n_boids, h.capacity),
+            x,
+            x + h.capacity,
+            x + 2 * h.capacity,
+            x + 3 * h.capacity,
+            id,
+            reinterpret_cast<std::uint8_t const*>(id + h.capacity)};
+    // the slot may hold a later frame already
+    if (s.frame == frame && valid(view)) {
+      return true;
+    }
+  }
+}
+
+bool Shm_ring_reader::valid(Frame_view const& view) const
+{
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot(view.frame).sequence.load(std::memory_order_relaxed)
+      == view.sequence;
+}
+
+bool Shm_ring_reader::read_latest(Snapshot& snapshot) const
+{
+  Frame_view view{};
+  do {
+    if (!latest(view)) {
+      return false;
+    }
+    snapshot.time = view.time;
+    snapshot.d_t  = 0.;
+    snapshot.state.clear();
+    snapshot.observations.clear();
+    for (std::uint32_t i{0}; i != view.n_boids; ++i) {
+      Position const p{view.x[i], view.y[i]};
+      Velocity const v{view.v_x[i], view.v_y[i]};
+      snapshot.state.push_back((view.is_pred[i]) ? Boid{p, v, true}
+                                                 : Boid{p, v});
+      snapshot.state.back().id() = view.id[i];
+    }
+  } while (!valid(view));
+  return true;
+}
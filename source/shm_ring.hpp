@@ -0,0 +1,106 @@
+#ifndef SHM_RING_HPP
+#define SHM_RING_HPP
+#include "snapshots.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// defines a ring of frames in POSIX shared memory, written by simulate and read
+// by any number of processes on the same host. Frames are laid out as
+// structures of arrays, and each slot is guarded by a sequence lock: the writer
+// never waits for readers, readers retry if the slot changed while they read
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "sequence numbers are shared between processes");
+
+// at the start of the shared memory object, followed by the slots
+struct Ring_header
+{
+  char magic[8];
+  std::uint32_t slots;
+  std::uint32_t capacity; // boids per slot
+  std::atomic<std::uint64_t> published; // frames written so far
+};
+
+// at the start of each slot, followed by arrays x, y, v_x, v_y (doubles), id
+// (int32) and is_pred (uint8), capacity elements each
+struct Slot_header
+{
+  std::atomic<std::uint64_t> sequence; // odd while the slot is being written
+  std::uint64_t frame;
+  double time;
+  std::uint32_t n_boids;
+};
+
+// the arrays of a frame in the ring, valid as long as its slot's sequence
+// number is unchanged
+struct Frame_view
+{
+  std::uint64_t frame;
+  std::uint64_t sequence;
+  double time;
+  std::uint32_t n_boids;
+  double const* x;
+  double const* y;
+  double const* v_x;
+  double const* v_y;
+  std::int32_t const* id;
+  std::uint8_t const* is_pred;
+};
+
+// mapping of the shared memory object, common to writer and readers
+class Shm_mapping
+{
+ protected:
+  std::string name_;
+  void* data_{nullptr};
+  std::size_t size_{0};
+
+  Ring_header& header() const
+  {
+    return *static_cast<Ring_header*>(data_);
+  }
+  Slot_header& slot(std::uint64_t frame) const;
+  // arrays of the slot, in the order given above
+  char* arrays(std::uint64_t frame) const;
+
+ public:
+  Shm_mapping() = default;
+  ~Shm_mapping();
+  Shm_mapping(Shm_mapping const&)            = delete;
+  Shm_mapping& operator=(Shm_mapping const&) = delete;
+};
+
+std::size_t slot_bytes(std::uint32_t capacity);
+
+// creates (or replaces) the shared memory object name ("/something"), removed
+// again when the writer is destroyed
+class Shm_ring_writer : public Shm_mapping
+{
+ public:
+  explicit Shm_ring_writer(std::string const& name, std::uint32_t slots,
+                           std::uint32_t capacity);
+  ~Shm_ring_writer();
+  void publish(Snapshot const& snapshot);
+};
+
+class Shm_ring_reader : public Shm_mapping
+{
+ public:
+  explicit Shm_ring_reader(std::string const& name);
+  // frames written so far
+  std::uint64_t published() const
+  {
+    return header().published.load(std::memory_order_acquire);
+  }
+  // arrays of the latest frame, read in place: valid must be checked once
+  // done with them. Returns false if no frame was published yet
+  bool latest(Frame_view& view) const;
+  bool valid(Frame_view const& view) const;
+  // copy of the latest consistent frame, retrying while the writer overwrites
+  // it. Returns false if no frame was published yet
+  bool read_latest(Snapshot& snapshot) const;
+};
+
+#endif
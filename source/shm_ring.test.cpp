@@ -0,0 +1,93 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "shm_ring.hpp"
+#include "doctest.h"
+#include <atomic>
+#include <thread>
+
+// snapshot whose values all tell the frame it belongs to
+Snapshot make_snapshot(int frame, int n)
+{
+  Snapshot snapshot{frame * .5, .5, {}, {}};
+  for (int i{0}; i != n; ++i) {
+    Position const p{frame * 1., i * 1.};
+    Velocity const v{frame * 2., -i * 1.};
+    snapshot.state.push_back((i == 0) ? Boid{p, v, true} : Boid{p, v});
+    snapshot.state.back().id() = frame + i;
+  }
+  return snapshot;
+}
+
+TEST_CASE("testing shared memory ring")
+{
+  std::string const name{"/boids_shm_ring_test"};
+  Shm_ring_writer writer{name, 4, 100};
+  Shm_ring_reader reader{name};
+  Snapshot snapshot{};
+  CHECK(reader.published() == 0u);
+  CHECK_FALSE(reader.read_latest(snapshot));
+
+  SUBCASE("latest frame")
+  {
+    for (int frame{0}; frame != 10; ++frame) {
+      writer.publish(make_snapshot(frame, 50 + frame));
+    }
+    CHECK(reader.published() == 10u);
+    REQUIRE(reader.read_latest(snapshot));
+    Snapshot const expected{make_snapshot(9, 59)};
+    CHECK(snapshot.time == expected.time);
+    REQUIRE(snapshot.state.size() == 59u);
+    int different{0};
+    for (std::size_t i{0}; i != 59; ++i) {
+      different += snapshot.state[i].position() != expected.state[i].position()
+                || snapshot.state[i].velocity() != expected.state[i].velocity()
+                || snapshot.state[i].id() != expected.state[i].id()
+                || snapshot.state[i].is_pred() != expected.state[i].is_pred();
+    }
+    CHECK(different == 0);
+
+    // arrays read in place
+    Frame_view view{};
+    REQUIRE(reader.latest(view));
+    CHECK(view.frame == 9u);
+    CHECK(view.n_boids == 59u);
+    CHECK(view.x[10] == 9.);
+    CHECK(view.v_y[10] == -10.);
+    CHECK(view.is_pred[0] == 1);
+    CHECK(reader.valid(view));
+    // the slot is overwritten once the writer goes round the ring
+    for (int frame{10}; frame != 14; ++frame) {
+      writer.publish(make_snapshot(frame, 50));
+    }
+    CHECK_FALSE(reader.valid(view));
+  }
+
+  SUBCASE("frames read while written are consistent")
+  {
+    std::atomic<bool> done{false};
+    std::thread writing{[&] {
+      for (int frame{0}; frame != 20000; ++frame) {
+        writer.publish(make_snapshot(frame, 100));
+      }
+      done = true;
+    }};
+    int inconsistent{0};
+    int reads{0};
+    while (!done) {
+      if (reader.read_latest(snapshot)) {
+        ++reads;
+        double const frame{snapshot.state[0].position().x()};
+        for (Boid const& boid : snapshot.state) {
+          inconsistent += boid.position().x() != frame
+                       || boid.velocity().x() != 2. * frame;
+        }
+        inconsistent += snapshot.time != frame * .5;
+      }
+    }
+    writing.join();
+    CHECK(reads > 0);
+    CHECK(inconsistent == 0);
+  }
+
+  CHECK_THROWS(writer.publish(make_snapshot(0, 101)));
+  CHECK_THROWS(Shm_ring_reader{"/boids_no_such_ring"});
+}
@@ -0,0 +1,124 @@
+#include "snapshots.hpp"
+#include "bytes.hpp"
+#include <algorithm>
+#include <cassert>
+#include <ios>
+#include <unistd.h>
+
+// defines the serialization of snapshots in the store's arena and file
+
+// bytes taken by a boid and by a result once serialized
+std::size_t constexpr boid_bytes{4 * sizeof(double) + sizeof(int) + 1};
+std::size_t constexpr result_bytes{2 * sizeof(double)};
+
+void Snapshot_store::push_back(Snapshot const& snapshot)
+{
+  std::size_t const bytes{snapshot.state.size() * boid_bytes
+                          + snapshot.observations.size() * result_bytes};
+  // a snapshot larger than the budget is kept alone in memory
+  if (!arena_.empty() && arena_.size() + bytes > budget_) {
+    spill();
+  }
+  // the arena doubles as needed up to the budget, so that short runs don't
+  // take it all
+  std::size_t const size{arena_.size() + bytes};
+  if (arena_.capacity() < size) {
+    arena_.reserve(std::max(size, std::min(budget_, 2 * arena_.capacity())));
+  }
+  frames_.push_back({snapshot.time, snapshot.d_t,
+                     static_cast<int>(snapshot.state.size()),
+                     static_cast<int>(snapshot.observations.size()),
+                     arena_.size(), false});
+  arena_.resize(arena_.size() + bytes);
+  char* out{arena_.data() + frames_.back().offset};
+  for (Boid const& boid : snapshot.state) {
+    out = put(out, boid.position().x());
+    out = put(out, boid.position().y());
+    out = put(out, boid.velocity().x());
+    out = put(out, boid.velocity().y());
+    out = put(out, boid.id());
+    out = put(out, static_cast<char>(boid.is_pred()));
+  }
+  for (Result const& result : snapshot.observations) {
+    out = put(out, result.mean);
+    out = put(out, result.std_dev);
+  }
+  assert(out == arena_.data() + arena_.size());
+}
+
+// appends the whole arena to the file, then empties it (keeping its capacity)
+void Snapshot_store::spill()
+{
+  if (!file_) {
+    file_.reset(std::tmpfile());
+    if (!file_) {
+      throw std::ios_base::failure{"ERROR: Cannot create temporary file for "
+                                   "snapshots\n"};
+    }
+  }
+  if (std::fseek(file_.get(), 0, SEEK_END) != 0
+      || std::fwrite(arena_.data(), 1, arena_.size(), file_.get())
+             != arena_.size()
+      || std::fflush(file_.get()) != 0) {
+    throw std::ios_base::failure{"ERROR: Cannot write snapshots to temporary "
+                                 "file\n"};
+  }
+  for (auto it{frames_.rbegin()}; it != frames_.rend() && !it->spilled; ++it) {
+    it->offset += file_size_;
+    it->spilled = true;
+    ++spilled_;
+  }
+  file_size_ += arena_.size();
+  arena_.clear();
+}
+
+Snapshot Snapshot_store::read(Frame const& frame) const
+{
+  std::size_t const bytes{frame.n_boids * boid_bytes
+                          + frame.n_observations * result_bytes};
+  std::vector<char> buffer{};
+  char const* in{arena_.data() + frame.offset};
+  if (frame.spilled) {
+    buffer.resize(bytes);
+    // pread leaves the file's offset alone: readers don't race each other
+    if (pread(fileno(file_.get()), buffer.data(), bytes,
+              static_cast<off_t>(frame.offset))
+        != static_cast<ssize_t>(bytes)) {
+      throw std::ios_base::failure{"ERROR: Cannot read snapshots from "
+                                   "temporary file\n"};
+    }
+    in = buffer.data();
+  }
+
+  Snapshot snapshot{frame.time, frame.d_t, {}, {}};
+  snapshot.state.reserve(frame.n_boids);
+  for (int i{0}; i != frame.n_boids; ++i) {
+    double x{};
+    double y{};
+    double v_x{};
+    double v_y{};
+    int id{};
+    char is_pred{};
+    in = get(in, x);
+    in = get(in, y);
+    in = get(in, v_x);
+    in = get(in, v_y);
+    in = get(in, id);
+    in = get(in, is_pred);
+    snapshot.state.push_back((is_pred) ? Boid{{x, y}, {v_x, v_y}, true}
+                                       : Boid{{x, y}, {v_x, v_y}});
+    snapshot.state.back().id() = id;
+  }
+  snapshot.observations.resize(frame.n_observations);
+  for (Result& result : snapshot.observations) {
+    in = get(in, result.mean);
+    in = get(in, result.std_dev);
+  }
+  return snapshot;
+}
+
+Snapshot Snapshot_store::operator[](std::size_t i) const
+{
+  assert(i < size());
+  return read(frames_[i]);
+}
@@ -0,0 +1,118 @@
+#ifndef SNAPSHOTS_HPP
+#define SNAPSHOTS_HPP
+#include "boids.hpp"
+#include "observables.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+// defines struct Snapshot and class Snapshot_store, where simulate saves the
+// flock's states within a memory budget
+
+// state of the flock saved by simulate, with the simulated time it refers to,
+// the time step used to evolve the flock from it and the results of the
+// observables (if any) fed during that evolution
+struct Snapshot
+{
+  double time;
+  double d_t;
+  std::vector<Boid> state;
+  std::vector<Result> observations{};
+};
+
+// snapshots serialized one after the other in a single arena: when a new one
+// would take the arena over budget, those in memory are moved to a temporary
+// file (removed when the store is destroyed) and the arena is reused. Stored
+// snapshots are read back by value, from memory or from the file; const
+// members can be called by several threads at once
+class Snapshot_store
+{
+  struct Frame
+  {
+    double time;
+    double d_t;
+    int n_boids;
+    int n_observations;
+    std::size_t offset; // in the arena, or in the file if spilled
+    bool spilled;
+  };
+  std::size_t budget_; // bytes
+  std::vector<char> arena_;
+  std::vector<Frame> frames_;
+  std::unique_ptr<std::FILE, int (*)(std::FILE*)> file_{nullptr, std::fclose};
+  std::size_t file_size_{0};
+  std::size_t spilled_{0}; // frames in the file
+
+  void spill();
+  Snapshot read(Frame const& frame) const;
+
+ public:
+  static constexpr std::size_t default_budget{std::size_t{256} << 20};
+
+  // input iterator over the snapshots, dereferencing to a copy
+  class const_iterator
+  {
+    Snapshot_store const* store_;
+    std::size_t i_;
+
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type        = Snapshot;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = void;
+    using reference         = Snapshot;
+
+    const_iterator(Snapshot_store const* store, std::size_t i)
+        : store_{store}
+        , i_{i}
+    {}
+    Snapshot operator*() const
+    {
+      return (*store_)[i_];
+    }
+    const_iterator& operator++()
+    {
+      ++i_;
+      return *this;
+    }
+    bool operator==(const_iterator const& other) const
+    {
+      return store_ == other.store_ && i_ == other.i_;
+    }
+    bool operator!=(const_iterator const& other) const
+    {
+      return !(*this == other);
+    }
+  };
+
+  explicit Snapshot_store(std::size_t budget = default_budget)
+      : budget_{budget}
+  {}
+  // clang-format off
+  bool empty() const{ return frames_.empty(); }
+  std::size_t size() const{ return frames_.size(); }
+  std::size_t spilled() const{ return spilled_; }
+  // clang-format on
+  void push_back(Snapshot const& snapshot);
+  Snapshot operator[](std::size_t i) const;
+  Snapshot front() const
+  {
+    return (*this)[0];
+  }
+  Snapshot back() const
+  {
+    return (*this)[size() - 1];
+  }
+  const_iterator begin() const
+  {
+    return {this, 0};
+  }
+  const_iterator end() const
+  {
+    return {this, size()};
+  }
+};
+
+#endif
@@ -0,0 +1,107 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "snapshots.hpp"
+#include "doctest.h"
+#include <thread>
+
+// snapshot i: i + 1 boids (the last one a predator) and i results
+Snapshot make_snapshot(int i)
+{
+  Snapshot snapshot{i * .5, .1 * (i + 1), {}, {}};
+  for (int j{0}; j <= i; ++j) {
+    Position const p{j + .25, -j * 1.5};
+    Velocity const v{i * 1., j * -.75};
+    snapshot.state.push_back((j == i) ? Boid{p, v, true} : Boid{p, v});
+    snapshot.state.back().id() = 10 * i + j;
+  }
+  for (int j{0}; j != i; ++j) {
+    snapshot.observations.push_back({j * 2., j * .125});
+  }
+  return snapshot;
+}
+
+void check_equal(Snapshot const& s1, Snapshot const& s2)
+{
+  CHECK(s1.time == s2.time);
+  CHECK(s1.d_t == s2.d_t);
+  REQUIRE(s1.state.size() == s2.state.size());
+  for (std::size_t j{0}; j != s1.state.size(); ++j) {
+    CHECK(s1.state[j].position() == s2.state[j].position());
+    CHECK(s1.state[j].velocity() == s2.state[j].velocity());
+    CHECK(s1.state[j].is_pred() == s2.state[j].is_pred());
+    CHECK(s1.state[j].id() == s2.state[j].id());
+  }
+  REQUIRE(s1.observations.size() == s2.observations.size());
+  for (std::size_t j{0}; j != s1.observations.size(); ++j) {
+    CHECK(s1.observations[j].mean == s2.observations[j].mean);
+    CHECK(s1.observations[j].std_dev == s2.observations[j].std_dev);
+  }
+}
+
+TEST_CASE("testing Snapshot_store")
+{
+  SUBCASE("within budget")
+  {
+    Snapshot_store store{};
+    CHECK(store.empty());
+    for (int i{0}; i != 20; ++i) {
+      store.push_back(make_snapshot(i));
+    }
+    CHECK(store.size() == 20u);
+    CHECK(store.spilled() == 0u);
+    check_equal(store.front(), make_snapshot(0));
+    check_equal(store.back(), make_snapshot(19));
+  }
+
+  SUBCASE("spilling to disk")
+  {
+    // a few snapshots fit in the budget
+    Snapshot_store store{1000};
+    for (int i{0}; i != 20; ++i) {
+      store.push_back(make_snapshot(i));
+    }
+    CHECK(store.size() == 20u);
+    CHECK(store.spilled() > 0u);
+    CHECK(store.spilled() < 20u);
+    int i{0};
+    for (Snapshot const& snapshot : store) {
+      check_equal(snapshot, make_snapshot(i));
+      ++i;
+    }
+    CHECK(i == 20);
+
+    // readers of the file don't get in each other's way
+    std::vector<int> mismatches(4, 0);
+    std::vector<std::thread> readers{};
+    for (int t{0}; t != 4; ++t) {
+      readers.emplace_back([&store, &mismatches, t] {
+        for (int j{0}; j != 100; ++j) {
+          Snapshot const snapshot{store[j % 20]};
+          Snapshot const expected{make_snapshot(j % 20)};
+          for (std::size_t k{0}; k != expected.state.size(); ++k) {
+            if (!(snapshot.state[k].position()
+                  == expected.state[k].position())) {
+              ++mismatches[t];
+            }
+          }
+        }
+      });
+    }
+    for (auto& reader : readers) {
+      reader.join();
+    }
+    CHECK(mismatches == std::vector<int>(4, 0));
+  }
+
+  SUBCASE("snapshots larger than the budget")
+  {
+    Snapshot_store store{10};
+    for (int i{0}; i != 5; ++i) {
+      store.push_back(make_snapshot(i));
+    }
+    // every snapshot but the last one was moved to disk
+    CHECK(store.spilled() == 4u);
+    for (int i{0}; i != 5; ++i) {
+      check_equal(store[i], make_snapshot(i));
+    }
+  }
+}
@@ -1,6 +1,9 @@
 #include "stats.hpp"
+#include "scheduler.hpp"
 #include <algorithm>
 #include <cmath>
+#include <functional>
+#include <iterator>
 #include <fstream>
 #include <numeric>
 #include <sstream>
@@ -55,40 +58,331 @@ Result mean_dist(std::vector<Boid> const& state)
 // returns mean speed of boids with its std_dev
 Result mean_speed(std::vector<Boid> const& state)
 {
-  int N{static_cast<int>(state.size())};
-  assert(N > 1);
+  assert(state.size() > 1);
+  // single pass, each speed computed once
+  Welford speed{};
+  for (Boid const& boid : state) {
+    speed.add(norm(boid.velocity()));
+  }
+  return speed.result();
+}
 
-  auto sum_speed{std::transform_reduce(
-      state.begin(), state.end(), 0., std::plus<>{},
-      [](Boid const& boid) { return norm(boid.velocity()); })};
+Union_find::Union_find(int n)
+    : parent_(n)
+{
+  for (int i{0}; i != n; ++i) {
+    parent_[i].store(i);
+  }
+}
 
-  auto sum_sq_speed{std::transform_reduce(
-      state.begin(), state.end(), 0., std::plus<>{}, [](Boid const& boid) {
-        return (norm(boid.velocity()) * norm(boid.velocity()));
-      })};
+// returns the root of i's set, halving the path to it on the way (a failed
+// compare-exchange only means that another thread shortened it first)
+int Union_find::find(int i)
+{
+  while (true) {
+    int parent{parent_[i].load()};
+    int const grandparent{parent_[parent].load()};
+    if (parent == grandparent) {
+      return parent;
+    }
+    parent_[i].compare_exchange_weak(parent, grandparent);
+    i = grandparent;
+  }
+}
 
-  double mean_speed{sum_speed / N};
-  double mean_sq_speed{sum_sq_speed / N};
-  double std_dev{
-      std::sqrt(N / (N - 1.) * (mean_sq_speed - mean_speed * mean_speed))};
+// links the root with the larger index under the other one, so that no cycle
+// can be formed; if the root got linked meanwhile by another thread, retries
+void Union_find::unite(int i, int j)
+{
+  while (true) {
+    i = find(i);
+    j = find(j);
+    if (i == j) {
+      return;
+    }
+    if (i < j) {
+      std::swap(i, j);
+    }
+    int expected{i};
+    if (parent_[i].compare_exchange_strong(expected, j)) {
+      return;
+    }
+  }
+}
+
+// auxiliary function, returns the sizes (largest first) of the clusters of
+// regular boids, i.e. the connected components of the graph linking boids
+// closer than d. Pairs are found through a grid, with chunks of boids handed
+// out by parallel_for to n_threads threads
+std::vector<int> clusters(std::vector<Boid> const& state, double d,
+                          int n_threads, Partition partition)
+{
+  assert(d > 0.);
+  int const N{static_cast<int>(state.size())};
+  // grid's limits only affect performance, boids outside are still found
+  auto const [x_min, x_max] = std::minmax_element(
+      state.begin(), state.end(), [](Boid const& b1, Boid const& b2) {
+        return b1.position().x() < b2.position().x();
+      });
+  auto const [y_min, y_max] = std::minmax_element(
+      state.begin(), state.end(), [](Boid const& b1, Boid const& b2) {
+        return b1.position().y() < b2.position().y();
+      });
+  Grid const grid{state,
+                  d,
+                  x_min->position().x(),
+                  std::max(x_max->position().x(), x_min->position().x() + d),
+                  y_min->position().y(),
+                  std::max(y_max->position().y(), y_min->position().y() + d)};
+
+  Union_find sets{N};
+  auto const link{[&](int begin, int end) {
+    for (int i{begin}; i != end; ++i) {
+      if (state[i].is_pred()) {
+        continue;
+      }
+      grid.for_each_near(state[i].position(), d, [&](int j) {
+        if (j > i && !(state[j].is_pred())
+            && distance(state[i], state[j]) < d) {
+          sets.unite(i, j);
+        }
+      });
+    }
+  }};
+  int constexpr chunk_size{64};
+  parallel_for(N, chunk_size, n_threads, partition, link);
+
+  std::vector<int> sizes(N, 0);
+  for (int i{0}; i != N; ++i) {
+    if (!(state[i].is_pred())) {
+      ++sizes[sets.find(i)];
+    }
+  }
+  sizes.erase(std::remove(sizes.begin(), sizes.end(), 0), sizes.end());
+  std::sort(sizes.begin(), sizes.end(), std::greater<>{});
+  return sizes;
+}
+
+// serially, as the workers of Stats_pool do (each one on a state of its own)
+std::vector<int> clusters(std::vector<Boid> const& state, double d)
+{
+  return clusters(state, d, 1, Partition::static_chunks);
+}
+
+// with the threads and the partition of the evolution
+std::vector<int> clusters(std::vector<Boid> const& state, double d,
+                          Parameters const& pars)
+{
+  return clusters(state, d, pars.get_threads(),
+                  (pars.get_work_stealing()) ? Partition::work_stealing
+                                             : Partition::static_chunks);
+}
+
+// counts the pairs of regular boids in each bin, then normalizes the counts
+std::vector<double> rdf(std::vector<Boid> const& state,
+                        Rdf_binning const& binning)
+{
+  assert(binning.cutoff > 0. && binning.n_bins > 0 && binning.area > 0.);
+  std::vector<Boid> regular{};
+  std::copy_if(state.begin(), state.end(), std::back_inserter(regular),
+               [](Boid const& boid) { return !boid.is_pred(); });
+  int const N{static_cast<int>(regular.size())};
+  std::vector<double> g(binning.n_bins, 0.);
+  if (N < 2) {
+    return g;
+  }
+
+  double const cutoff{binning.cutoff};
+  double const bin_width{cutoff / binning.n_bins};
+  auto const [x_min, x_max] = std::minmax_element(
+      regular.begin(), regular.end(), [](Boid const& b1, Boid const& b2) {
+        return b1.position().x() < b2.position().x();
+      });
+  auto const [y_min, y_max] = std::minmax_element(
+      regular.begin(), regular.end(), [](Boid const& b1, Boid const& b2) {
+        return b1.position().y() < b2.position().y();
+      });
+  Grid const grid{
+      regular,
+      cutoff,
+      x_min->position().x(),
+      std::max(x_max->position().x(), x_min->position().x() + cutoff),
+      y_min->position().y(),
+      std::max(y_max->position().y(), y_min->position().y() + cutoff)};
+  for (int i{0}; i != N; ++i) {
+    grid.for_each_near(regular[i].position(), cutoff, [&](int j) {
+      if (j > i) {
+        double const r{distance(regular[i], regular[j])};
+        if (r < cutoff) {
+          g[std::min(static_cast<int>(r / bin_width), binning.n_bins - 1)] +=
+              1.;
+        }
+      }
+    });
+  }
+
+  // pairs expected in the annulus of each bin
+  double const pairs{N * (N - 1) / 2.};
+  for (int k{0}; k != binning.n_bins; ++k) {
+    double const annulus{pi * bin_width * bin_width * (2. * k + 1.)};
+    g[k] /= pairs * annulus / binning.area;
+  }
+  return g;
+}
+
+// gathers every statistic of state, g(r) only if binning has bins
+State_stats state_stats(std::vector<Boid> const& state, double d,
+                        Rdf_binning const& binning)
+{
+  return {mean_dist(state), mean_speed(state), clusters(state, d),
+          (binning.n_bins > 0) ? rdf(state, binning) : std::vector<double>{}};
+}
+
+Stats_pool::Stats_pool(double d, int n_workers, Rdf_binning const& binning,
+                       Stats_callback on_result, std::size_t capacity)
+    : d_{d}
+    , binning_{binning}
+    , on_result_{std::move(on_result)}
+    , queue_{capacity}
+{
+  assert(d_ > 0. && n_workers > 0);
+  for (int i{0}; i != n_workers; ++i) {
+    workers_.emplace_back(&Stats_pool::work, this);
+  }
+}
+
+Stats_pool::~Stats_pool()
+{
+  // errors can't be reported from here: close should have been called
+  if (!closed_) {
+    queue_.close();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+}
 
-  return {mean_speed, std_dev};
+void Stats_pool::work()
+{
+  while (auto job = queue_.pop()) {
+    try {
+      // each worker computes clusters by itself: states are spread over
+      // workers instead
+      State_stats stats{state_stats(job->second, d_, binning_)};
+      std::lock_guard<std::mutex> lock{mutex_};
+      results_[job->first] = std::move(stats);
+      done_[job->first]    = true;
+      // whoever completes the first result not passed yet passes it, and the
+      // following ones done meanwhile
+      while (passed_ != done_.size() && done_[passed_]) {
+        std::size_t const i{passed_++};
+        if (on_result_) {
+          on_result_(times_[i], results_[i]);
+        }
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock{mutex_};
+      if (!error_) {
+        error_ = std::current_exception();
+      }
+    }
+  }
+}
+
+void Stats_pool::push(Snapshot const& snapshot)
+{
+  assert(!closed_);
+  int index{0};
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    index = static_cast<int>(results_.size());
+    results_.emplace_back();
+    times_.push_back(snapshot.time);
+    done_.push_back(false);
+  }
+  queue_.push({index, snapshot.state});
+}
+
+std::vector<State_stats> const& Stats_pool::close()
+{
+  if (!closed_) {
+    closed_ = true;
+    queue_.close();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+  if (error_) {
+    std::rethrow_exception(error_);
+  }
+  return results_;
 }
 
 // prints calculated data to standard output
 void print_state(std::vector<Boid> const& state)
 {
-  Result distance{mean_dist(state)};
-  Result speed{mean_speed(state)};
+  print_state(State_stats{mean_dist(state), mean_speed(state), {}});
+}
 
+void print_state(State_stats const& stats)
+{
   std::cout << std::setprecision(3) << std::fixed << std::setw(8)
-            << distance.mean << " \u00b1 " << std::setw(7) << distance.std_dev
-            << std::setw(8) << '|' << std::setw(13) << speed.mean << " \u00b1 "
-            << std::setw(7) << speed.std_dev << '\n';
+            << stats.distance.mean << " \u00b1 " << std::setw(7)
+            << stats.distance.std_dev << std::setw(8) << '|' << std::setw(13)
+            << stats.speed.mean << " \u00b1 " << std::setw(7)
+            << stats.speed.std_dev << '\n';
+}
+
+void print_clusters(std::vector<Boid> const& state, double d)
+{
+  print_clusters(State_stats{{}, {}, clusters(state, d)});
+}
+
+// prints number of clusters and their sizes (only the largest ones, if many)
+void print_clusters(State_stats const& stats)
+{
+  auto const& sizes{stats.clusters};
+  int constexpr max_printed{12};
+  std::cout << std::setw(8) << sizes.size() << std::setw(8) << '|' << ' ';
+  std::for_each(sizes.begin(),
+                sizes.begin() + std::min<int>(sizes.size(), max_printed),
+                [](int size) { std::cout << ' ' << size; });
+  if (static_cast<int>(sizes.size()) > max_printed) {
+    std::cout << " ...";
+  }
+  std::cout << '\n';
+}
+
+// prints results of the observables saved with snapshot, in the order given
+// by Observables::names
+void print_observations(Snapshot const& snapshot)
+{
+  std::cout << std::setprecision(3) << std::fixed;
+  for (Result const& result : snapshot.observations) {
+    if (std::isnan(result.mean)) {
+      std::cout << std::setw(19) << "n/a" << "  |";
+    } else {
+      std::cout << std::setw(9) << result.mean << " \u00b1 " << std::setw(7)
+                << result.std_dev << "  |";
+    }
+  }
+  std::cout << '\n';
+}
+
+// writes to os the line of the data file describing snapshot
+void print_data(std::ostream& os, Snapshot const& snapshot)
+{
+  Result distance{mean_dist(snapshot.state)};
+  Result speed{mean_speed(snapshot.state)};
+  os << std::setprecision(3) << std::fixed << std::setw(9) << snapshot.time
+     << std::setprecision(6) << std::setw(11) << snapshot.d_t
+     << std::setprecision(3) << std::setw(9) << distance.mean << std::setw(9)
+     << distance.std_dev << std::setw(9) << speed.mean << std::setw(9)
+     << speed.std_dev << '\n';
 }
 
 // writes data obtained from the analysis to file indicated by user
-void write_data(std::vector<std::vector<Boid>> const& states)
+void write_data(Snapshot_store const& states)
 {
   std::cout << "\nPlease write name of file data will be saved in, then "
                "press ENTER to continue. (.txt "
@@ -101,14 +395,41 @@ void write_data(std::vector<std::vector<Boid>> const& states)
                                  + ".txt\n"};
   }
   std::ostringstream data;
-  for (auto const& state : states) {
-    Result distance{mean_dist(state)};
-    Result speed{mean_speed(state)};
-    data << std::setprecision(3) << std::fixed << std::setw(9) << distance.mean
-         << std::setw(9) << distance.std_dev << std::setw(9) << speed.mean
-         << std::setw(9) << speed.std_dev << std::endl;
+  for (auto const& snapshot : states) {
+    print_data(data, snapshot);
   }
   os << data.str();
   std::cout << "SUCCESS! Data have been saved to file: " + filename
                    + ".txt in current directory\n";
 }
+
+void write_rdf(std::ostream& os, Snapshot_store const& states,
+               std::vector<State_stats> const& stats,
+               Rdf_binning const& binning)
+{
+  assert(stats.size() == states.size());
+  write_rdf_bins(os, binning);
+  auto result{stats.begin()};
+  for (auto const& snapshot : states) {
+    write_rdf_line(os, snapshot.time, *(result++));
+  }
+}
+
+void write_rdf_bins(std::ostream& os, Rdf_binning const& binning)
+{
+  double const bin_width{binning.cutoff / binning.n_bins};
+  os << std::setprecision(3) << std::fixed << "#   r:   ";
+  for (int k{0}; k != binning.n_bins; ++k) {
+    os << std::setw(9) << (k + .5) * bin_width;
+  }
+  os << '\n';
+}
+
+void write_rdf_line(std::ostream& os, double time, State_stats const& stats)
+{
+  os << std::setprecision(3) << std::fixed << std::setw(9) << time;
+  for (double g : stats.rdf) {
+    os << std::setw(9) << g;
+  }
+  os << '\n';
+}
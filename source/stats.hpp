@@ -1,21 +1,126 @@
 #ifndef STATS_HPP
 #define STATS_HPP
 #include "flock.hpp"
+#include "output.hpp"
+#include <atomic>
+#include <exception>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <utility>
 
-struct Result
+Result mean_dist(std::vector<Boid> const& state);
+
+Result mean_speed(std::vector<Boid> const& state);
+
+// disjoint sets of elements 0 ... n-1, which can be united concurrently by
+// several threads without locks
+class Union_find
 {
-  double mean;
-  double std_dev;
+  std::vector<std::atomic<int>> parent_;
+
+ public:
+  explicit Union_find(int n);
+  int find(int i);
+  void unite(int i, int j);
 };
 
-Result mean_dist(std::vector<Boid> const& state);
+std::vector<int> clusters(std::vector<Boid> const& state, double d);
+std::vector<int> clusters(std::vector<Boid> const& state, double d,
+                          Parameters const& pars);
 
-Result mean_speed(std::vector<Boid> const& state);
+// bins of the radial distribution function: n_bins of equal width, covering
+// pair distances up to cutoff, in a space of the area given
+struct Rdf_binning
+{
+  double cutoff{0.};
+  int n_bins{0}; // none is computed if 0
+  double area{0.};
+};
+
+// radial distribution function g(r) of the regular boids in state: the pairs
+// in each bin divided by the pairs expected there if the boids were spread
+// uniformly over the area (the borders' effect, which lowers g at distances
+// comparable with the space's side, is not corrected). Pairs are found
+// through a grid with cells of side cutoff
+std::vector<double> rdf(std::vector<Boid> const& state,
+                        Rdf_binning const& binning);
+
+// statistics of a state printed by print_state and print_clusters, and its
+// radial distribution function (if any)
+struct State_stats
+{
+  Result distance;
+  Result speed;
+  std::vector<int> clusters; // sizes, as returned by clusters
+  std::vector<double> rdf{};
+};
+
+State_stats state_stats(std::vector<Boid> const& state, double d,
+                        Rdf_binning const& binning = {});
+
+// called with the time of a state and its statistics
+using Stats_callback = std::function<void(double, State_stats const&)>;
+
+// computes the statistics of the snapshots pushed on worker threads of its
+// own, while the simulation goes on: push only blocks while capacity states
+// are waiting. Results are kept in the order snapshots were pushed, and each
+// one is passed to on_result (if any) as soon as it and the earlier ones are
+// done: on_result is called by the workers, one call at a time, in that order.
+// Errors met by the workers are thrown by close
+class Stats_pool
+{
+  double d_;
+  Rdf_binning binning_;
+  Stats_callback on_result_;
+  Bounded_queue<std::pair<int, std::vector<Boid>>> queue_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_; // guards the results below and error_
+  std::vector<State_stats> results_;
+  std::vector<double> times_;
+  std::vector<bool> done_;
+  std::size_t passed_{0}; // results passed to on_result_
+  std::exception_ptr error_{};
+  bool closed_{false};
+
+  void work();
+
+ public:
+  static constexpr std::size_t default_capacity{64};
+
+  explicit Stats_pool(double d, int n_workers, Rdf_binning const& binning = {},
+                      Stats_callback on_result = {},
+                      std::size_t capacity     = default_capacity);
+  ~Stats_pool();
+  Stats_pool(Stats_pool const&)            = delete;
+  Stats_pool& operator=(Stats_pool const&) = delete;
+
+  void push(Snapshot const& snapshot);
+  // waits for the statistics of every state pushed, and returns them
+  std::vector<State_stats> const& close();
+};
 
 void print_state(std::vector<Boid> const& state);
+void print_state(State_stats const& stats);
+
+void print_clusters(std::vector<Boid> const& state, double d);
+void print_clusters(State_stats const& stats);
+
+void print_observations(Snapshot const& snapshot);
+
+void print_data(std::ostream& os, Snapshot const& snapshot);
+
+void write_data(Snapshot_store const& states);
 
-void write_data(std::vector<std::vector<Boid>> const& states);
+// writes to os the radial distribution function of every state, a line each
+// (the state's time, then g in each bin), after a line of the bins' centers
+void write_rdf(std::ostream& os, Snapshot_store const& states,
+               std::vector<State_stats> const& stats,
+               Rdf_binning const& binning);
+// the line of the bins' centers, and the line of a state
+void write_rdf_bins(std::ostream& os, Rdf_binning const& binning);
+void write_rdf_line(std::ostream& os, double time, State_stats const& stats);
 
 #endif
\ No newline at end of file
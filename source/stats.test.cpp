@@ -1,6 +1,10 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "stats.hpp"
 #include "doctest.h"
+#include <atomic>
+#include <random>
+#include <sstream>
+#include <thread>
 
 double sum_distances(Boid const& boid, std::vector<Boid> const& state, int N);
 double sum_sq_distances(Boid const& boid, std::vector<Boid> const& state,
@@ -117,3 +121,207 @@ TEST_CASE("testing mean distance")
     CHECK(mean_speed(state8).std_dev == doctest::Approx(2.995722));
   }
 }
+
+TEST_CASE("testing clusters")
+{
+  SUBCASE("testing Union_find")
+  {
+    Union_find sets{6};
+    CHECK(sets.find(3) == 3);
+    sets.unite(0, 1);
+    sets.unite(4, 3);
+    sets.unite(1, 4);
+    CHECK(sets.find(3) == sets.find(0));
+    CHECK(sets.find(2) == 2);
+    CHECK(sets.find(5) != sets.find(0));
+    sets.unite(3, 0); // already united
+    CHECK(sets.find(4) == sets.find(1));
+  }
+
+  SUBCASE("chains and isolated boids")
+  {
+    // a chain of 4 boids (each closer than d = 2. to the next one), a pair and
+    // an isolated boid; the predator doesn't link anybody
+    std::vector<Boid> state{
+        Boid{{0., 0.}, {1., 0.}},      Boid{{1.5, 0.}, {1., 0.}},
+        Boid{{3., 0.}, {1., 0.}},      Boid{{4.5, 1.}, {1., 0.}},
+        Boid{{20., 20.}, {1., 0.}},    Boid{{21., 21.}, {1., 0.}},
+        Boid{{40., 0.}, {1., 0.}},     Boid{{20., 40.}, {1., 0.}},
+        Boid{{21., 40.}, {1., 0.}, true}};
+    CHECK(clusters(state, 2.) == std::vector<int>{4, 2, 1, 1});
+    Parameters pars{90.,     5.,  2., 1., 1., 1., 100,
+                    .000005, 10., 10, 2,  10, 2000};
+    pars.set_threads() = 3;
+    CHECK(clusters(state, 2., pars) == std::vector<int>{4, 2, 1, 1});
+    CHECK(clusters(state, 100.) == std::vector<int>{8});
+    CHECK(clusters(state, .5) == std::vector<int>{1, 1, 1, 1, 1, 1, 1, 1});
+  }
+
+  SUBCASE("same result with any number of threads, as by brute force")
+  {
+    Parameters const pars{90.,     5.,  2., 1., 1., 1., 100,
+                          .000005, 10., 10, 2,  10, 2000};
+    std::vector<Boid> state{};
+    fill(state, pars, 11);
+    double const d{2.};
+    // brute force: grows each cluster from a seed boid
+    std::vector<int> expected{};
+    std::vector<bool> visited(state.size(), false);
+    for (int s{0}, N{static_cast<int>(state.size())}; s != N; ++s) {
+      if (visited[s]) {
+        continue;
+      }
+      std::vector<int> queue{s};
+      visited[s] = true;
+      for (int k{0}; k != static_cast<int>(queue.size()); ++k) {
+        for (int j{0}; j != N; ++j) {
+          if (!visited[j] && distance(state[queue[k]], state[j]) < d) {
+            visited[j] = true;
+            queue.push_back(j);
+          }
+        }
+      }
+      expected.push_back(queue.size());
+    }
+    std::sort(expected.begin(), expected.end(), std::greater<>{});
+    CHECK(clusters(state, d) == expected);
+    for (int threads : {1, 4, 16}) {
+      for (bool work_stealing : {false, true}) {
+        Parameters threaded{pars};
+        threaded.set_threads() = threads;
+        threaded.set_work_stealing() = work_stealing;
+        CHECK(clusters(state, d, threaded) == expected);
+      }
+    }
+  }
+}
+
+TEST_CASE("testing Stats_pool")
+{
+  Parameters const pars{300.,    3.,  1.,   2., .5,   1., 100.,
+                        .000005, 30., 3000, 60, 3000, 150};
+  std::vector<std::vector<Boid>> states{};
+  for (unsigned int seed{0}; seed != 12; ++seed) {
+    std::vector<Boid> boids{};
+    states.push_back(fill(boids, pars, seed));
+  }
+
+  // results are those computed serially, in the order states were pushed,
+  // however many workers compute them, and are passed on in that order
+  for (int n_workers : {1, 3}) {
+    std::vector<double> times{};
+    std::vector<double> distances{};
+    Stats_pool pool{10., n_workers, {},
+                    [&](double time, State_stats const& stats) {
+                      times.push_back(time);
+                      distances.push_back(stats.distance.mean);
+                    },
+                    2};
+    for (std::size_t i{0}; i != states.size(); ++i) {
+      pool.push(Snapshot{.5 * i, .1, states[i]});
+    }
+    auto const& results{pool.close()};
+    REQUIRE(results.size() == states.size());
+    REQUIRE(times.size() == states.size());
+    for (std::size_t i{0}; i != states.size(); ++i) {
+      State_stats const expected{state_stats(states[i], 10.)};
+      CHECK(results[i].distance.mean == expected.distance.mean);
+      CHECK(results[i].distance.std_dev == expected.distance.std_dev);
+      CHECK(results[i].speed.mean == expected.speed.mean);
+      CHECK(results[i].clusters == expected.clusters);
+      CHECK(results[i].rdf.empty());
+      CHECK(times[i] == .5 * i);
+      CHECK(distances[i] == expected.distance.mean);
+    }
+  }
+
+  // results are passed on while states are still being pushed
+  {
+    std::atomic<int> passed{0};
+    Stats_pool pool{10., 1, {},
+                    [&](double, State_stats const&) { ++passed; }};
+    pool.push(Snapshot{0., .1, states[0]});
+    while (passed == 0) {
+      std::this_thread::yield();
+    }
+    pool.push(Snapshot{1., .1, states[1]});
+    pool.close();
+    CHECK(passed == 2);
+  }
+
+  Stats_pool with_rdf{10., 2, {5., 10, 1e4}};
+  with_rdf.push(Snapshot{0., .1, states[0]});
+  CHECK(with_rdf.close()[0].rdf == rdf(states[0], {5., 10, 1e4}));
+
+  Stats_pool idle{10., 2};
+  CHECK(idle.close().empty());
+}
+
+TEST_CASE("testing rdf")
+{
+  std::default_random_engine eng{11};
+  std::uniform_real_distribution<double> coordinate{0., 100.};
+  std::vector<Boid> state{};
+  for (int i{0}; i != 3000; ++i) {
+    Position const p{coordinate(eng), coordinate(eng)};
+    // predators are left out
+    state.push_back((i % 100 == 0) ? Boid{p, {1., 0.}, true}
+                                   : Boid{p, {1., 0.}});
+  }
+  Rdf_binning const binning{6., 12, 100. * 100.};
+  auto const g{rdf(state, binning)};
+  REQUIRE(g.size() == 12u);
+
+  // same pairs as those counted over all pairs
+  std::vector<double> counts(12, 0.);
+  int n{0};
+  for (std::size_t i{0}; i != state.size(); ++i) {
+    if (state[i].is_pred()) {
+      continue;
+    }
+    ++n;
+    for (std::size_t j{i + 1}; j != state.size(); ++j) {
+      double const r{distance(state[i], state[j])};
+      if (!state[j].is_pred() && r < 6.) {
+        counts[static_cast<int>(r / .5)] += 1.;
+      }
+    }
+  }
+  CHECK(n == 2970);
+  for (int k{0}; k != 12; ++k) {
+    double const expected{n * (n - 1) / 2. * pi * .25 * (2. * k + 1.) / 1e4};
+    CHECK(g[k] == doctest::Approx(counts[k] / expected));
+    // uniformly spread boids: g is about 1 (a little less, because of the
+    // borders)
+    CHECK(g[k] == doctest::Approx(1.).epsilon(.2));
+  }
+
+  // boids in pairs at distance 1: a peak in the third bin
+  std::vector<Boid> pairs{};
+  for (int i{0}; i != 10; ++i) {
+    pairs.push_back(Boid{{10. * i, 0.}, {1., 0.}});
+    pairs.push_back(Boid{{10. * i, 1.}, {1., 0.}});
+  }
+  auto const peak{rdf(pairs, {2., 4, 100.})};
+  CHECK(peak[0] == 0.);
+  CHECK(peak[2] > 0.);
+  CHECK(peak[3] == 0.);
+  CHECK(rdf(std::vector<Boid>{pairs[0]}, {2., 4, 100.})
+        == std::vector<double>(4, 0.));
+}
+
+TEST_CASE("testing write_rdf")
+{
+  Snapshot_store states{};
+  std::vector<State_stats> stats{};
+  for (int i{0}; i != 2; ++i) {
+    states.push_back(Snapshot{i * 1.5, .1, {}, {}});
+    stats.push_back(State_stats{{}, {}, {}, {.5 * i, 1.}});
+  }
+  std::ostringstream os{};
+  write_rdf(os, states, stats, {2., 2, 100.});
+  CHECK(os.str()
+        == "#   r:       0.500    1.500\n"
+           "    0.000    0.000    1.000\n"
+           "    1.500    0.500    1.000\n");
+}
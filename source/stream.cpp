@@ -0,0 +1,454 @@
+#include "stream.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// defines the frames' encoding and decoding, and the sockets of the streaming
+// server and of its clients
+
+std::int32_t constexpr position_steps{65535};
+std::int32_t constexpr velocity_steps{32767};
+
+std::int32_t quantize(double u, double u_min, double u_max, std::int32_t steps)
+{
+  double const s{(u - u_min) / (u_max - u_min) * steps};
+  return static_cast<std::int32_t>(
+      std::lround(std::clamp(s, 0., static_cast<double>(steps))));
+}
+
+double dequantize(std::int32_t s, double u_min, double u_max,
+                  std::int32_t steps)
+{
+  return u_min + s * (u_max - u_min) / steps;
+}
+
+std::vector<Quantized> quantize(std::vector<Boid> const& state,
+                                Quantization const& q)
+{
+  assert(q.x_max > q.x_min && q.y_max > q.y_min && q.max_speed > 0.);
+  std::vector<Quantized> quantized(state.size());
+  std::transform(state.begin(), state.end(), quantized.begin(),
+                 [&](Boid const& boid) {
+                   // velocities map to [-velocity_steps, velocity_steps]
+                   return Quantized{
+                       boid.id(),
+                       boid.is_pred(),
+                       quantize(boid.position().x(), q.x_min, q.x_max,
+                                position_steps),
+                       quantize(boid.position().y(), q.y_min, q.y_max,
+                                position_steps),
+                       quantize(boid.velocity().x(), -q.max_speed,
+                                q.max_speed, 2 * velocity_steps)
+                           - velocity_steps,
+                       quantize(boid.velocity().y(), -q.max_speed,
+                                q.max_speed, 2 * velocity_steps)
+                           - velocity_steps};
+                 });
+  return quantized;
+}
+
+std::vector<Boid> dequantize(std::vector<Quantized> const& state,
+                             Quantization const& q)
+{
+  std::vector<Boid> boids{};
+  boids.reserve(state.size());
+  for (Quantized const& b : state) {
+    Position const p{dequantize(b.x, q.x_min, q.x_max, position_steps),
+                     dequantize(b.y, q.y_min, q.y_max, position_steps)};
+    Velocity const v{
+        dequantize(b.v_x + velocity_steps, -q.max_speed, q.max_speed,
+                   2 * velocity_steps),
+        dequantize(b.v_y + velocity_steps, -q.max_speed, q.max_speed,
+                   2 * velocity_steps)};
+    boids.push_back((b.is_pred) ? Boid{p, v, true} : Boid{p, v});
+    boids.back().id() = b.id;
+  }
+  return boids;
+}
+
+// writes n as a zig-zag varint: small values, whatever their sign, take few
+// bytes
+void put_varint(std::vector<std::uint8_t>& out, std::int64_t n)
+{
+  auto z{(static_cast<std::uint64_t>(n) << 1)
+         ^ static_cast<std::uint64_t>(n >> 63)};
+  while (z >= 0x80) {
+    out.push_back(static_cast<std::uint8_t>(z | 0x80));
+    z >>= 7;
+  }
+  out.push_back(static_cast<std::uint8_t>(z));
+}
+
+// reads a zig-zag varint, returning false if the message ends first
+bool get_varint(std::uint8_t const*& in, std::uint8_t const* end,
+                std::int64_t& n)
+{
+  std::uint64_t z{0};
+  for (int shift{0}; shift < 64; shift += 7) {
+    if (in == end) {
+      return false;
+    }
+    std::uint8_t const byte{*in++};
+    z |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      n = static_cast<std::int64_t>(z >> 1)
+        ^ -static_cast<std::int64_t>(z & 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+void put_double(std::vector<std::uint8_t>& out, double value)
+{
+  std::uint8_t bytes[sizeof(double)];
+  std::memcpy(bytes, &value, sizeof(double));
+  out.insert(out.end(), bytes, bytes + sizeof(double));
+}
+
+bool get_double(std::uint8_t const*& in, std::uint8_t const* end,
+                double& value)
+{
+  if (end - in < static_cast<std::ptrdiff_t>(sizeof(double))) {
+    return false;
+  }
+  std::memcpy(&value, in, sizeof(double));
+  in += sizeof(double);
+  return true;
+}
+
+std::vector<std::uint8_t> encode_key(std::uint32_t frame, Quantization const& q,
+                                     std::vector<Quantized> const& state)
+{
+  std::vector<std::uint8_t> out{static_cast<std::uint8_t>(Frame_type::key)};
+  put_varint(out, frame);
+  put_varint(out, static_cast<std::int64_t>(state.size()));
+  for (double limit : {q.x_min, q.x_max, q.y_min, q.y_max, q.max_speed}) {
+    put_double(out, limit);
+  }
+  for (Quantized const& b : state) {
+    put_varint(out, b.id);
+    put_varint(out, b.is_pred);
+    put_varint(out, b.x);
+    put_varint(out, b.y);
+    put_varint(out, b.v_x);
+    put_varint(out, b.v_y);
+  }
+  return out;
+}
+
+std::vector<std::uint8_t> encode_delta(std::uint32_t frame,
+                                       std::vector<Quantized> const& previous,
+                                       std::vector<Quantized> const& state)
+{
+  assert(same_ids(previous, state));
+  std::vector<std::uint8_t> out{static_cast<std::uint8_t>(Frame_type::delta)};
+  put_varint(out, frame);
+  put_varint(out, static_cast<std::int64_t>(state.size()));
+  for (std::size_t i{0}; i != state.size(); ++i) {
+    put_varint(out, state[i].x - previous[i].x);
+    put_varint(out, state[i].y - previous[i].y);
+    put_varint(out, state[i].v_x - previous[i].v_x);
+    put_varint(out, state[i].v_y - previous[i].v_y);
+  }
+  return out;
+}
+
+bool same_ids(std::vector<Quantized> const& s1,
+              std::vector<Quantized> const& s2)
+{
+  return std::equal(s1.begin(), s1.end(), s2.begin(), s2.end(),
+                    [](Quantized const& b1, Quantized const& b2) {
+                      return b1.id == b2.id && b1.is_pred == b2.is_pred;
+                    });
+}
+
+bool Frame_decoder::decode(std::uint8_t const* message, std::size_t size)
+{
+  std::uint8_t const* in{message};
+  std::uint8_t const* const end{message + size};
+  if (in == end) {
+    return false;
+  }
+  auto const type{static_cast<Frame_type>(*in++)};
+  std::int64_t frame{};
+  std::int64_t n{};
+  // every boid takes at least a byte
+  if (!get_varint(in, end, frame) || !get_varint(in, end, n) || n < 0
+      || n > end - in) {
+    return false;
+  }
+
+  if (type == Frame_type::key) {
+    Quantization q{};
+    for (double* limit : {&q.x_min, &q.x_max, &q.y_min, &q.y_max,
+                          &q.max_speed}) {
+      if (!get_double(in, end, *limit)) {
+        return false;
+      }
+    }
+    std::vector<Quantized> state(n);
+    for (Quantized& b : state) {
+      std::int64_t values[6]{};
+      for (std::int64_t& value : values) {
+        if (!get_varint(in, end, value)) {
+          return false;
+        }
+      }
+      b = {static_cast<std::int32_t>(values[0]), values[1] != 0,
+           static_cast<std::int32_t>(values[2]),
+           static_cast<std::int32_t>(values[3]),
+           static_cast<std::int32_t>(values[4]),
+           static_cast<std::int32_t>(values[5])};
+    }
+    if (in != end) {
+      return false;
+    }
+    q_       = q;
+    state_   = std::move(state);
+    has_key_ = true;
+  } else if (type == Frame_type::delta) {
+    if (!has_key_ || n != static_cast<std::int64_t>(state_.size())) {
+      return false;
+    }
+    std::vector<Quantized> state{state_};
+    for (Quantized& b : state) {
+      std::int64_t d[4]{};
+      for (std::int64_t& value : d) {
+        if (!get_varint(in, end, value)) {
+          return false;
+        }
+      }
+      b.x += static_cast<std::int32_t>(d[0]);
+      b.y += static_cast<std::int32_t>(d[1]);
+      b.v_x += static_cast<std::int32_t>(d[2]);
+      b.v_y += static_cast<std::int32_t>(d[3]);
+    }
+    if (in != end) {
+      return false;
+    }
+    state_ = std::move(state);
+  } else {
+    return false;
+  }
+  frame_ = static_cast<std::uint32_t>(frame);
+  return true;
+}
+
+// socket address of "unix:<path>" or "tcp:<port>" (loopback interface)
+struct Address
+{
+  sockaddr_storage storage{};
+  socklen_t length{};
+  std::string unix_path{};
+};
+
+Address parse_address(std::string const& address)
+{
+  Address a{};
+  if (address.rfind("unix:", 0) == 0) {
+    sockaddr_un un{};
+    un.sun_family = AF_UNIX;
+    a.unix_path   = address.substr(5);
+    if (a.unix_path.empty() || a.unix_path.size() >= sizeof(un.sun_path)) {
+      throw std::runtime_error{"ERROR: Invalid socket path in " + address};
+    }
+    std::strcpy(un.sun_path, a.unix_path.c_str());
+    std::memcpy(&a.storage, &un, sizeof(un));
+    a.length = sizeof(un);
+  } else if (address.rfind("tcp:", 0) == 0) {
+    int port{};
+    try {
+      port = std::stoi(address.substr(4));
+    } catch (std::exception const&) {
+      port = -1;
+    }
+    if (port <= 0 || port > 65535) {
+      throw std::runtime_error{"ERROR: Invalid port in " + address};
+    }
+    sockaddr_in in{};
+    in.sin_family      = AF_INET;
+    in.sin_port        = htons(static_cast<std::uint16_t>(port));
+    in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    std::memcpy(&a.storage, &in, sizeof(in));
+    a.length = sizeof(in);
+  } else {
+    throw std::runtime_error{"ERROR: Address " + address
+                             + " is neither unix:<path> nor tcp:<port>"};
+  }
+  return a;
+}
+
+std::runtime_error socket_error(std::string const& what)
+{
+  return std::runtime_error{"ERROR: " + what + ": " + std::strerror(errno)};
+}
+
+Stream_server::Stream_server(std::string const& address, Quantization const& q,
+                             double rate)
+    : q_{q}
+    , period_{1. / rate}
+{
+  assert(rate > 0.);
+  Address const a{parse_address(address)};
+  listener_ = socket(a.storage.ss_family, SOCK_STREAM, 0);
+  if (listener_ < 0) {
+    throw socket_error("Cannot create socket");
+  }
+  if (a.storage.ss_family == AF_INET) {
+    int const yes{1};
+    setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  } else {
+    // a socket file left by an earlier run would make bind fail, but any
+    // other file in its place isn't ours to remove
+    struct stat st{};
+    if (lstat(a.unix_path.c_str(), &st) == 0) {
+      if (!S_ISSOCK(st.st_mode)) {
+        close(listener_);
+        errno = EADDRINUSE;
+        throw socket_error("Cannot listen on " + address);
+      }
+      unlink(a.unix_path.c_str());
+    }
+  }
+  if (bind(listener_, reinterpret_cast<sockaddr const*>(&a.storage), a.length)
+          != 0
+      || listen(listener_, 8) != 0
+      || fcntl(listener_, F_SETFL, O_NONBLOCK) != 0) {
+    auto const error{socket_error("Cannot listen on " + address)};
+    close(listener_);
+    throw error;
+  }
+  unix_path_ = a.unix_path;
+}
+
+Stream_server::~Stream_server()
+{
+  for (Client const& client : clients_) {
+    close(client.fd);
+  }
+  close(listener_);
+  if (!unix_path_.empty()) {
+    unlink(unix_path_.c_str());
+  }
+}
+
+void Stream_server::accept_clients()
+{
+  int fd{};
+  while ((fd = accept(listener_, nullptr, nullptr)) >= 0) {
+    if (fcntl(fd, F_SETFL, O_NONBLOCK) != 0) {
+      close(fd);
+      continue;
+    }
+    clients_.push_back({fd, {}, false});
+  }
+}
+
+bool Stream_server::flush(Client& client)
+{
+  std::size_t sent{0};
+  while (sent != client.pending.size()) {
+    ssize_t const n{send(client.fd, client.pending.data() + sent,
+                         client.pending.size() - sent, MSG_NOSIGNAL)};
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    sent += static_cast<std::size_t>(n);
+  }
+  client.pending.erase(client.pending.begin(), client.pending.begin() + sent);
+  return true;
+}
+
+// sends what it can of every client's pending messages, closing and forgetting
+// the clients that disconnected
+void Stream_server::flush_clients()
+{
+  auto kept{clients_.begin()};
+  for (auto it{clients_.begin()}; it != clients_.end(); ++it) {
+    if (!flush(*it)) {
+      close(it->fd);
+    } else {
+      if (kept != it) {
+        *kept = std::move(*it);
+      }
+      ++kept;
+    }
+  }
+  clients_.erase(kept, clients_.end());
+}
+
+bool Stream_server::publish(std::vector<Boid> const& state)
+{
+  auto const now{std::chrono::steady_clock::now()};
+  if (frame_ != 0 && now - last_ < period_) {
+    return false;
+  }
+  last_ = now;
+  accept_clients();
+  flush_clients();
+
+  std::vector<Quantized> const quantized{quantize(state, q_)};
+  bool const delta_allowed{frame_ != 0 && same_ids(previous_, quantized)};
+  // each kind of message is encoded only if some client needs it
+  std::vector<std::uint8_t> key{};
+  std::vector<std::uint8_t> delta{};
+  for (Client& client : clients_) {
+    if (!client.pending.empty()) {
+      // still sending an earlier frame: this one is dropped
+      client.synced = false;
+      ++dropped_;
+      continue;
+    }
+    bool const use_delta{client.synced && delta_allowed};
+    std::vector<std::uint8_t>& message{(use_delta) ? delta : key};
+    if (message.empty()) {
+      message = (use_delta) ? encode_delta(frame_, previous_, quantized)
+                            : encode_key(frame_, q_, quantized);
+    }
+    // messages are preceded by their length (4 bytes, little endian)
+    auto const length{static_cast<std::uint32_t>(message.size())};
+    for (int shift{0}; shift != 32; shift += 8) {
+      client.pending.push_back(static_cast<std::uint8_t>(length >> shift));
+    }
+    client.pending.insert(client.pending.end(), message.begin(), message.end());
+    client.synced = true;
+    ++sent_;
+  }
+  flush_clients();
+  previous_ = quantized;
+  ++frame_;
+  return true;
+}
+
+int connect_to(std::string const& address)
+{
+  Address const a{parse_address(address)};
+  int const fd{socket(a.storage.ss_family, SOCK_STREAM, 0)};
+  if (fd < 0) {
+    throw socket_error("Cannot create socket");
+  }
+  if (connect(fd, reinterpret_cast<sockaddr const*>(&a.storage), a.length)
+      != 0) {
+    auto const error{socket_error("Cannot connect to " + address)};
+    close(fd);
+    throw error;
+  }
+  return fd;
+}
@@ -0,0 +1,128 @@
+#ifndef STREAM_HPP
+#define STREAM_HPP
+#include "boids.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// defines the streaming of flock's frames over a socket: the frames' encoding
+// (quantized, delta-encoded against the previous frame), the server publishing
+// them and the decoder used by clients
+
+// limits mapped to the quantized values' ranges
+struct Quantization
+{
+  double x_min;
+  double x_max;
+  double y_min;
+  double y_max;
+  double max_speed;
+};
+
+// boid with position on 16 bits per coordinate, velocity on 16 signed bits
+struct Quantized
+{
+  std::int32_t id;
+  bool is_pred;
+  std::int32_t x;
+  std::int32_t y;
+  std::int32_t v_x;
+  std::int32_t v_y;
+};
+
+std::vector<Quantized> quantize(std::vector<Boid> const& state,
+                                Quantization const& q);
+std::vector<Boid> dequantize(std::vector<Quantized> const& state,
+                             Quantization const& q);
+
+// a message is a frame's type, number and boids count, then either the
+// quantization and every boid's id, is_pred and values (key frame) or every
+// boid's values' differences from the previous frame (delta frame, which
+// requires the same ids in the same order). Integers are written as
+// zig-zag varints
+enum class Frame_type : std::uint8_t
+{
+  key,
+  delta
+};
+
+std::vector<std::uint8_t> encode_key(std::uint32_t frame, Quantization const& q,
+                                     std::vector<Quantized> const& state);
+std::vector<std::uint8_t> encode_delta(std::uint32_t frame,
+                                       std::vector<Quantized> const& previous,
+                                       std::vector<Quantized> const& state);
+bool same_ids(std::vector<Quantized> const& s1,
+              std::vector<Quantized> const& s2);
+
+// rebuilds frames from messages; a delta frame is only accepted after a key
+// frame
+class Frame_decoder
+{
+  Quantization q_{};
+  std::vector<Quantized> state_{};
+  std::uint32_t frame_{0};
+  bool has_key_{false};
+
+ public:
+  // returns false if message can't be decoded (the state is left unchanged)
+  bool decode(std::uint8_t const* message, std::size_t size);
+  // clang-format off
+  std::uint32_t frame() const{return frame_;}
+  // clang-format on
+  std::vector<Boid> state() const
+  {
+    return dequantize(state_, q_);
+  }
+};
+
+// server streaming frames to every client connected to address ("unix:<path>"
+// or "tcp:<port>", on the loopback interface), at most rate frames per second.
+// Sockets never block: a client still receiving a frame misses the following
+// ones and gets a key frame next
+class Stream_server
+{
+  struct Client
+  {
+    int fd;
+    std::vector<std::uint8_t> pending; // messages not yet sent
+    bool synced;                       // got the previous frame
+  };
+  int listener_{-1};
+  std::string unix_path_{};
+  Quantization q_;
+  std::chrono::duration<double> period_;
+  std::chrono::steady_clock::time_point last_{};
+  std::vector<Client> clients_{};
+  std::vector<Quantized> previous_{};
+  std::uint32_t frame_{0};
+  long sent_{0};
+  long dropped_{0};
+
+  void accept_clients();
+  // false if the client has disconnected
+  bool flush(Client& client);
+  void flush_clients();
+
+ public:
+  explicit Stream_server(std::string const& address, Quantization const& q,
+                         double rate);
+  ~Stream_server();
+  Stream_server(Stream_server const&)            = delete;
+  Stream_server& operator=(Stream_server const&) = delete;
+
+  // sends state to the clients, unless less than a period has gone by since
+  // the last frame; returns true if a frame was sent
+  bool publish(std::vector<Boid> const& state);
+  // clang-format off
+  int clients() const{return static_cast<int>(clients_.size());}
+  long sent() const{return sent_;}
+  long dropped() const{return dropped_;}
+  // clang-format on
+};
+
+// connects to a server's address, returning the socket
+int connect_to(std::string const& address);
+
+#endif
@@ -0,0 +1,174 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "stream.hpp"
+#include "doctest.h"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+TEST_CASE("testing frames' encoding")
+{
+  Quantization const q{0., 100., 0., 50., 80.};
+  std::vector<Boid> state{};
+  for (int i{0}; i != 50; ++i) {
+    state.push_back(Boid{{i * 2., 50. - i}, {i - 25., 80. - i * 3.2}});
+    state.back().id() = i;
+  }
+  state.push_back(Boid{{-3., 70.}, {100., 0.}, true}); // beyond the limits
+  state.back().id() = 50;
+
+  SUBCASE("quantization")
+  {
+    auto const boids{dequantize(quantize(state, q), q)};
+    REQUIRE(boids.size() == state.size());
+    for (int i{0}; i != 50; ++i) {
+      CHECK(boids[i].id() == i);
+      CHECK(!boids[i].is_pred());
+      CHECK(std::abs(boids[i].position().x() - state[i].position().x())
+            < 100. / 65535.);
+      CHECK(std::abs(boids[i].position().y() - state[i].position().y())
+            < 50. / 65535.);
+      CHECK(std::abs(boids[i].velocity().x() - state[i].velocity().x())
+            < 80. / 32767.);
+      CHECK(std::abs(boids[i].velocity().y() - state[i].velocity().y())
+            < 80. / 32767.);
+    }
+    // values beyond the limits are clamped
+    CHECK(boids[50].is_pred());
+    CHECK(boids[50].position() == Position{0., 50.});
+    CHECK(boids[50].velocity() == Velocity{80., 0.});
+  }
+
+  SUBCASE("key and delta frames")
+  {
+    auto const q_0{quantize(state, q)};
+    std::vector<Boid> moved{state};
+    for (Boid& boid : moved) {
+      boid.position() += boid.velocity() * .001;
+    }
+    auto const q_1{quantize(moved, q)};
+    CHECK(same_ids(q_0, q_1));
+    auto const key{encode_key(7, q, q_0)};
+    auto const delta{encode_delta(8, q_0, q_1)};
+    // small motions take much less than absolute values
+    CHECK(delta.size() * 2 < key.size());
+
+    Frame_decoder decoder{};
+    // a delta frame needs a key frame first
+    CHECK_FALSE(decoder.decode(delta.data(), delta.size()));
+    CHECK(decoder.decode(key.data(), key.size()));
+    CHECK(decoder.frame() == 7u);
+    CHECK(quantize(decoder.state(), q)[20].x == q_0[20].x);
+    CHECK(decoder.decode(delta.data(), delta.size()));
+    CHECK(decoder.frame() == 8u);
+    auto const decoded{quantize(decoder.state(), q)};
+    int different{0};
+    for (std::size_t i{0}; i != decoded.size(); ++i) {
+      different += decoded[i].x != q_1[i].x || decoded[i].y != q_1[i].y
+                || decoded[i].v_x != q_1[i].v_x || decoded[i].v_y != q_1[i].v_y
+                || decoded[i].id != q_1[i].id;
+    }
+    CHECK(different == 0);
+    // truncated messages are rejected
+    CHECK_FALSE(decoder.decode(key.data(), key.size() - 1));
+    CHECK_FALSE(decoder.decode(delta.data(), 3));
+    CHECK(decoder.frame() == 8u);
+  }
+}
+
+// reads a message from the server, returning false at end of stream
+bool read_message(int fd, std::vector<std::uint8_t>& message)
+{
+  std::uint8_t header[4];
+  if (recv(fd, header, 4, MSG_WAITALL) != 4) {
+    return false;
+  }
+  std::uint32_t length{0};
+  for (int i{3}; i >= 0; --i) {
+    length = (length << 8) | header[i];
+  }
+  message.resize(length);
+  return recv(fd, message.data(), length, MSG_WAITALL)
+      == static_cast<ssize_t>(length);
+}
+
+TEST_CASE("testing Stream_server")
+{
+  Quantization const q{0., 100., 0., 100., 80.};
+  std::string const address{"unix:stream_test.sock"};
+  std::vector<Boid> state{};
+  for (int i{0}; i != 2000; ++i) {
+    state.push_back(Boid{{i * .05, i * .04}, {10., -10.}});
+    state.back().id() = i;
+  }
+
+  SUBCASE("rate")
+  {
+    Stream_server server{address, q, 1.};
+    CHECK(server.publish(state));
+    // less than a second later
+    CHECK_FALSE(server.publish(state));
+  }
+
+  SUBCASE("clients")
+  {
+    Stream_server server{address, q, 1e9};
+    CHECK(server.publish(state)); // no clients yet
+    int const fd{connect_to(address)};
+    CHECK(server.publish(state));
+    CHECK(server.clients() == 1);
+    for (Boid& boid : state) {
+      boid.position() += Position{.01, 0.};
+    }
+    CHECK(server.publish(state));
+    CHECK(server.sent() == 2);
+
+    std::vector<std::uint8_t> message{};
+    Frame_decoder decoder{};
+    // the first frame a client gets is a key frame, then deltas follow
+    REQUIRE(read_message(fd, message));
+    CHECK(static_cast<Frame_type>(message[0]) == Frame_type::key);
+    CHECK(decoder.decode(message.data(), message.size()));
+    CHECK(decoder.frame() == 1u);
+    REQUIRE(read_message(fd, message));
+    CHECK(static_cast<Frame_type>(message[0]) == Frame_type::delta);
+    CHECK(decoder.decode(message.data(), message.size()));
+    CHECK(decoder.frame() == 2u);
+    CHECK(decoder.state()[100].position().x()
+          == doctest::Approx(state[100].position().x()).epsilon(1e-4));
+
+    // a client that doesn't read has frames dropped instead of blocking
+    for (int i{0}; i != 2000 && server.dropped() == 0; ++i) {
+      server.publish(state);
+    }
+    CHECK(server.dropped() > 0);
+
+    // disconnected clients are forgotten
+    close(fd);
+    server.publish(state);
+    server.publish(state);
+    CHECK(server.clients() == 0);
+  }
+
+  SUBCASE("files other than sockets are left alone")
+  {
+    std::ofstream{"stream_test.sock"} << "not a socket\n";
+    std::string what{};
+    try {
+      Stream_server server{address, q, 1.};
+    } catch (std::runtime_error const& error) {
+      what = error.what();
+    }
+    CHECK(what.find("Address already in use") != std::string::npos);
+    std::ifstream file{"stream_test.sock"};
+    std::string line{};
+    CHECK(std::getline(file, line));
+    CHECK(line == "not a socket");
+    std::remove("stream_test.sock");
+  }
+
+  CHECK_THROWS(Stream_server{"udp:1234", q, 1.});
+  CHECK_THROWS(connect_to(address));
+}
@@ -0,0 +1,208 @@
+#include "tiled.hpp"
+#include "scheduler.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+// defines the tiled all-pairs kernel
+
+Tile_state tile_state(std::vector<Boid> const& state)
+{
+  Tile_state tiles{};
+  for (auto* v : {&tiles.x, &tiles.y, &tiles.v_x, &tiles.v_y}) {
+    v->reserve(state.size());
+  }
+  tiles.is_pred.reserve(state.size());
+  for (Boid const& boid : state) {
+    tiles.x.push_back(boid.position().x());
+    tiles.y.push_back(boid.position().y());
+    tiles.v_x.push_back(boid.velocity().x());
+    tiles.v_y.push_back(boid.velocity().y());
+    tiles.is_pred.push_back(boid.is_pred());
+  }
+  return tiles;
+}
+
+// a block of regular target boids and their sums over the sources swept so
+// far: separation from regular boids and from predators, differences of
+// positions and velocities of the n neighbours (boid itself included). Kept as
+// arrays, so that a source is added to every target of the block in a loop the
+// compiler can vectorize
+struct Target_block
+{
+  int size{0};
+  std::array<double, tile_targets> x{};
+  std::array<double, tile_targets> y{};
+  std::array<double, tile_targets> v_x{};
+  std::array<double, tile_targets> v_y{};
+  std::array<double, tile_targets> speed{};
+  std::array<double, tile_targets> sep_x{};
+  std::array<double, tile_targets> sep_y{};
+  std::array<double, tile_targets> sep_pred_x{};
+  std::array<double, tile_targets> sep_pred_y{};
+  std::array<double, tile_targets> d_p_x{};
+  std::array<double, tile_targets> d_p_y{};
+  std::array<double, tile_targets> d_v_x{};
+  std::array<double, tile_targets> d_v_y{};
+  std::array<int, tile_targets> n{};
+};
+
+// adds sources j0 ... j1 - 1 to the sums of the block's targets. Every target
+// meets the sources in the order of the state, and a source out of its reach
+// adds zeros: sums are the same as those of a loop skipping it
+void add_tile(Tile_state const& sources, int j0, int j1, double cos_view,
+              Parameters const& pars, Target_block& block)
+{
+  double const d{pars.get_d()};
+  double const d_s{pars.get_d_s()};
+  double const d_s_pred{pars.get_d_s_pred()};
+  double const s{-pars.get_s()};
+  double const s_pred{-pars.get_s_pred()};
+  for (int j{j0}; j != j1; ++j) {
+    double const x_j{sources.x[j]};
+    double const y_j{sources.y[j]};
+    double const v_x_j{sources.v_x[j]};
+    double const v_y_j{sources.v_y[j]};
+    bool const pred_j{sources.is_pred[j] != 0};
+    for (int t{0}; t != block.size; ++t) {
+      double const dx{x_j - block.x[t]};
+      double const dy{y_j - block.y[t]};
+      double const dist{std::sqrt(dx * dx + dy * dy)};
+      // same as is_seen: boids in the same place always see each other
+      bool const seen{(dx == 0. && dy == 0.)
+                      || (dx * block.v_x[t] + dy * block.v_y[t])
+                                 / (block.speed[t] * dist)
+                             >= cos_view};
+      bool const nbr{seen && !pred_j && dist < d};
+      bool const close{nbr && dist < d_s};
+      bool const threat{seen && pred_j && dist < d_s_pred};
+      block.n[t] += nbr;
+      block.d_p_x[t] += (nbr) ? dx : 0.;
+      block.d_p_y[t] += (nbr) ? dy : 0.;
+      block.d_v_x[t] += (nbr) ? v_x_j - block.v_x[t] : 0.;
+      block.d_v_y[t] += (nbr) ? v_y_j - block.v_y[t] : 0.;
+      block.sep_x[t] += (close) ? dx * s : 0.;
+      block.sep_y[t] += (close) ? dy * s : 0.;
+      block.sep_pred_x[t] += (threat) ? dx * s_pred : 0.;
+      block.sep_pred_y[t] += (threat) ? dy * s_pred : 0.;
+    }
+  }
+}
+
+// velocity change of the block's target t, from its sums over the whole flock
+Velocity regular_d_v(Target_block const& block, int t, Parameters const& pars)
+{
+  Velocity d_v{block.sep_x[t] + block.sep_pred_x[t],
+               block.sep_y[t] + block.sep_pred_y[t]};
+  int const n{block.n[t]};
+  if (n > 1) { // boid itself is always among the n neighbours
+    d_v += Velocity{block.d_v_x[t], block.d_v_y[t]} * (pars.get_a() / (n - 1));
+    d_v += Velocity{block.d_p_x[t], block.d_p_y[t]} * (pars.get_c() / (n - 1));
+  }
+  return d_v;
+}
+
+// velocity change of predator i: separation from competitors and seek, the
+// sources being swept tile by tile as well
+Velocity predator_d_v(std::vector<Boid> const& state,
+                      Tile_state const& sources, int i, double cos_view,
+                      Parameters const& pars)
+{
+  int const N{static_cast<int>(state.size())};
+  Boid const& boid{state[i]};
+  double const x{sources.x[i]};
+  double const y{sources.y[i]};
+  double const speed{norm(boid.velocity())};
+  Position sep{0., 0.};
+  int prey{-1};
+  double prey_dist{0.};
+  for (int j0{0}; j0 < N; j0 += tile_sources) {
+    for (int j{j0}, j1{std::min(j0 + tile_sources, N)}; j != j1; ++j) {
+      double const dx{sources.x[j] - x};
+      double const dy{sources.y[j] - y};
+      double const dist{std::sqrt(dx * dx + dy * dy)};
+      if (!((dx == 0. && dy == 0.)
+            || (dx * sources.v_x[i] + dy * sources.v_y[i]) / (speed * dist)
+                   >= cos_view)) {
+        continue;
+      }
+      if (sources.is_pred[j]) {
+        if (dist < pars.get_d_s()) {
+          sep += Position{dx, dy} * (-pars.get_s());
+        }
+      } else if (prey < 0 || dist < prey_dist) {
+        // the first of the nearest preys, as find_prey's
+        prey      = j;
+        prey_dist = dist;
+      }
+    }
+  }
+  Velocity d_v{sep.x(), sep.y()};
+  // same as seek: no drive if no prey is in sight or if it's in a corner
+  if (prey < 0 || in_corner(state[prey], pars.get_x_max(), pars.get_y_max())) {
+    return d_v;
+  }
+  auto const pos_diff{state[prey].position() - boid.position()};
+  Velocity vel{pos_diff.x() + state[prey].velocity().x(),
+               pos_diff.y() + state[prey].velocity().y()};
+  if (norm(vel)) {
+    vel = (vel / norm(vel))
+        * (norm(pos_diff) * (norm(boid.velocity()) / pars.get_max_speed()));
+  }
+  return d_v + vel;
+}
+
+void tiled_delta_vs(std::vector<Boid> const& state,
+                    std::vector<bool> const& active, Obstacles const& obstacles,
+                    Parameters const& pars, std::vector<Velocity>& d_vs)
+{
+  assert(state.size() == active.size());
+  assert(state.size() == d_vs.size());
+  int const N{static_cast<int>(state.size())};
+  Tile_state const sources{tile_state(state)};
+  double const cos_view{std::cos(pi * pars.get_angle() / 360.)};
+  std::vector<int> regulars{};
+  std::vector<int> preds{};
+  for (int i{0}; i != N; ++i) {
+    if (active[i]) {
+      (state[i].is_pred() ? preds : regulars).push_back(i);
+    }
+  }
+
+  // a thread takes a block of targets at a time, which sweeps the flock tile
+  // by tile
+  parallel_for(
+      static_cast<int>(regulars.size()), tile_targets, pars.get_threads(),
+      (pars.get_work_stealing()) ? Partition::work_stealing
+                                 : Partition::static_chunks,
+      [&](int begin, int end) {
+        Target_block block{};
+        block.size = end - begin;
+        for (int t{0}; t != block.size; ++t) {
+          int const i{regulars[begin + t]};
+          block.x[t]     = sources.x[i];
+          block.y[t]     = sources.y[i];
+          block.v_x[t]   = sources.v_x[i];
+          block.v_y[t]   = sources.v_y[i];
+          block.speed[t] = norm(state[i].velocity());
+        }
+        for (int j0{0}; j0 < N; j0 += tile_sources) {
+          add_tile(sources, j0, std::min(j0 + tile_sources, N), cos_view,
+                   pars, block);
+        }
+        for (int t{0}; t != block.size; ++t) {
+          d_vs[regulars[begin + t]] = regular_d_v(block, t, pars);
+        }
+      });
+  for (int i : preds) {
+    d_vs[i] = predator_d_v(state, sources, i, cos_view, pars);
+  }
+
+  if (!obstacles.empty()) {
+    for (int i{0}; i != N; ++i) {
+      if (active[i]) {
+        d_vs[i] += avoidance(state[i], obstacles, pars);
+      }
+    }
+  }
+}
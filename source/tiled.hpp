@@ -0,0 +1,37 @@
+#ifndef TILED_HPP
+#define TILED_HPP
+#include "flock.hpp"
+#include <vector>
+
+// defines the tiled all-pairs kernel: the boids' positions and velocities are
+// copied to arrays of their own (structure of arrays), then blocks of target
+// boids sweep tiles of source boids small enough to stay in the L1 cache, every
+// rule (separation, alignment, cohesion, separation from predators and
+// competitors, the search of the prey) being accumulated in the same pass.
+// Velocity changes are those of the flying rules up to rounding (sums are
+// taken in a different order), as with the specialized kernels
+
+// source boids of a tile, and target boids of a block (the chunks threads are
+// handed)
+int constexpr tile_sources{256};
+int constexpr tile_targets{32};
+
+// the boids' state as a structure of arrays
+struct Tile_state
+{
+  std::vector<double> x;
+  std::vector<double> y;
+  std::vector<double> v_x;
+  std::vector<double> v_y;
+  std::vector<char> is_pred;
+};
+
+Tile_state tile_state(std::vector<Boid> const& state);
+
+// sets d_vs[i] to the velocity change of every active boid i of state
+// (obstacles included), with pars' threads
+void tiled_delta_vs(std::vector<Boid> const& state,
+                    std::vector<bool> const& active, Obstacles const& obstacles,
+                    Parameters const& pars, std::vector<Velocity>& d_vs);
+
+#endif
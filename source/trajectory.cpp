@@ -0,0 +1,124 @@
+#include "trajectory.hpp"
+#include "bytes.hpp"
+#include "output.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// defines the indexing and decoding of trajectory files' frames, and the
+// controls of their playback
+
+Trajectory::Trajectory(std::string const& filename)
+{
+  int const fd{open(filename.c_str(), O_RDONLY)};
+  if (fd < 0) {
+    throw std::runtime_error{"ERROR: Cannot open file " + filename + ": "
+                             + std::strerror(errno)};
+  }
+  struct stat st{};
+  if (fstat(fd, &st) != 0
+      || st.st_size < static_cast<off_t>(trajectory_header_bytes)) {
+    close(fd);
+    throw std::runtime_error{"ERROR: " + filename + " is not a trajectory"};
+  }
+  void* const data{mmap(nullptr, static_cast<std::size_t>(st.st_size),
+                        PROT_READ, MAP_PRIVATE, fd, 0)};
+  close(fd);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error{"ERROR: Cannot map file " + filename + ": "
+                             + std::strerror(errno)};
+  }
+  data_ = data;
+  size_ = static_cast<std::size_t>(st.st_size);
+  char const* const bytes{static_cast<char const*>(data_)};
+  if (std::memcmp(bytes, trajectory_magic, trajectory_header_bytes) != 0) {
+    munmap(data_, size_);
+    throw std::runtime_error{"ERROR: " + filename + " is not a trajectory"};
+  }
+  // frames are read sequentially once: only their headers are touched
+  madvise(data_, size_, MADV_SEQUENTIAL);
+  std::size_t offset{trajectory_header_bytes};
+  while (offset + frame_header_bytes <= size_) {
+    auto const n{get<std::int32_t>(bytes + offset + sizeof(double))};
+    std::size_t const end{offset + frame_header_bytes
+                          + static_cast<std::size_t>(n) * boid_record_bytes};
+    if (n < 0 || end > size_) {
+      break;
+    }
+    offsets_.push_back(offset);
+    times_.push_back(get<double>(bytes + offset));
+    offset = end;
+  }
+  madvise(data_, size_, MADV_RANDOM);
+}
+
+Trajectory::~Trajectory()
+{
+  munmap(data_, size_);
+}
+
+int Trajectory::n_boids(int frame) const
+{
+  assert(frame >= 0 && frame < size());
+  return get<std::int32_t>(static_cast<char const*>(data_) + offsets_[frame]
+                           + sizeof(double));
+}
+
+int Trajectory::frame_at(double time) const
+{
+  assert(!empty());
+  auto const after{std::upper_bound(times_.begin(), times_.end(), time)};
+  return static_cast<int>(
+      std::max(after - times_.begin() - 1, std::ptrdiff_t{0}));
+}
+
+std::vector<Boid>& Trajectory::read(int frame, std::vector<Boid>& state) const
+{
+  int const n{n_boids(frame)};
+  char const* in{static_cast<char const*>(data_) + offsets_[frame]
+                 + frame_header_bytes};
+  state.clear();
+  state.reserve(n);
+  for (int i{0}; i != n; ++i, in += boid_record_bytes) {
+    Position const p{get<double>(in), get<double>(in + sizeof(double))};
+    Velocity const v{get<double>(in + 2 * sizeof(double)),
+                     get<double>(in + 3 * sizeof(double))};
+    bool const is_pred{get<std::int32_t>(in + 4 * sizeof(double) + 4) != 0};
+    state.push_back((is_pred) ? Boid{p, v, true} : Boid{p, v});
+    state.back().id() = get<std::int32_t>(in + 4 * sizeof(double));
+  }
+  return state;
+}
+
+void Playback::advance(double real_d_t)
+{
+  assert(real_d_t >= 0.);
+  if (playing_) {
+    time_    = std::min(time_ + real_d_t * speed_, last_);
+    playing_ = time_ < last_;
+  }
+}
+
+void Playback::seek(double d_t)
+{
+  time_ = std::clamp(time_ + d_t, first_, last_);
+}
+
+// speeds range from 1/64 to 64 times the real one
+double constexpr max_speed_factor{64.};
+
+void Playback::faster()
+{
+  speed_ = std::min(speed_ * 2., max_speed_factor);
+}
+
+void Playback::slower()
+{
+  speed_ = std::max(speed_ / 2., 1. / max_speed_factor);
+}
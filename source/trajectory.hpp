@@ -0,0 +1,86 @@
+#ifndef TRAJECTORY_HPP
+#define TRAJECTORY_HPP
+#include "boids.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// defines the reading of trajectory files (see output.hpp) mapped in memory,
+// and the playback of their frames
+
+// a trajectory file mapped read-only: frames are only indexed when opening it,
+// boids are decoded from the mapping when a frame is read. A frame cut short
+// at the end of the file (e.g. one still being written) is ignored
+class Trajectory
+{
+  void* data_{nullptr};
+  std::size_t size_{0};
+  std::vector<std::size_t> offsets_; // of each frame, from the file's start
+  std::vector<double> times_;
+
+ public:
+  explicit Trajectory(std::string const& filename);
+  ~Trajectory();
+  Trajectory(Trajectory const&)            = delete;
+  Trajectory& operator=(Trajectory const&) = delete;
+
+  int size() const
+  {
+    return static_cast<int>(times_.size());
+  }
+  bool empty() const
+  {
+    return times_.empty();
+  }
+  double time(int frame) const
+  {
+    assert(frame >= 0 && frame < size());
+    return times_[frame];
+  }
+  int n_boids(int frame) const;
+  // last frame whose time is not later than time (the first one if all are)
+  int frame_at(double time) const;
+  // fills state with the boids of frame
+  std::vector<Boid>& read(int frame, std::vector<Boid>& state) const;
+};
+
+// time of a replay, advancing with real time multiplied by speed while playing
+// and kept between the times of the first and the last frame
+class Playback
+{
+  double first_;
+  double last_;
+  double time_;
+  double speed_{1.};
+  bool playing_{true};
+
+ public:
+  explicit Playback(double first, double last)
+      : first_{first}
+      , last_{last}
+      , time_{first}
+  {
+    assert(last_ >= first_);
+  }
+  // clang-format off
+  double time() const{return time_;}
+  double speed() const{return speed_;}
+  bool playing() const{return playing_;}
+  // clang-format on
+  // advances by real_d_t seconds of real time; pauses at the end
+  void advance(double real_d_t);
+  void toggle()
+  {
+    // playing again from the end starts over
+    if (!playing_ && time_ == last_) {
+      time_ = first_;
+    }
+    playing_ = !playing_;
+  }
+  // moves forward (or backward, if d_t is negative) by d_t
+  void seek(double d_t);
+  void faster();
+  void slower();
+};
+
+#endif
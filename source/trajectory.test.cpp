@@ -0,0 +1,112 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "trajectory.hpp"
+#include "doctest.h"
+#include "output.hpp"
+#include <cstdio>
+#include <fstream>
+
+TEST_CASE("testing Trajectory")
+{
+  std::string const filename{"trajectory_test"};
+  {
+    Async_writer writer{filename};
+    for (int i{0}; i != 10; ++i) {
+      Snapshot snapshot{i * .25, .25, {}, {}};
+      for (int j{0}; j != 3 + i; ++j) {
+        Position const p{1. * i, 2. * j};
+        Velocity const v{3., -4. * j};
+        snapshot.state.push_back((j == 1) ? Boid{p, v, true} : Boid{p, v});
+        snapshot.state.back().id() = 10 * j;
+      }
+      writer.push(snapshot);
+    }
+    writer.close();
+  }
+
+  SUBCASE("frames")
+  {
+    Trajectory const trajectory{filename + ".trj"};
+    REQUIRE(trajectory.size() == 10);
+    CHECK(trajectory.time(4) == 1.);
+    CHECK(trajectory.n_boids(4) == 7);
+    std::vector<Boid> state{};
+    trajectory.read(4, state);
+    REQUIRE(state.size() == 7u);
+    CHECK(state[5].position() == Position{4., 10.});
+    CHECK(state[5].velocity() == Velocity{3., -20.});
+    CHECK(state[5].id() == 50);
+    CHECK(state[1].is_pred());
+    CHECK(!state[2].is_pred());
+    // state is refilled from scratch
+    trajectory.read(0, state);
+    CHECK(state.size() == 3u);
+
+    CHECK(trajectory.frame_at(-1.) == 0);
+    CHECK(trajectory.frame_at(0.) == 0);
+    CHECK(trajectory.frame_at(1.1) == 4);
+    CHECK(trajectory.frame_at(1.25) == 5);
+    CHECK(trajectory.frame_at(100.) == 9);
+  }
+
+  SUBCASE("a frame cut short is ignored")
+  {
+    std::ifstream in{filename + ".trj", std::ios::binary};
+    std::string bytes{std::istreambuf_iterator<char>{in},
+                      std::istreambuf_iterator<char>{}};
+    in.close();
+    {
+      std::ofstream out{filename + ".trj", std::ios::binary};
+      out.write(bytes.data(),
+                static_cast<std::streamsize>(bytes.size() - 10));
+    }
+    Trajectory const trajectory{filename + ".trj"};
+    CHECK(trajectory.size() == 9);
+  }
+
+  SUBCASE("invalid files")
+  {
+    CHECK_THROWS(Trajectory{"no_such_file.trj"});
+    // the data file is not a trajectory
+    CHECK_THROWS(Trajectory{filename + ".txt"});
+  }
+  std::remove((filename + ".txt").c_str());
+  std::remove((filename + ".trj").c_str());
+}
+
+TEST_CASE("testing Playback")
+{
+  Playback playback{2., 10.};
+  CHECK(playback.time() == 2.);
+  CHECK(playback.playing());
+
+  playback.advance(1.5);
+  CHECK(playback.time() == 3.5);
+  playback.faster();
+  playback.advance(1.);
+  CHECK(playback.time() == 5.5);
+  playback.slower();
+  playback.slower();
+  CHECK(playback.speed() == .5);
+
+  playback.toggle();
+  playback.advance(1.);
+  CHECK(playback.time() == 5.5);
+  playback.seek(-10.);
+  CHECK(playback.time() == 2.);
+  playback.seek(3.);
+  CHECK(playback.time() == 5.);
+
+  // playback pauses at the end, and starts over from there
+  playback.toggle();
+  playback.advance(100.);
+  CHECK(playback.time() == 10.);
+  CHECK_FALSE(playback.playing());
+  playback.toggle();
+  CHECK(playback.time() == 2.);
+  CHECK(playback.playing());
+
+  for (int i{0}; i != 20; ++i) {
+    playback.faster();
+  }
+  CHECK(playback.speed() == 64.);
+}
@@ -0,0 +1,72 @@
+#include "verify.hpp"
+#include <algorithm>
+
+// defines the side by side evolution of the flock and of its reference
+
+// largest deviations of the evolved boids from the expected ones, expected[k]
+// being compared with the boid of id ids[k]; worst and worst_id are set to the
+// largest deviation of a boid and to its id (-1 if no boid deviated)
+Deviation deviation(Flock const& evolved, std::vector<Boid> const& expected,
+                    std::vector<int> const& ids, double& worst, int& worst_id)
+{
+  assert(expected.size() == ids.size());
+  Deviation max{0., 0.};
+  worst    = 0.;
+  worst_id = -1;
+  for (std::size_t k{0}; k != expected.size(); ++k) {
+    // evolve may have reordered its boids
+    int const i{evolved.index_of(ids[k])};
+    assert(i >= 0);
+    Boid const& boid{evolved.state()[i]};
+    double const d_p{norm(boid.position() - expected[k].position())};
+    double const d_v{norm(boid.velocity() - expected[k].velocity())};
+    max.position = std::max(max.position, d_p);
+    max.velocity = std::max(max.velocity, d_v);
+    if (std::max(d_p, d_v) > worst) {
+      worst    = std::max(d_p, d_v);
+      worst_id = ids[k];
+    }
+  }
+  return max;
+}
+
+Verification verify(Flock const& flock, Parameters const& pars, int steps,
+                    double tolerance)
+{
+  assert(steps > 0 && tolerance >= 0.);
+  Flock evolved{flock};
+  Flock reference{flock};
+  // the reference never reorders its boids
+  std::vector<int> ids{};
+  for (Boid const& boid : flock.state()) {
+    ids.push_back(boid.id());
+  }
+  Verification result{};
+  std::vector<Boid> start{};
+  for (int step{0}; step != steps; ++step) {
+    // the reference restarted from evolve's state, in the reference's order
+    // (the boids' ids in it are their places in ids)
+    start.clear();
+    for (int id : ids) {
+      start.push_back(evolved.state()[evolved.index_of(id)]);
+    }
+    Flock one_step{start};
+    one_step.set_obstacles(flock.obstacles());
+
+    double const d_t{evolved.evolve(pars)};
+    one_step.reference_evolve(pars, d_t);
+    reference.reference_evolve(pars, d_t);
+    assert(evolved.size() == reference.size());
+    double worst{0.};
+    int worst_id{-1};
+    result.accumulated.push_back(
+        deviation(evolved, reference.state(), ids, worst, worst_id));
+    result.steps.push_back(
+        deviation(evolved, one_step.state(), ids, worst, worst_id));
+    if (result.first_step < 0 && worst > tolerance) {
+      result.first_step = step;
+      result.first_id   = worst_id;
+    }
+  }
+  return result;
+}
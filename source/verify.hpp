@@ -0,0 +1,37 @@
+#ifndef VERIFY_HPP
+#define VERIFY_HPP
+#include "flock.hpp"
+#include <vector>
+
+// defines the verification of the flock's evolution (with whatever kernels,
+// grids, threads and approximations pars selects) against its reference
+// implementation, Flock::reference_evolve
+
+// largest deviations of the evolved boids from the reference ones after a step
+struct Deviation
+{
+  double position;
+  double velocity;
+};
+
+// deviations after each step: those of the step alone (evolve's and the
+// reference's step from the same state), and those accumulated since the
+// first step, which the flock's chaotic motion amplifies step after step
+struct Verification
+{
+  std::vector<Deviation> steps;
+  std::vector<Deviation> accumulated;
+  // first step by which a boid deviated by more than the tolerance, and the
+  // boid deviating the most in it (both -1 if none did)
+  int first_step{-1};
+  int first_id{-1};
+};
+
+// evolves two copies of flock for steps steps from the same state, one by
+// evolve, the other by reference_evolve with the time step evolve used, and
+// compares their boids by id after each step. Before each step, a third copy
+// takes the state evolve reached, then takes the same step by reference_evolve
+Verification verify(Flock const& flock, Parameters const& pars, int steps,
+                    double tolerance);
+
+#endif
@@ -0,0 +1,81 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "verify.hpp"
+#include "doctest.h"
+#include <algorithm>
+
+TEST_CASE("testing verify")
+{
+  Parameters pars{300.,    3.,  1.,   2., .5,   1., 100.,
+                  .000005, 30., 3000, 60, 3000, 200};
+  std::vector<Boid> boids{};
+  fill(boids, pars, 5);
+  boids.push_back(Boid{{50., 50.}, {10., 0.}, true});
+  Flock const flock{boids};
+
+  SUBCASE("exact paths")
+  {
+    // the specialized kernel and the generic evolution, in parallel, give the
+    // reference's very results
+    for (bool specialized : {true, false}) {
+      pars.set_specialized() = specialized;
+      pars.set_threads()     = 3;
+      Verification const exact{verify(flock, pars, 10, 0.)};
+      REQUIRE(exact.steps.size() == 10u);
+      REQUIRE(exact.accumulated.size() == 10u);
+      for (auto const* deviations : {&exact.steps, &exact.accumulated}) {
+        for (Deviation const& d : *deviations) {
+          CHECK(d.position == 0.);
+          CHECK(d.velocity == 0.);
+        }
+      }
+      CHECK(exact.first_step == -1);
+      CHECK(exact.first_id == -1);
+    }
+
+    // so does the adaptive time step
+    pars.set_adaptive_step() = true;
+    Verification const adaptive{verify(flock, pars, 10, 0.)};
+    CHECK(adaptive.first_step == -1);
+
+    // and so does the cell list
+    pars.set_cell_list() = 2;
+    Verification const cells{verify(flock, pars, 10, 0.)};
+    CHECK(cells.first_step == -1);
+  }
+
+  SUBCASE("reordering only changes the rounding of sums")
+  {
+    pars.set_reorder_interval() = 2;
+    Verification const reordered{verify(flock, pars, 10, 0.)};
+    // the first sort follows the second evolution
+    CHECK(reordered.steps[1].velocity == 0.);
+    CHECK(reordered.first_step >= 2);
+    CHECK(reordered.first_id >= 0);
+    CHECK(reordered.first_id < 201);
+    CHECK(reordered.steps.back().velocity < 1e-9);
+
+    // the rounding of each step is amplified by the following ones: the
+    // deviations accumulated outgrow those of any step, which stay small
+    Verification const longer{verify(flock, pars, 150, 1e-12)};
+    CHECK(longer.first_step == -1);
+    double largest_step{0.};
+    for (Deviation const& d : longer.steps) {
+      largest_step = std::max(largest_step, d.velocity);
+    }
+    CHECK(largest_step > 0.);
+    CHECK(longer.accumulated.back().velocity > 10. * largest_step);
+  }
+
+  SUBCASE("approximate rules diverge")
+  {
+    pars.set_approximate() = true;
+    Verification const approx{verify(flock, pars, 20, 0.)};
+    REQUIRE(approx.steps.size() == 20u);
+    REQUIRE(approx.first_step >= 0);
+    CHECK(approx.first_id >= 0);
+    Deviation const& first{approx.steps[approx.first_step]};
+    CHECK(std::max(first.position, first.velocity) > 0.);
+    // with a tolerance, divergence is declared later, if ever
+    CHECK(verify(flock, pars, 20, 1e-3).first_step != approx.first_step);
+  }
+}
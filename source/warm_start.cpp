@@ -0,0 +1,102 @@
+#include "warm_start.hpp"
+#include "hash.hpp"
+#include "output.hpp"
+#include "trajectory.hpp"
+#include <limits>
+#include <stdexcept>
+#include <unistd.h>
+
+// defines the key of cached states and the warm start of flocks
+
+// version of the cached states' format and of the flying rules (see hash.hpp)
+int constexpr warm_start_version{2};
+
+std::uint64_t warm_start_key(Parameters const& pars, unsigned int seed,
+                             int burn_in, Obstacles const& obstacles)
+{
+  Hash hash{};
+  hash.add(warm_start_version)
+      .add(pars.get_angle())
+      .add(pars.get_d())
+      .add(pars.get_d_s())
+      .add(pars.get_s())
+      .add(pars.get_c())
+      .add(pars.get_a())
+      .add(pars.get_max_speed())
+      .add(pars.get_min_speed())
+      .add(pars.get_duration())
+      .add(pars.get_steps())
+      .add(pars.get_N_boids())
+      .add(pars.get_x_min())
+      .add(pars.get_x_max())
+      .add(pars.get_y_min())
+      .add(pars.get_y_max())
+      .add(pars.get_d_s_pred())
+      .add(pars.get_s_pred())
+      .add(pars.get_adaptive_step())
+      .add(pars.get_sleeping())
+      .add(pars.get_approximate())
+      .add(pars.get_specialized())
+      .add(pars.get_tiled())
+      .add(pars.get_reorder_interval())
+      .add(seed)
+      .add(burn_in)
+      .add(obstacles.size());
+  // every obstacle is near enough to an infinite range
+  obstacles.for_each_near(
+      Position{0., 0.}, std::numeric_limits<double>::infinity(),
+      [&](Obstacle const& o) {
+        hash.add(o.a.x()).add(o.a.y()).add(o.b.x()).add(o.b.y()).add(
+            o.radius);
+      });
+  return hash.value();
+}
+
+std::string warm_start_file(std::string const& dir, std::uint64_t key)
+{
+  return cache_file(dir, key, ".trj");
+}
+
+// state cached in filename, if it's there and holds n boids (a file that
+// can't be read as a trajectory is no cache either)
+bool read_state(std::string const& filename, int n, std::vector<Boid>& state)
+{
+  if (access(filename.c_str(), R_OK) != 0) {
+    return false;
+  }
+  try {
+    Trajectory const trajectory{filename};
+    if (trajectory.size() != 1 || trajectory.n_boids(0) != n) {
+      return false;
+    }
+    trajectory.read(0, state);
+  } catch (std::runtime_error const&) {
+    return false;
+  }
+  return true;
+}
+
+bool warm_start(Flock& flock, Parameters const& pars, unsigned int seed,
+                int burn_in, std::string const& dir)
+{
+  assert(burn_in > 0);
+  std::string const filename{
+      warm_start_file(dir, warm_start_key(pars, seed, burn_in,
+                                          flock.obstacles()))};
+  std::vector<Boid> state{};
+  if (read_state(filename, flock.size(), state)) {
+    Flock cached{state};
+    cached.set_obstacles(flock.obstacles());
+    flock = std::move(cached);
+    return true;
+  }
+
+  for (int i{0}; i != burn_in; ++i) {
+    flock.evolve(pars);
+  }
+  write_cache_file(dir, filename, [&](std::ofstream& file) {
+    file.write(trajectory_magic, trajectory_header_bytes);
+    write_frame(file, Snapshot{0., 0., flock.state()});
+  });
+  return false;
+}
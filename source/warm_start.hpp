@@ -0,0 +1,32 @@
+#ifndef WARM_START_HPP
+#define WARM_START_HPP
+#include "flock.hpp"
+#include <cstdint>
+#include <string>
+
+// defines the warm start of simulations: the state a flock reaches after a
+// burn-in from fill's random state is cached on disk, so that later runs with
+// the same parameters, number of boids and seed start from it at once
+
+// key of the state reached by evolving burn_in times a flock filled with seed
+// and avoiding obstacles: a hash of every parameter the motion depends on,
+// rounding included. The number of threads, the partition and the cell list
+// leave the state unchanged, bit by bit, and are left out; the specialized
+// and tiled kernels and reordering change the order sums are taken in, hence
+// the rounding, and are part of the key
+std::uint64_t warm_start_key(Parameters const& pars, unsigned int seed,
+                             int burn_in, Obstacles const& obstacles);
+
+// file in directory dir caching the state of key: [dir]/[key, in hex].trj, a
+// trajectory (see output.hpp) made of that state only
+std::string warm_start_file(std::string const& dir, std::uint64_t key);
+
+// evolves flock (just filled with seed) burn_in times and caches its state in
+// directory dir (created if needed), unless a state is already cached there
+// under the same key: flock then takes its place, the boids' ids following the
+// cached order (a cached file that can't be read is burnt in again). Returns
+// true if the cached state was used
+bool warm_start(Flock& flock, Parameters const& pars, unsigned int seed,
+                int burn_in, std::string const& dir);
+
+#endif
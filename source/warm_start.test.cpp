@@ -0,0 +1,112 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "warm_start.hpp"
+#include "doctest.h"
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+
+TEST_CASE("testing warm_start_key")
+{
+  Parameters pars{300., 3.,  1.,  2.,   .5, 1., 100.,
+                  .05,  30., 3000, 60, 3000, 50};
+  Obstacles const none{};
+  auto const key{warm_start_key(pars, 7, 100, none)};
+  CHECK(warm_start_key(pars, 7, 100, none) == key);
+  CHECK(warm_start_key(pars, 8, 100, none) != key);
+  CHECK(warm_start_key(pars, 7, 101, none) != key);
+  CHECK(warm_start_key(pars, 7, 100, Obstacles{{{{1., 2.}, {1., 2.}, 3.}}})
+        != key);
+
+  // settings leaving the state unchanged don't matter, how it moves and how
+  // it's rounded do
+  Parameters other{pars};
+  other.set_threads()       = 4;
+  other.set_work_stealing() = false;
+  other.set_cell_list()     = 2;
+  CHECK(warm_start_key(other, 7, 100, none) == key);
+  other.set_sleeping() = true;
+  CHECK(warm_start_key(other, 7, 100, none) != key);
+  Parameters kernels{pars};
+  kernels.set_specialized() = true;
+  CHECK(warm_start_key(kernels, 7, 100, none) != key);
+  Parameters tiled{pars};
+  tiled.set_tiled() = true;
+  CHECK(warm_start_key(tiled, 7, 100, none) != key);
+  Parameters reordered{pars};
+  reordered.set_reorder_interval() = 10;
+  CHECK(warm_start_key(reordered, 7, 100, none) != key);
+  Parameters const more{300., 3.,  1.,  2.,   .5, 1., 100.,
+                        .05,  30., 3000, 60, 3000, 51};
+  CHECK(warm_start_key(more, 7, 100, none) != key);
+
+  CHECK(warm_start_file("cache", 0xabcull) == "cache/0000000000000abc.trj");
+}
+
+TEST_CASE("testing warm_start")
+{
+  Parameters const pars{300., 3.,  1.,  2.,   .5, 1., 100.,
+                        .05,  30., 3000, 60, 3000, 50};
+  std::string const dir{"warm_start_test"};
+  std::string const filename{
+      warm_start_file(dir, warm_start_key(pars, 7, 20, Obstacles{}))};
+
+  // the first run burns in and caches its state
+  std::vector<Boid> boids{};
+  Flock first{fill(boids, pars, 7)};
+  CHECK_FALSE(warm_start(first, pars, 7, 20, dir));
+  CHECK(access(filename.c_str(), R_OK) == 0);
+  boids.clear();
+  Flock burnt{fill(boids, pars, 7)};
+  for (int i{0}; i != 20; ++i) {
+    burnt.evolve(pars);
+  }
+  REQUIRE(first.size() == burnt.size());
+  for (int i{0}; i != first.size(); ++i) {
+    CHECK(first.state()[i].position() == burnt.state()[i].position());
+  }
+
+  // the next ones start from it
+  boids.clear();
+  Flock second{fill(boids, pars, 7)};
+  CHECK(warm_start(second, pars, 7, 20, dir));
+  REQUIRE(second.size() == first.size());
+  for (int i{0}; i != first.size(); ++i) {
+    CHECK(second.state()[i].position() == first.state()[i].position());
+    CHECK(second.state()[i].velocity() == first.state()[i].velocity());
+    CHECK(second.state()[i].id() == i);
+  }
+
+  // a damaged file is burnt in again, and replaced
+  std::ofstream{filename, std::ios::binary} << "not a trajectory";
+  boids.clear();
+  Flock damaged{fill(boids, pars, 7)};
+  CHECK_FALSE(warm_start(damaged, pars, 7, 20, dir));
+  for (int i{0}; i != first.size(); ++i) {
+    CHECK(damaged.state()[i].position() == first.state()[i].position());
+  }
+  boids.clear();
+  Flock repaired{fill(boids, pars, 7)};
+  CHECK(warm_start(repaired, pars, 7, 20, dir));
+
+  // flocks avoiding obstacles have states of their own, and keep obstacles
+  Obstacles const pillar{{{{1., 2.}, {1., 2.}, 3.}}};
+  for (bool cached : {false, true}) {
+    boids.clear();
+    Flock flock{fill(boids, pars, 7)};
+    flock.set_obstacles(pillar);
+    CHECK(warm_start(flock, pars, 7, 20, dir) == cached);
+    CHECK(flock.obstacles().size() == 1);
+  }
+
+  // another seed burns in again
+  boids.clear();
+  Flock third{fill(boids, pars, 8)};
+  CHECK_FALSE(warm_start(third, pars, 8, 20, dir));
+
+  std::remove(filename.c_str());
+  std::remove(
+      warm_start_file(dir, warm_start_key(pars, 8, 20, Obstacles{})).c_str());
+  std::remove(
+      warm_start_file(dir, warm_start_key(pars, 7, 20, pillar)).c_str());
+  rmdir(dir.c_str());
+}